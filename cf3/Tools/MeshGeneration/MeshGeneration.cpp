@@ -403,6 +403,66 @@ void create_circle_2d ( Mesh& mesh, const Real radius, const Uint segments, cons
   mesh.raise_mesh_loaded();
 }
 
+void create_box_tetras(Mesh& mesh, const Real x_len, const Real y_len, const Real z_len, const Uint x_segments, const Uint y_segments, const Uint z_segments)
+{
+  Region& region = mesh.topology().create_region("region");
+  Dictionary& nodes = mesh.geometry_fields();
+  const Uint x_nodes = x_segments+1;
+  const Uint y_nodes = y_segments+1;
+  mesh.initialize_nodes(x_nodes*y_nodes*(z_segments+1),DIM_3D);
+
+  const Real x_step = x_len / static_cast<Real>(x_segments);
+  const Real y_step = y_len / static_cast<Real>(y_segments);
+  const Real z_step = z_len / static_cast<Real>(z_segments);
+  for(Uint k = 0; k <= z_segments; ++k)
+  {
+    for(Uint j = 0; j <= y_segments; ++j)
+    {
+      for(Uint i = 0; i <= x_segments; ++i)
+      {
+        Table<Real>::Row row = nodes.coordinates()[(k*y_nodes + j)*x_nodes + i];
+        row[XX] = static_cast<Real>(i) * x_step;
+        row[YY] = static_cast<Real>(j) * y_step;
+        row[ZZ] = static_cast<Real>(k) * z_step;
+      }
+    }
+  }
+
+  // Each hexahedron is split into 6 tetrahedra around its main diagonal, one for each ordering of the axes
+  const Uint axis_orders[6][3] = { {0,1,2}, {0,2,1}, {1,0,2}, {1,2,0}, {2,0,1}, {2,1,0} };
+  const Uint axis_strides[3] = { 1, x_nodes, x_nodes*y_nodes };
+
+  Handle<Cells> cells = region.create_component<Cells>("Tetra");
+  cells->initialize("cf3.mesh.LagrangeP1.Tetra3D",nodes);
+  cells->resize(6*x_segments*y_segments*z_segments);
+  Table<Uint>& connectivity = cells->geometry_space().connectivity();
+  Uint elem = 0;
+  for(Uint k = 0; k < z_segments; ++k)
+  {
+    for(Uint j = 0; j < y_segments; ++j)
+    {
+      for(Uint i = 0; i < x_segments; ++i)
+      {
+        const Uint node0 = (k*y_nodes + j)*x_nodes + i;
+        for(Uint t = 0; t != 6; ++t, ++elem)
+        {
+          Table<Uint>::Row tet = connectivity[elem];
+          tet[0] = node0;
+          tet[1] = tet[0] + axis_strides[axis_orders[t][0]];
+          tet[2] = tet[1] + axis_strides[axis_orders[t][1]];
+          tet[3] = tet[2] + axis_strides[axis_orders[t][2]];
+          // Odd permutations of the axes give a negative volume
+          if(t == 1 || t == 2 || t == 5)
+            std::swap(tet[1], tet[2]);
+        }
+      }
+    }
+  }
+
+  build_serial_gids(mesh);
+  mesh.raise_mesh_loaded();
+}
+
 void create_channel_3d(BlockArrays& blocks, const Real length, const Real half_height, const Real width, const Uint x_segs, const Uint y_segs_half, const Uint z_segs, const Real ratio)
 {
   Table<Real>& points = *blocks.create_points(3, 12);
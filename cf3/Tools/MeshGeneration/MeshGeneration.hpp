@@ -33,6 +33,10 @@ void MeshGeneration_API create_rectangle_tris(mesh::Mesh& mesh, const Real x_len
 /// Creates a 2D circular arc
 void MeshGeneration_API create_circle_2d(mesh::Mesh& mesh, const Real radius, const Uint segments, const Real start_angle = 0., const Real end_angle = 2.*math::Consts::pi());
 
+/// Create a 3D box mesh of tetrahedra, obtained by splitting each cell of a structured grid into 6 tetrahedra.
+/// Only the volume region is created.
+void MeshGeneration_API create_box_tetras(mesh::Mesh& mesh, const Real x_len, const Real y_len, const Real z_len, const Uint x_segments, const Uint y_segments, const Uint z_segments);
+
 /// Create block data for a 3D periodic channel (flow between infinite flat plates)
 /// @param length: Total distance between the streamwise periodic boundaries (X-direction)
 /// @param half_height: Half of the distance between the plates
@@ -0,0 +1,154 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zlib.hpp>
+#include <boost/iostreams/device/array.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+
+#include "coolfluid-config.hpp"
+
+#ifdef CF3_HAVE_BOOST_ZSTD
+  #include <boost/iostreams/filter/zstd.hpp>
+#endif
+
+#include "common/BasicExceptions.hpp"
+#include "common/BinaryDataCodecs.hpp"
+#include "common/StringConversion.hpp"
+
+namespace cf3 {
+namespace common {
+
+std::vector<std::string> binary_data_codecs()
+{
+  std::vector<std::string> result;
+  result.push_back("zlib");
+  result.push_back("none");
+#ifdef CF3_HAVE_BOOST_ZSTD
+  result.push_back("zstd");
+#endif
+  return result;
+}
+
+namespace detail {
+
+namespace {
+
+// Group the i-th byte of each element
+void shuffle_bytes(const char* in, const Uint count, const Uint element_size, char* out)
+{
+  const Uint nb_elements = count / element_size;
+  for(Uint i = 0; i != nb_elements; ++i)
+    for(Uint b = 0; b != element_size; ++b)
+      out[b*nb_elements + i] = in[i*element_size + b];
+}
+
+void unshuffle_bytes(const char* in, const Uint count, const Uint element_size, char* out)
+{
+  const Uint nb_elements = count / element_size;
+  for(Uint i = 0; i != nb_elements; ++i)
+    for(Uint b = 0; b != element_size; ++b)
+      out[i*element_size + b] = in[b*nb_elements + i];
+}
+
+void check_codec(const std::string& codec)
+{
+  const std::vector<std::string> codecs = binary_data_codecs();
+  if(std::find(codecs.begin(), codecs.end(), codec) == codecs.end())
+    throw NotSupported(FromHere(), "Codec " + codec + " is not supported by this build");
+}
+
+}
+
+void encode_binary_data(const char* data, const Uint count, const std::string& codec, const Uint level, const Uint element_size, std::vector<char>& encoded)
+{
+  check_codec(codec);
+  if(element_size > 1 && count % element_size != 0)
+    throw BadValue(FromHere(), "Data size " + to_str(count) + " is not a multiple of the element size " + to_str(element_size));
+
+  encoded.clear();
+  if(count == 0)
+    return;
+
+  std::vector<char> shuffled;
+  if(element_size > 1)
+  {
+    shuffled.resize(count);
+    shuffle_bytes(data, count, element_size, &shuffled[0]);
+    data = &shuffled[0];
+  }
+
+  if(codec == "none")
+  {
+    encoded.assign(data, data + count);
+    return;
+  }
+
+  boost::iostreams::filtering_ostream compressing_stream;
+  if(codec == "zlib")
+  {
+    if(level > 9)
+      throw BadValue(FromHere(), "zlib compression level must be between 1 and 9, got " + to_str(level));
+    compressing_stream.push(boost::iostreams::zlib_compressor(level == 0 ? boost::iostreams::zlib::default_compression : static_cast<int>(level)));
+  }
+#ifdef CF3_HAVE_BOOST_ZSTD
+  else if(codec == "zstd")
+  {
+    if(level > 22)
+      throw BadValue(FromHere(), "zstd compression level must be between 1 and 22, got " + to_str(level));
+    compressing_stream.push(boost::iostreams::zstd_compressor(boost::iostreams::zstd_params(level == 0 ? boost::iostreams::zstd::default_compression : level)));
+  }
+#endif
+  compressing_stream.push(boost::iostreams::back_inserter(encoded));
+  compressing_stream.write(data, count);
+  compressing_stream.pop();
+}
+
+void decode_binary_data(const char* encoded, const Uint encoded_size, const std::string& codec, const Uint element_size, char* data, const Uint count)
+{
+  check_codec(codec);
+  if(count == 0)
+    return;
+
+  std::vector<char> shuffled;
+  char* decoded = data;
+  if(element_size > 1)
+  {
+    shuffled.resize(count);
+    decoded = &shuffled[0];
+  }
+
+  if(codec == "none")
+  {
+    if(encoded_size != count)
+      throw SetupError(FromHere(), "Uncompressed block has " + to_str(encoded_size) + " bytes, expected " + to_str(count));
+    std::copy(encoded, encoded + count, decoded);
+  }
+  else
+  {
+    boost::iostreams::filtering_istream decompressing_stream;
+    if(codec == "zlib")
+      decompressing_stream.push(boost::iostreams::zlib_decompressor());
+#ifdef CF3_HAVE_BOOST_ZSTD
+    else if(codec == "zstd")
+      decompressing_stream.push(boost::iostreams::zstd_decompressor());
+#endif
+    decompressing_stream.push(boost::iostreams::array_source(encoded, encoded_size));
+    decompressing_stream.read(decoded, count);
+    if(static_cast<Uint>(decompressing_stream.gcount()) != count)
+      throw SetupError(FromHere(), "Decoded " + to_str(decompressing_stream.gcount()) + " bytes, expected " + to_str(count));
+  }
+
+  if(element_size > 1)
+    unshuffle_bytes(decoded, count, element_size, data);
+}
+
+} // detail
+
+} // common
+} // cf3
@@ -0,0 +1,45 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_BinaryDataCodecs_hpp
+#define cf3_common_BinaryDataCodecs_hpp
+
+#include <string>
+#include <vector>
+
+#include "common/CommonAPI.hpp"
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+/// Codecs that can be used to encode the blocks written by BinaryDataWriter. "none" and "zlib" are always available,
+/// "zstd" only if boost iostreams was built with zstd support.
+Common_API std::vector<std::string> binary_data_codecs();
+
+namespace detail {
+
+/// Encode count bytes of data using the given codec. The compression level 0 selects the default level for the codec.
+/// If element_size is larger than 1, the bytes are shuffled first, so the i-th bytes of all elements are stored contiguously.
+/// This improves compression for floating point data, where the exponent bytes vary little between neighbouring values.
+Common_API void encode_binary_data(const char* data, const Uint count, const std::string& codec, const Uint level, const Uint element_size, std::vector<char>& encoded);
+
+/// Decode data encoded by encode_binary_data into count bytes at data
+Common_API void decode_binary_data(const char* encoded, const Uint encoded_size, const std::string& codec, const Uint element_size, char* data, const Uint count);
+
+} // detail
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_BinaryDataCodecs_hpp
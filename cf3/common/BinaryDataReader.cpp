@@ -7,15 +7,14 @@
 #include <boost/bind.hpp>
 #include <boost/function.hpp>
 
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/restrict.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "rapidxml/rapidxml.hpp"
 
 #include "common/Signal.hpp"
 #include "common/PropertyList.hpp"
 #include "common/OptionList.hpp"
+#include "common/BinaryDataCodecs.hpp"
 #include "common/BinaryDataReader.hpp"
 #include "common/FindComponents.hpp"
 
@@ -31,13 +30,30 @@ namespace common {
 
 struct BinaryDataReader::Implementation
 {
-  Implementation(const URI& file, const Uint rank) :
-    xml_doc(XML::parse_file(file)),
+  /// Description of a block, as found in the XML file
+  struct BlockInfo
+  {
+    std::string name;
+    std::string type_name;
+    std::string codec;
+    /// Element size if the bytes were shuffled before encoding, 0 otherwise
+    Uint shuffle;
+    Uint nb_rows;
+    Uint nb_cols;
+    Uint begin;
+    Uint end;
+  };
+
+  Implementation(const URI& file, const Uint rank, const bool memory_map) :
     m_rank(rank)
   {
+    boost::shared_ptr<XmlDoc> xml_doc = XML::parse_file(file);
     XmlNode cfbinary(xml_doc->content->first_node("cfbinary"));
-    cf3_assert(from_str<Uint>(cfbinary.attribute_value("version")) == version());
+    const Uint file_version = from_str<Uint>(cfbinary.attribute_value("version"));
+    if(file_version > version())
+      throw SetupError(FromHere(), "Binary data file " + file.path() + " has version " + to_str(file_version) + ", which is newer than the supported version " + to_str(version()));
 
+    XmlNode my_node;
     XmlNode nodes(cfbinary.content->first_node(("nodes")));
     XmlNode node(nodes.content->first_node("node"));
     for(; node.is_valid(); node = XmlNode(node.content->next_sibling("node")))
@@ -46,80 +62,127 @@ struct BinaryDataReader::Implementation
       if(found_rank != m_rank)
         continue;
 
-      const std::string binary_file_name = node.attribute_value("filename");
-
-      binary_file.open(binary_file_name, std::ios_base::in | std::ios_base::binary);
+      binary_file_name = node.attribute_value("filename");
       my_node = node;
     }
 
     if(!my_node.is_valid())
       throw SetupError(FromHere(), "No node found for rank " + to_str(m_rank));
+
+    // Index the blocks, so the XML doesn't need to be searched for each access
+    XmlNode block_node(my_node.content->first_node("block"));
+    for(; block_node.is_valid(); block_node = XmlNode(block_node.content->next_sibling("block")))
+    {
+      const Uint block_idx = from_str<Uint>(block_node.attribute_value("index"));
+      if(block_idx >= m_blocks.size())
+        m_blocks.resize(block_idx+1);
+      BlockInfo& info = m_blocks[block_idx];
+      info.name = block_node.attribute_value("name");
+      info.type_name = block_node.attribute_value("type_name");
+      // Files written before the codec was recorded are always zlib compressed
+      info.codec = block_node.content->first_attribute("codec") == nullptr ? "zlib" : block_node.attribute_value("codec");
+      info.shuffle = block_node.content->first_attribute("shuffle") == nullptr ? 0 : from_str<Uint>(block_node.attribute_value("shuffle"));
+      info.nb_rows = from_str<Uint>(block_node.attribute_value("nb_rows"));
+      info.nb_cols = from_str<Uint>(block_node.attribute_value("nb_cols"));
+      info.begin = from_str<Uint>(block_node.attribute_value("begin"));
+      info.end = from_str<Uint>(block_node.attribute_value("end"));
+    }
+
+    if(memory_map)
+      mapped_file.open(binary_file_name);
+    else
+      binary_file.open(binary_file_name, std::ios_base::in | std::ios_base::binary);
   }
 
   ~Implementation()
   {
   }
 
+  /// Version 2 adds the codec and shuffle attributes for each block
   Uint version() const
   {
-    static const Uint current_version = 1;
+    static const Uint current_version = 2;
     return current_version;
   }
   
-  XmlNode get_block_node(const Uint block_idx)
+  const BlockInfo& get_block(const Uint block_idx) const
   {
-    XmlNode block_node(my_node.content->first_node("block"));
-    for(; block_node.is_valid(); block_node = XmlNode(block_node.content->next_sibling("block")))
-    {
-      if(from_str<Uint>(block_node.attribute_value("index")) == block_idx)
-        return block_node;
-    }
-    
-    throw SetupError(FromHere(), "Block with index " + to_str(block_idx) + " was not found");
+    if(block_idx >= m_blocks.size() || m_blocks[block_idx].type_name.empty())
+      throw SetupError(FromHere(), "Block with index " + to_str(block_idx) + " was not found");
+
+    return m_blocks[block_idx];
+  }
+
+  /// Start of the data for the given block in the mapped file, after checking the prefix
+  const char* mapped_block_data(const Uint block_idx) const
+  {
+    cf3_assert(mapped_file.is_open());
+    const BlockInfo& block = get_block(block_idx);
+    if(block.end > mapped_file.size())
+      throw SetupError(FromHere(), "Block " + to_str(block_idx) + " ends beyond the end of file " + binary_file_name);
+
+    const char* block_begin = mapped_file.data() + block.begin;
+    if(std::string(block_begin, block_begin + block_prefix().size()) != block_prefix())
+      throw SetupError(FromHere(), "Bad block prefix for block " + to_str(block_idx));
+
+    return block_begin + block_prefix().size();
   }
 
   void read_data_block(char *data, const Uint count, const Uint block_idx)
   {
-    static const std::string block_prefix("__CFDATA_BEGIN");
-    
-    XmlNode block_node = get_block_node(block_idx);
-      
-    const Uint block_begin = from_str<Uint>(block_node.attribute_value("begin"));
-    const Uint block_end = from_str<Uint>(block_node.attribute_value("end"));
-    const Uint compressed_size = block_end - block_begin - block_prefix.size();
+    const BlockInfo& block = get_block(block_idx);
+    const Uint data_size = block.end - block.begin - block_prefix().size();
+
+    if(mapped_file.is_open())
+    {
+      // Decode straight from the mapped memory
+      detail::decode_binary_data(mapped_block_data(block_idx), data_size, block.codec, block.shuffle, data, count);
+      return;
+    }
 
     // Check the prefix
-    binary_file.seekg(block_begin);
-    std::vector<char> prefix_buf(block_prefix.size());
-    binary_file.read(&prefix_buf[0], block_prefix.size());
+    binary_file.seekg(block.begin);
+    std::vector<char> prefix_buf(block_prefix().size());
+    binary_file.read(&prefix_buf[0], block_prefix().size());
     const std::string read_prefix(prefix_buf.begin(), prefix_buf.end());
-    if(read_prefix != block_prefix)
+    if(read_prefix != block_prefix())
       throw SetupError(FromHere(), "Bad block prefix for block " + to_str(block_idx));
-   
-    if(count != 0)
+
+    if(block.codec == "none" && block.shuffle <= 1)
+    {
+      if(data_size != count)
+        throw SetupError(FromHere(), "Block " + to_str(block_idx) + " has " + to_str(data_size) + " bytes, expected " + to_str(count));
+      if(count != 0)
+        binary_file.read(data, count);
+    }
+    else
     {
-      // Build a decompressing stream
-      boost::iostreams::filtering_istream decompressing_stream;
-      decompressing_stream.set_auto_close(false);
-      decompressing_stream.push(boost::iostreams::zlib_decompressor());
-      decompressing_stream.push(boost::iostreams::restrict(binary_file, 0, compressed_size));
-      
-      // Read the data
-      decompressing_stream.read(data, count);
-      decompressing_stream.pop();
+      std::vector<char> encoded_data(data_size);
+      if(data_size != 0)
+        binary_file.read(&encoded_data[0], data_size);
+      detail::decode_binary_data(data_size == 0 ? 0 : &encoded_data[0], data_size, block.codec, block.shuffle, data, count);
     }
     
-    cf3_assert(binary_file.tellg() == block_end);
+    cf3_assert(binary_file.tellg() == block.end);
   }
 
-  // XML document describing all data added
-  boost::shared_ptr<XmlDoc> xml_doc;
+  static const std::string& block_prefix()
+  {
+    static const std::string prefix("__CFDATA_BEGIN");
+    return prefix;
+  }
+
+  // Name of the binary file for the current rank
+  std::string binary_file_name;
 
-  // Binary file
+  // Binary file, when reading through a stream
   boost::filesystem::fstream binary_file;
 
-  // Xml data for the blocks associated with the current rank
-  XmlNode my_node;
+  // Binary file, when it is memory mapped
+  boost::iostreams::mapped_file_source mapped_file;
+
+  // Description of each block for the current rank
+  std::vector<BlockInfo> m_blocks;
 
   // Rank to read
   const Uint m_rank;
@@ -138,6 +201,11 @@ BinaryDataReader::BinaryDataReader ( const std::string& name ) : Component(name)
     .pretty_name("Rank")
     .description("Rank for which to read data")
     .attach_trigger(boost::bind(&BinaryDataReader::trigger_file, this));
+
+  options().add("memory_map", true)
+    .pretty_name("Memory Map")
+    .description("Memory map the binary file instead of reading it through a stream. Blocks are only decoded when they are read.")
+    .attach_trigger(boost::bind(&BinaryDataReader::trigger_file, this));
 }
 
 BinaryDataReader::~BinaryDataReader()
@@ -150,33 +218,59 @@ void BinaryDataReader::close()
   m_implementation.reset();
 }
 
+Uint BinaryDataReader::nb_blocks()
+{
+  return implementation().m_blocks.size();
+}
+
 Uint BinaryDataReader::block_cols ( const Uint block_idx )
 {
-  return from_str<Uint>(m_implementation->get_block_node(block_idx).attribute_value("nb_cols"));
+  return implementation().get_block(block_idx).nb_cols;
 }
 
 Uint BinaryDataReader::block_rows ( const Uint block_idx )
 {
-  return from_str<Uint>(m_implementation->get_block_node(block_idx).attribute_value("nb_rows"));
+  return implementation().get_block(block_idx).nb_rows;
 }
 
 std::string BinaryDataReader::block_name ( const Uint block_idx )
 {
-  return m_implementation->get_block_node(block_idx).attribute_value("name");
+  return implementation().get_block(block_idx).name;
 }
 
 std::string BinaryDataReader::block_type_name ( const Uint block_idx )
 {
-  return m_implementation->get_block_node(block_idx).attribute_value("type_name");
+  return implementation().get_block(block_idx).type_name;
+}
+
+std::string BinaryDataReader::block_codec ( const Uint block_idx )
+{
+  return implementation().get_block(block_idx).codec;
 }
 
+const char* BinaryDataReader::mapped_data_block(const Uint block_idx)
+{
+  Implementation& impl = implementation();
+  if(!impl.mapped_file.is_open())
+    throw SetupError(FromHere(), "File for BinaryDataReader at " + uri().path() + " is not memory mapped");
+  if(impl.get_block(block_idx).codec != "none")
+    throw SetupError(FromHere(), "Block " + to_str(block_idx) + " is encoded with codec " + impl.get_block(block_idx).codec + " and can't be accessed in place");
 
-void BinaryDataReader::read_data_block(char *data, const Uint count, const Uint block_idx)
+  return impl.mapped_block_data(block_idx);
+}
+
+BinaryDataReader::Implementation& BinaryDataReader::implementation()
 {
   if(is_null(m_implementation.get()))
     throw SetupError(FromHere(), "No open file for BinaryDataReader at " + uri().path());
-  
-  m_implementation->read_data_block(data, count, block_idx);
+
+  return *m_implementation;
+}
+
+
+void BinaryDataReader::read_data_block(char *data, const Uint count, const Uint block_idx)
+{
+  implementation().read_data_block(data, count, block_idx);
 }
 
 void BinaryDataReader::trigger_file()
@@ -186,7 +280,7 @@ void BinaryDataReader::trigger_file()
   {
     throw SetupError(FromHere(), "Input file " + file_uri.path() + " does not exist");
   }
-  m_implementation.reset(new Implementation(file_uri, options().value<Uint>("rank")));
+  m_implementation.reset(new Implementation(file_uri, options().value<Uint>("rank"), options().value<bool>("memory_map")));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -21,7 +21,9 @@ namespace common {
 ///////////////////////////////////////////////////////////////////////////////////////
 
   
-/// Component for writing binary data collected into a single file
+/// Component for reading binary data written by BinaryDataWriter.
+/// The block index is built from the XML file when the file is opened. By default, the binary file is memory mapped
+/// and each block is only decoded when it is read.
 class Common_API BinaryDataReader : public Component {
 
 public: // functions
@@ -60,9 +62,23 @@ public: // functions
     read_data_block(reinterpret_cast<char*>(list.array().data()), sizeof(T)*rows, block_idx);
   }
 
+  /// Access the data of an uncompressed block (codec "none") in place, without copying it.
+  /// Requires the memory_map option. The returned array is valid until the file is closed.
+  template<typename T>
+  boost::const_multi_array_ref<T, 2> mapped_array(const Uint block_idx)
+  {
+    if(block_type_name(block_idx) != class_name<T>())
+      throw SetupError(FromHere(), "Block at index " + to_str(block_idx) + " is of type " + block_type_name(block_idx) + " and can't be accessed as " + class_name<T>());
+
+    return boost::const_multi_array_ref<T, 2>(reinterpret_cast<const T*>(mapped_data_block(block_idx)), boost::extents[block_rows(block_idx)][block_cols(block_idx)]);
+  }
+
   /// Close the current file
   void close();
 
+  /// Number of blocks for the current rank
+  Uint nb_blocks();
+
   /// Number of rows for the given block
   Uint block_rows(const Uint block_idx);
 
@@ -75,7 +91,12 @@ public: // functions
   /// Type name of the data stored in the given block
   std::string block_type_name(const Uint block_idx);
 
+  /// Encoding of the given block
+  std::string block_codec(const Uint block_idx);
+
 private:
+  // Pointer to the in-place data of an uncompressed block in the mapped file
+  const char* mapped_data_block(const Uint block_idx);
   // Read aata block from the binary file
   void read_data_block(char* data, const Uint count, const Uint block_idx);
 
@@ -84,6 +105,9 @@ private:
 
   class Implementation;
   boost::scoped_ptr<Implementation> m_implementation;
+
+  // Implementation for the current file, throwing if no file is open
+  Implementation& implementation();
 };
 
 /////////////////////////////////////////////////////////////////////////////////////
@@ -8,14 +8,19 @@
 #include <boost/function.hpp>
 #include "common/BoostAssign.hpp"
 
-#include <boost/iostreams/filtering_stream.hpp>
-#include <boost/iostreams/filter/zlib.hpp>
-#include <boost/iostreams/device/file_descriptor.hpp>
+#include <deque>
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include <boost/foreach.hpp>
 
 #include "common/Log.hpp"
 #include "common/Signal.hpp"
 #include "common/PropertyList.hpp"
 #include "common/OptionList.hpp"
+#include "common/BinaryDataCodecs.hpp"
 #include "common/BinaryDataWriter.hpp"
 #include "common/FindComponents.hpp"
 
@@ -31,101 +36,149 @@ namespace common {
 
 struct BinaryDataWriter::Implementation
 {
-  Implementation(const URI& file) :
+  Implementation(const URI& file, const bool asynchronous, const std::string& codec, const Uint compression_level, const bool shuffle) :
     filename(build_filename(file, PE::Comm::instance().rank())),
     xml_filename(file),
     index(0),
-    xml_doc("1.0", "ISO-8859-1"),
-    m_total_count(0)
+    m_codec(codec),
+    m_compression_level(compression_level),
+    m_shuffle(shuffle),
+    m_total_count(0),
+    m_finished(false),
+    m_closed(false)
   {
     const Uint v = version();
     out_file.open(filename, std::ios_base::out | std::ios_base::binary);
     out_file.write(reinterpret_cast<const char*>(&v), sizeof(Uint));
 
-    PE::Comm& comm = PE::Comm::instance();
-    // Rank 0 writes out an XML file that lists all filenames for all CPUs
-    if(comm.rank() == 0)
-    {
-      XmlNode cfbinary = xml_doc.add_node("cfbinary");
-      cfbinary.set_attribute("version", to_str(version()));
-      node_xml_data.reserve(comm.size());
-      XmlNode node_list = cfbinary.add_node("nodes");
-      for(Uint i = 0; i != comm.size(); ++i)
-      {
-        XmlNode node = node_list.add_node("node");
-        node.set_attribute("filename", build_filename(file, i));
-        node.set_attribute("rank", to_str(i));
-        node_xml_data.push_back(node);
-      }
-    }
+    if(asynchronous)
+      m_thread.reset(new boost::thread(boost::bind(&Implementation::process_queue, this)));
   }
 
   ~Implementation()
   {
-    CFdebug << "wrote a total of " << m_total_count << " bytes with a compression ratio of " << static_cast<Real>(out_file.tellp()) / static_cast<Real>(m_total_count) * 100. << "%" << CFendl;
-    out_file.close();
-    if(PE::Comm::instance().rank() == 0)
-      XML::to_file(xml_doc, xml_filename);
-
-    PE::Comm::instance().barrier();
+    try
+    {
+      close();
+    }
+    catch(std::exception& e)
+    {
+      CFerror << "Error closing binary file " << filename << ": " << e.what() << CFendl;
+    }
   }
 
-  Uint write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
+  /// Wait for all blocks to be written, and write the XML file describing all blocks on all ranks.
+  void close()
   {
-    cf3_assert(out_file.is_open());
-    PE::Comm& comm = PE::Comm::instance();
-    // Prefix and suffix markers
-    static const std::string block_prefix("__CFDATA_BEGIN");
+    if(m_closed)
+      return;
+    m_closed = true;
 
-    const Uint block_begin = out_file.tellp();
-
-    // Write the prefix
-    out_file.write(block_prefix.c_str(), block_prefix.size());
-    
-    if(count != 0)
+    if(is_not_null(m_thread.get()))
     {
-      // Build a compressed stream
-      boost::iostreams::filtering_ostream compressing_stream;
-      compressing_stream.push(boost::iostreams::zlib_compressor());
-      compressing_stream.push(out_file);
-      
-      // Write the data
-      compressing_stream.write(data, count);
-      compressing_stream.pop();
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_finished = true;
+      }
+      m_queue_changed.notify_one();
+      m_thread->join();
+      m_thread.reset();
     }
 
-    const Uint block_end = out_file.tellp();
+    CFdebug << "wrote a total of " << m_total_count << " bytes with a compression ratio of " << static_cast<Real>(out_file.tellp()) / static_cast<Real>(m_total_count) * 100. << "%" << CFendl;
+    out_file.close();
+
+    if(!m_error.empty())
+      throw FileSystemError(FromHere(), "Error writing binary data to " + filename + ": " + m_error);
 
-    // Data describing the block on the current CPU
-    const std::vector<Uint> my_block_info = boost::assign::list_of(nb_rows)(nb_cols)(block_begin)(block_end);
-    const Uint block_info_size = my_block_info.size();
+    // Collect the block info for all blocks on all CPUs at once
+    const Uint nb_blocks = m_block_names.size();
+    cf3_assert(m_block_positions.size() == 2*nb_blocks);
+    std::vector<Uint> block_info;
+    block_info.reserve(nb_blocks*block_info_size);
+    for(Uint i = 0; i != nb_blocks; ++i)
+    {
+      block_info.push_back(m_block_sizes[2*i]);
+      block_info.push_back(m_block_sizes[2*i+1]);
+      block_info.push_back(m_block_positions[2*i]);
+      block_info.push_back(m_block_positions[2*i+1]);
+    }
+
+    PE::Comm& comm = PE::Comm::instance();
     std::vector<Uint> global_block_info;
     const Uint root = 0;
     if(comm.is_active())
     {
-      comm.gather(my_block_info, global_block_info, root);
+      comm.gather(block_info, global_block_info, root);
     }
     else
     {
-      global_block_info = my_block_info;
+      global_block_info = block_info;
     }
 
-    // Write out the XML data
+    // Rank 0 writes out an XML file that lists all filenames and blocks for all CPUs
     if(comm.rank() == root)
     {
+      XmlDoc xml_doc("1.0", "ISO-8859-1");
+      XmlNode cfbinary = xml_doc.add_node("cfbinary");
+      cfbinary.set_attribute("version", to_str(version()));
+      XmlNode node_list = cfbinary.add_node("nodes");
       const Uint nb_procs = comm.size();
       for(Uint i = 0; i != nb_procs; ++i)
       {
-        XmlNode block_xml = node_xml_data[i].add_node("block");
-        const Uint j = i*block_info_size;
-        block_xml.set_attribute("name", list_name);
-        block_xml.set_attribute("index", to_str(index));
-        block_xml.set_attribute("type_name", type_name);
-        block_xml.set_attribute("nb_rows", to_str(global_block_info[j]));
-        block_xml.set_attribute("nb_cols", to_str(global_block_info[j+1]));
-        block_xml.set_attribute("begin", to_str(global_block_info[j+2]));
-        block_xml.set_attribute("end", to_str(global_block_info[j+3]));
+        XmlNode node = node_list.add_node("node");
+        node.set_attribute("filename", build_filename(xml_filename, i));
+        node.set_attribute("rank", to_str(i));
+        for(Uint block_idx = 0; block_idx != nb_blocks; ++block_idx)
+        {
+          XmlNode block_xml = node.add_node("block");
+          const Uint j = (i*nb_blocks + block_idx)*block_info_size;
+          block_xml.set_attribute("name", m_block_names[block_idx]);
+          block_xml.set_attribute("index", to_str(block_idx));
+          block_xml.set_attribute("type_name", m_block_type_names[block_idx]);
+          block_xml.set_attribute("codec", m_codec);
+          block_xml.set_attribute("shuffle", to_str(m_block_shuffle[block_idx]));
+          block_xml.set_attribute("nb_rows", to_str(global_block_info[j]));
+          block_xml.set_attribute("nb_cols", to_str(global_block_info[j+1]));
+          block_xml.set_attribute("begin", to_str(global_block_info[j+2]));
+          block_xml.set_attribute("end", to_str(global_block_info[j+3]));
+        }
       }
+      XML::to_file(xml_doc, xml_filename);
+    }
+
+    comm.barrier();
+  }
+
+  Uint write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
+  {
+    cf3_assert(out_file.is_open());
+    cf3_assert(!m_closed);
+
+    // Uncompressed blocks are never shuffled, so they can be accessed in place
+    const Uint element_size = (m_shuffle && m_codec != "none" && type_name == class_name<Real>()) ? sizeof(Real) : 0;
+
+    m_block_names.push_back(list_name);
+    m_block_type_names.push_back(type_name);
+    m_block_sizes.push_back(nb_rows);
+    m_block_sizes.push_back(nb_cols);
+    m_block_shuffle.push_back(element_size);
+
+    if(is_null(m_thread.get()))
+    {
+      write_block(data, count, element_size);
+    }
+    else
+    {
+      // Copy the data, so the caller is free to modify it while the block is written
+      std::vector<char> block(data, data + count);
+      {
+        boost::lock_guard<boost::mutex> lock(m_mutex);
+        m_queue.push_back(QueuedBlock());
+        m_queue.back().element_size = element_size;
+        m_queue.back().data.swap(block);
+      }
+      m_queue_changed.notify_one();
     }
 
     ++index;
@@ -134,9 +187,79 @@ struct BinaryDataWriter::Implementation
     return index - 1;
   }
 
+  // Encode and write a block to the binary file, appending its begin and end position to m_block_positions
+  void write_block(const char* data, const std::streamsize count, const Uint element_size)
+  {
+    // Prefix marker
+    static const std::string block_prefix("__CFDATA_BEGIN");
+
+    std::vector<char> encoded_data;
+    if(m_codec == "none")
+    {
+      // Align the start of the raw data, so it can be used in place when the file is memory mapped
+      const Uint data_begin = static_cast<Uint>(out_file.tellp()) + block_prefix.size();
+      const Uint padding = (data_alignment - data_begin % data_alignment) % data_alignment;
+      const std::vector<char> padding_bytes(padding, '\0');
+      if(padding != 0)
+        out_file.write(&padding_bytes[0], padding);
+    }
+    else
+    {
+      detail::encode_binary_data(data, count, m_codec, m_compression_level, element_size, encoded_data);
+    }
+
+    const Uint block_begin = out_file.tellp();
+    out_file.write(block_prefix.c_str(), block_prefix.size());
+    if(m_codec == "none")
+    {
+      if(count != 0)
+        out_file.write(data, count);
+    }
+    else if(!encoded_data.empty())
+    {
+      out_file.write(&encoded_data[0], encoded_data.size());
+    }
+    const Uint block_end = out_file.tellp();
+
+    m_block_positions.push_back(block_begin);
+    m_block_positions.push_back(block_end);
+  }
+
+  // Loop executed by the writer thread, writing the queued blocks in order until close is called
+  void process_queue()
+  {
+    while(true)
+    {
+      QueuedBlock block;
+      {
+        boost::unique_lock<boost::mutex> lock(m_mutex);
+        while(m_queue.empty() && !m_finished)
+          m_queue_changed.wait(lock);
+        if(m_queue.empty())
+          return;
+        block.element_size = m_queue.front().element_size;
+        block.data.swap(m_queue.front().data);
+        m_queue.pop_front();
+      }
+
+      if(!m_error.empty())
+        continue;
+
+      try
+      {
+        write_block(block.data.empty() ? 0 : &block.data[0], block.data.size(), block.element_size);
+      }
+      catch(std::exception& e)
+      {
+        m_error = e.what();
+      }
+    }
+  }
+
+  /// Version 2 adds the codec and shuffle attributes for each block
   Uint version() const
   {
-    static const Uint current_version = 1;
+    static const Uint current_version = 2;
     return current_version;
   }
 
@@ -148,6 +271,12 @@ struct BinaryDataWriter::Implementation
     return result.path();
   }
 
+  // Number of Uints describing each block in the XML file
+  static const Uint block_info_size = 4;
+
+  // Alignment in bytes of the data of uncompressed blocks in the file
+  static const Uint data_alignment = 16;
+
   const std::string filename;
   const URI xml_filename;
   boost::filesystem::fstream out_file;
@@ -155,11 +284,37 @@ struct BinaryDataWriter::Implementation
   // Index of the next block to write
   Uint index;
 
-  // XML document describing all data added (only valid on root process)
-  XmlDoc xml_doc;
+  // Encoding used for all blocks
+  const std::string m_codec;
+  const Uint m_compression_level;
+  const bool m_shuffle;
+
+  // Name, type name, rows and columns for each block
+  std::vector<std::string> m_block_names;
+  std::vector<std::string> m_block_type_names;
+  std::vector<Uint> m_block_sizes;
+  // Element size used to shuffle the bytes of each block, or 0 if the block is not shuffled
+  std::vector<Uint> m_block_shuffle;
+
+  // Begin and end position of each written block in the file. Only accessed by the writer thread until close.
+  std::vector<Uint> m_block_positions;
 
-  std::vector<XmlNode> node_xml_data;
   Uint m_total_count;
+
+  // Writer thread and the queue of blocks it has to write
+  boost::scoped_ptr<boost::thread> m_thread;
+  boost::mutex m_mutex;
+  boost::condition_variable m_queue_changed;
+  struct QueuedBlock
+  {
+    Uint element_size;
+    std::vector<char> data;
+  };
+  std::deque<QueuedBlock> m_queue;
+  bool m_finished;
+  std::string m_error;
+
+  bool m_closed;
 };
   
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -170,23 +325,49 @@ BinaryDataWriter::BinaryDataWriter ( const std::string& name ) : Component(name)
     .pretty_name("File")
     .description("File name for the output file")
     .attach_trigger(boost::bind(&BinaryDataWriter::trigger_file, this));
+
+  options().add("asynchronous", true)
+    .pretty_name("Asynchronous")
+    .description("Copy the appended data and compress and write it in a background thread. The data is complete on disk after close is called.");
+
+  std::vector<boost::any> codecs;
+  BOOST_FOREACH(const std::string& codec, binary_data_codecs())
+  {
+    codecs.push_back(codec);
+  }
+  options().add("codec", std::string("zlib"))
+    .pretty_name("Codec")
+    .description("Encoding for the data blocks. With none, the data is stored uncompressed and aligned, so it can be used in place by a memory mapping BinaryDataReader.")
+    .restricted_list() = codecs;
+
+  options().add("compression_level", 0u)
+    .pretty_name("Compression Level")
+    .description("Compression level for the codec (1-9 for zlib, 1-22 for zstd). 0 selects the default level of the codec.");
+
+  options().add("shuffle", false)
+    .pretty_name("Shuffle")
+    .description("Shuffle the bytes of Real data before compressing, grouping the same byte of each value. This usually compresses floating point fields better.");
 }
 
 BinaryDataWriter::~BinaryDataWriter()
 {
-  close();
+  m_implementation.reset();
 }
 
 void BinaryDataWriter::close()
 {
-  m_implementation.reset();
+  if(is_not_null(m_implementation.get()))
+  {
+    m_implementation->close();
+    m_implementation.reset();
+  }
 }
 
 Uint BinaryDataWriter::write_data_block(const char* data, const std::streamsize count, const std::string& list_name, const Uint nb_rows, const Uint nb_cols, const std::string& type_name)
 {
   if(is_null(m_implementation.get()))
   {
-    m_implementation.reset(new Implementation(options().value<URI>("file")));
+    m_implementation.reset(new Implementation(options().value<URI>("file"), options().value<bool>("asynchronous"), options().value<std::string>("codec"), options().value<Uint>("compression_level"), options().value<bool>("shuffle")));
   }
 
   return m_implementation->write_data_block(data, count, list_name, nb_rows, nb_cols, type_name);
@@ -21,7 +21,10 @@ namespace common {
 ///////////////////////////////////////////////////////////////////////////////////////
 
   
-/// Component for writing binary data collected into a single file
+/// Component for writing binary data collected into a single file.
+/// By default, appended data is copied and then compressed and written by a background thread, so the caller can continue
+/// (and modify the original data) while the output is written. The block descriptions of all ranks are collected
+/// in a single collective operation when the file is closed, so close (or the destructor) must be called on all ranks.
 class Common_API BinaryDataWriter : public Component {
 
 public: // functions
@@ -48,7 +51,7 @@ public: // functions
     return write_data_block(reinterpret_cast<const char*>(list.array().data()), sizeof(T)*list.size(), list.name(), list.size(), 1, class_name<T>());
   }
 
-  /// Close the current file
+  /// Close the current file, waiting until all data is written
   void close();
 
 private:
@@ -4,6 +4,7 @@
 // GNU Lesser General Public License version 3.
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
 #include <sstream>
 #include <boost/cast.hpp>
 #include <boost/tokenizer.hpp>
@@ -52,6 +53,20 @@ ComponentBuilder < Component, Component, LibCommon > Component_Builder;
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+namespace
+{
+
+/// TreeUpdateBatch guards that currently exist, from outermost to innermost
+std::vector<TreeUpdateBatch*>& active_tree_update_batches()
+{
+  static std::vector<TreeUpdateBatch*> batches;
+  return batches;
+}
+
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 Component::Component ( const std::string& name ) :
     m_name (),
     m_properties(new PropertyList()),
@@ -1068,8 +1083,56 @@ void Component::signal_signature( SignalArgs & args )
 
 void Component::raise_tree_updated_event ()
 {
+  // the innermost TreeUpdateBatch around this component takes the event
+  std::vector<TreeUpdateBatch*>& batches = active_tree_update_batches();
+  for(std::vector<TreeUpdateBatch*>::reverse_iterator batch = batches.rbegin(); batch != batches.rend(); ++batch)
+  {
+    const Component* root = (*batch)->m_root.get();
+    for(const Component* comp = this; comp != 0; comp = comp->m_parent)
+    {
+      if(comp == root)
+      {
+        (*batch)->m_pending = true;
+        return;
+      }
+    }
+  }
+
+  // building the frame is only worth it if someone listens, which is not the case in batch runs
+  if( !EventHandler::instance().has_listeners("tree_updated") )
+    return;
+
   SignalFrame frame ( "tree_updated", uri(), uri() );
-  EventHandler::instance().raise_event("tree_updated", frame ); // no error if event doesn't exist
+  EventHandler::instance().raise_event("tree_updated", frame );
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+TreeUpdateBatch::TreeUpdateBatch(Component& root) :
+  m_root(root.handle()),
+  m_pending(false)
+{
+  active_tree_update_batches().push_back(this);
+}
+
+TreeUpdateBatch::~TreeUpdateBatch()
+{
+  std::vector<TreeUpdateBatch*>& batches = active_tree_update_batches();
+  std::vector<TreeUpdateBatch*>::iterator self = std::find(batches.begin(), batches.end(), this);
+  cf3_assert(self != batches.end());
+  batches.erase(self);
+
+  if(m_pending && is_not_null(m_root))
+  {
+    try
+    {
+      m_root->raise_tree_updated_event(); // coalesced further if an enclosing guard covers the root
+    }
+    catch(std::exception& e)
+    {
+      CFerror << "Error notifying the update of " << m_root->uri().path() << ": " << e.what() << CFendl;
+    }
+  }
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -448,8 +448,30 @@ protected: // functions
   template< class T, class Y > friend void boost::detail::sp_pointer_construct(boost::shared_ptr< T >*, Y*, boost::detail::shared_count&);
 #endif
   template<typename ComponentT> friend class BasicComponentRange;
+  friend class TreeUpdateBatch;
 }; // Component
 
+////////////////////////////////////////////////////////////////////////////////////////////
+
+/// Scoped guard that suppresses the "tree_updated" events of all components in the subtree of a root component.
+/// When the outermost guard of a subtree goes out of scope, a single "tree_updated" event is raised for its root
+/// if any event was suppressed. Use it around code that creates or removes many components, such as mesh readers.
+class Common_API TreeUpdateBatch : public boost::noncopyable
+{
+public:
+  /// Start suppressing the events of the subtree of root
+  TreeUpdateBatch(Component& root);
+
+  /// Raise one event for the root if events were suppressed, unless an enclosing guard takes over
+  ~TreeUpdateBatch();
+
+private:
+  Handle<Component> m_root;
+  /// True if an event was suppressed
+  bool m_pending;
+
+  friend class Component;
+};
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -12,6 +12,7 @@
 #include "common/Log.hpp"
 #include "common/Environment.hpp"
 #include "common/PropertyList.hpp"
+#include "common/Trace.hpp"
 
 namespace cf3 {
 namespace common {
@@ -102,6 +103,17 @@ Environment::Environment ( const std::string& name) : Component ( name )
       .mark_basic()
       .attach_trigger(boost::bind(&Environment::trigger_log_level,this));
 
+  options().add("trace", Trace::instance().enabled())
+      .pretty_name("Trace")
+      .description("If true, the wall time of actions, loops, solves, synchronizations and I/O is recorded in a hierarchical trace.")
+      .mark_basic()
+      .attach_trigger(boost::bind(&Environment::trigger_trace,this));
+
+  options().add("trace_max_events", Trace::instance().max_events())
+      .pretty_name("Trace Max Events")
+      .description("Maximum number of individual events kept in the trace for export to the Chrome trace format. 0 keeps only the statistics.")
+      .attach_trigger(boost::bind(&Environment::trigger_trace,this));
+
   trigger_log_level();
 
   // signals
@@ -180,5 +192,13 @@ void Environment::trigger_log_level()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void Environment::trigger_trace()
+{
+  Trace::instance().enabled(options().value<bool>("trace"));
+  Trace::instance().max_events(options().value<Uint>("trace_max_events"));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // common
 } // cf3
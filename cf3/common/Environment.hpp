@@ -51,6 +51,8 @@ private: // functions
 
   void trigger_log_level();
 
+  void trigger_trace();
+
 }; // Environment
 
 ////////////////////////////////////////////////////////////////////////////////
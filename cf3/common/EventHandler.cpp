@@ -5,6 +5,7 @@
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
 #include "common/EventHandler.hpp"
+#include "common/Signal.hpp"
 
 ////////////////////////////////////////////////////////////////////////////////
 
@@ -35,6 +36,13 @@ void EventHandler::raise_event( const std::string& ename, SignalArgs& args)
   call_signal(ename, args);
 }
 
+bool EventHandler::has_listeners( const std::string& ename ) const
+{
+  if ( signal_exists(ename) == false ) return false;
+
+  return !signal(ename)->signal()->empty();
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // common
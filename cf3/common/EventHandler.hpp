@@ -44,6 +44,10 @@ public: // methods
 
   /// raises an event and dispatches immedietly to all listeners
   void raise_event( const std::string& ename, SignalArgs& args);
+
+  /// true if the event exists and has at least one listener connected to it,
+  /// so callers can skip building the arguments of events nobody receives
+  bool has_listeners( const std::string& ename ) const;
   
 private:
   /// Constructor
@@ -55,7 +55,8 @@ public: // functions
   /// Contructor
   /// @param name of the component
   List ( const std::string& name ) :
-    Component ( name )
+    Component ( name ),
+    m_nb_views(0)
   {
 
   }
@@ -68,9 +69,20 @@ public: // functions
   /// @param[in] new_size The size allocated after resizing
   void resize(const Uint new_size)
   {
+    check_no_views();
     m_array.resize(boost::extents[new_size]);
   }
 
+  /// Register an external view on the array data, such as a Python buffer. Resizing throws while views exist,
+  /// since it would invalidate the memory the views refer to.
+  void add_view() const { ++m_nb_views; }
+
+  /// Unregister a view added using add_view
+  void remove_view() const { cf3_assert(m_nb_views != 0); --m_nb_views; }
+
+  /// Number of external views on the array data
+  Uint nb_views() const { return m_nb_views; }
+
   /// Modifiable access to the internal structure
   /// @return A reference to the array data
   ListT& array() { return m_array; }
@@ -115,6 +127,15 @@ private: // data
   /// storage of the array
   ListT m_array;
 
+  /// number of external views on the data
+  mutable Uint m_nb_views;
+
+  void check_no_views() const
+  {
+    if(m_nb_views != 0)
+      throw SetupError(FromHere(), "List " + uri().path() + " can't be resized while " + to_str(m_nb_views) + " external views of its data exist");
+  }
+
 };
 
 ////////////////////////////////////////////////////////////////////////////////
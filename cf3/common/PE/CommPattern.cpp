@@ -6,6 +6,8 @@
 
 ////////////////////////////////////////////////////////////////////////////////
 
+#include <algorithm>
+
 #include "boost/lexical_cast.hpp"
 
 #include "common/BoostAssertions.hpp"
@@ -13,6 +15,8 @@
 #include "common/FindComponents.hpp"
 #include "common/Builder.hpp"
 #include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/Trace.hpp"
 
 #include "common/PE/Comm.hpp"
 #include "common/PE/CommPattern.hpp"
@@ -51,17 +55,26 @@ CommPattern::CommPattern(const std::string& name): Component(name), m_gid(alloca
   m_sendCount(PE::Comm::instance().size(),0),
   m_sendMap(0),
   m_recvCount(PE::Comm::instance().size(),0),
-  m_recvMap(0)
+  m_recvMap(0),
+  m_is_synchronizing(false),
+  m_neighbour_item_size(0)
 {
   //self->regist_signal ( "update" , "Executes communication patterns on all the registered data.", "" ).connect ( boost::bind ( &CommPattern2::update, self, _1 ) );
   m_isUpToDate=false;
   m_isFreeze=false;
+
+  options().add("neighbour_exchange", true)
+    .pretty_name("Neighbour Exchange")
+    .description("Let synchronize_all send the data in one message per neighbouring rank through persistent point-to-point requests, instead of an all_to_all per registered data");
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
 CommPattern::~CommPattern()
 {
+  if (m_is_synchronizing && !m_neighbour_requests.empty() && PE::Comm::instance().is_active())
+    MPI_Waitall((int)m_neighbour_requests.size(),&m_neighbour_requests[0],MPI_STATUSES_IGNORE);
+  free_neighbour_exchange();
   if (m_gid.get()!=nullptr) m_gid->remove_tag("gid_of_"+this->name());
 }
 
@@ -270,6 +283,8 @@ PECheckPoint(1000,"004");
 
 void CommPattern::setup()
 {
+  if (m_is_synchronizing) throw common::ShouldNotBeHere(FromHere(),"Wanted to setup commpattern '" + name() + "' while a synchronization is in progress.");
+
 #define COMPUTE_IRANK(inode,nproc,nnode) ((((unsigned long long)(inode))*((unsigned long long)(nproc)))/((unsigned long long)(nnode)))
 #define COMPUTE_INODE(irank,nproc,nnode) (((unsigned long long)(nnode))>((unsigned long long)(nproc))?((((unsigned long long)(irank))*((unsigned long long)(nnode)))%((unsigned long long)(nproc))==0?(((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)):((((unsigned long long)(irank))*((unsigned long long)(nnode)))/((unsigned long long)(nproc)))+1ul):((unsigned long long)(irank)))
 
@@ -475,6 +490,9 @@ void CommPattern::setup()
     if (global_nelems[i]!=0)
       delete[] global[i];
 
+  // neighbours and maps may have changed
+  free_neighbour_exchange();
+
 #undef COMPUTE_IRANK
 #undef COMPUTE_INODE
 }
@@ -566,6 +584,15 @@ void CommPattern::setup()
 
 void CommPattern::synchronize_all()
 {
+  TraceScope trace_scope("synchronize");
+
+  if (options().value<bool>("neighbour_exchange"))
+  {
+    begin_synchronize_all();
+    end_synchronize();
+    return;
+  }
+
   std::vector<unsigned char> sndbuf(1);
   std::vector<unsigned char> rcvbuf(1);
   BOOST_FOREACH( CommWrapper& pobj, find_components_recursively<CommWrapper>(*this) )
@@ -576,8 +603,174 @@ void CommPattern::synchronize_all()
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void CommPattern::begin_synchronize_all()
+{
+  if (m_is_synchronizing) throw common::ShouldNotBeHere(FromHere(),"Synchronization of commpattern '" + name() + "' is already in progress.");
+  m_pending.clear();
+  BOOST_FOREACH( CommWrapper& pobj, find_components_recursively<CommWrapper>(*this) )
+    if ( pobj.needs_update() )
+      m_pending.push_back(pobj.handle<CommWrapper>());
+  start_neighbour_exchange();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::begin_synchronize( const std::vector<std::string>& names )
+{
+  if (m_is_synchronizing) throw common::ShouldNotBeHere(FromHere(),"Synchronization of commpattern '" + name() + "' is already in progress.");
+  m_pending.clear();
+  BOOST_FOREACH( const std::string& pobj_name, names )
+  {
+    Handle<CommWrapper> pobj(get_child(pobj_name));
+    if (is_null(pobj)) throw common::ValueNotFound(FromHere(),"No data named '" + pobj_name + "' is registered in commpattern '" + name() + "'.");
+    if ( pobj->needs_update() )
+      m_pending.push_back(pobj);
+  }
+  start_neighbour_exchange();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::end_synchronize()
+{
+  if (!m_is_synchronizing) throw common::ShouldNotBeHere(FromHere(),"No synchronization of commpattern '" + name() + "' is in progress.");
+
+  if (!m_neighbour_requests.empty())
+    MPI_CHECK_RESULT(MPI_Waitall,((int)m_neighbour_requests.size(),&m_neighbour_requests[0],MPI_STATUSES_IGNORE));
+
+  // unpack per neighbour, per object
+  Uint offset=0;
+  for (Uint n=0; n<m_neighbours.size(); ++n)
+  {
+    std::vector<int>& map=m_neighbour_recvmaps[n];
+    BOOST_FOREACH( const Handle<CommWrapper>& pobj, m_pending )
+    {
+      if (!map.empty()) pobj->unpack(&m_neighbour_rcvbuf[offset],map);
+      offset+=map.size()*pobj->size_of()*pobj->stride();
+    }
+  }
+
+  m_pending.clear();
+  m_is_synchronizing=false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::start_neighbour_exchange()
+{
+  Uint item_size=0;
+  BOOST_FOREACH( const Handle<CommWrapper>& pobj, m_pending )
+    item_size+=pobj->size_of()*pobj->stride();
+
+  m_is_synchronizing=true;
+  if (item_size==0) // nothing to do, but end_synchronize must still be called
+  {
+    m_pending.clear();
+    return;
+  }
+
+  if (item_size!=m_neighbour_item_size)
+    setup_neighbour_exchange(item_size);
+
+  // pack per neighbour, per object
+  Uint offset=0;
+  for (Uint n=0; n<m_neighbours.size(); ++n)
+  {
+    std::vector<int>& map=m_neighbour_sendmaps[n];
+    BOOST_FOREACH( const Handle<CommWrapper>& pobj, m_pending )
+    {
+      if (!map.empty()) pobj->pack(map,&m_neighbour_sndbuf[offset]);
+      offset+=map.size()*pobj->size_of()*pobj->stride();
+    }
+  }
+
+  if (!m_neighbour_requests.empty())
+    MPI_CHECK_RESULT(MPI_Startall,((int)m_neighbour_requests.size(),&m_neighbour_requests[0]));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::setup_neighbour_exchange(const Uint item_size)
+{
+  free_neighbour_exchange();
+
+  const CPint nproc=(CPint)PE::Comm::instance().size();
+  const Communicator comm=PE::Comm::instance().communicator();
+  const int tag=0;
+
+  // neighbours are the ranks appearing in the send or receive pattern
+  m_neighbours.clear();
+  for (int i=0; i<(const int)nproc; i++)
+    if ((m_sendCount[i]!=0)||(m_recvCount[i]!=0))
+      m_neighbours.push_back(i);
+
+  // split the maps per neighbour
+  std::vector<int> sendstarts(nproc+1,0);
+  std::vector<int> recvstarts(nproc+1,0);
+  for (int i=0; i<(const int)nproc; i++)
+  {
+    sendstarts[i+1]=sendstarts[i]+m_sendCount[i];
+    recvstarts[i+1]=recvstarts[i]+m_recvCount[i];
+  }
+  m_neighbour_sendmaps.resize(m_neighbours.size());
+  m_neighbour_recvmaps.resize(m_neighbours.size());
+  for (Uint n=0; n<m_neighbours.size(); ++n)
+  {
+    const int r=m_neighbours[n];
+    m_neighbour_sendmaps[n].assign(m_sendMap.begin()+sendstarts[r],m_sendMap.begin()+sendstarts[r+1]);
+    m_neighbour_recvmaps[n].assign(m_recvMap.begin()+recvstarts[r],m_recvMap.begin()+recvstarts[r+1]);
+  }
+
+  // buffers must not be reallocated while the persistent requests live
+  m_neighbour_sndbuf.resize(std::max<Uint>(m_sendMap.size()*item_size,1));
+  m_neighbour_rcvbuf.resize(std::max<Uint>(m_recvMap.size()*item_size,1));
+
+  // receives first, so that a neighbour's send finds the matching receive already posted
+  m_neighbour_requests.clear();
+  m_neighbour_requests.reserve(2*m_neighbours.size());
+  Uint offset=0;
+  for (Uint n=0; n<m_neighbours.size(); ++n)
+  {
+    const int count=m_neighbour_recvmaps[n].size()*item_size;
+    if (count!=0)
+    {
+      m_neighbour_requests.push_back(MPI_REQUEST_NULL);
+      MPI_CHECK_RESULT(MPI_Recv_init,(&m_neighbour_rcvbuf[offset],count,MPI_BYTE,m_neighbours[n],tag,comm,&m_neighbour_requests.back()));
+    }
+    offset+=count;
+  }
+  offset=0;
+  for (Uint n=0; n<m_neighbours.size(); ++n)
+  {
+    const int count=m_neighbour_sendmaps[n].size()*item_size;
+    if (count!=0)
+    {
+      m_neighbour_requests.push_back(MPI_REQUEST_NULL);
+      MPI_CHECK_RESULT(MPI_Send_init,(&m_neighbour_sndbuf[offset],count,MPI_BYTE,m_neighbours[n],tag,comm,&m_neighbour_requests.back()));
+    }
+    offset+=count;
+  }
+
+  m_neighbour_item_size=item_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void CommPattern::free_neighbour_exchange()
+{
+  if (PE::Comm::instance().is_active())
+    BOOST_FOREACH( Request& request, m_neighbour_requests )
+      if (request!=MPI_REQUEST_NULL)
+        MPI_Request_free(&request);
+  m_neighbour_requests.clear();
+  m_neighbour_item_size=0;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 void CommPattern::synchronize( const std::string& name )
 {
+  TraceScope trace_scope("synchronize");
   std::vector<unsigned char> sndbuf(1);
   std::vector<unsigned char> rcvbuf(1);
   Handle<CommWrapper> pobj(get_child(name));
@@ -588,6 +781,7 @@ void CommPattern::synchronize( const std::string& name )
 
 void CommPattern::synchronize( const CommWrapper& pobj )
 {
+  TraceScope trace_scope("synchronize");
   std::vector<unsigned char> sndbuf(1);
   std::vector<unsigned char> rcvbuf(1);
   synchronize_this(pobj,sndbuf,rcvbuf);
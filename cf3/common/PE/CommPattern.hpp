@@ -219,8 +219,29 @@ public:
   void setup();
 
   /// synchronize the all parallel objects
+  /// if the option neighbour_exchange is set, this is begin_synchronize_all() followed by end_synchronize()
   void synchronize_all();
 
+  /// start a non-blocking synchronization of all the parallel objects which need update
+  /// data of all the objects is packed into a single message per neighbouring rank,
+  /// which is exchanged through persistent point-to-point requests
+  /// ghost values must not be read and updatable values must not be modified before end_synchronize() is called
+  /// beware: collective, begin/end pairs of different commpatterns must be issued in the same order on all ranks
+  void begin_synchronize_all();
+
+  /// start a non-blocking synchronization of the parallel objects designated by their names
+  /// @param names the names of the parallel objects, must be the same on all ranks
+  /// @see begin_synchronize_all
+  void begin_synchronize( const std::vector<std::string>& names );
+
+  /// complete the synchronization started by begin_synchronize_all or begin_synchronize
+  /// blocks until all the messages of the neighbours arrived, then unpacks them into the ghosts
+  void end_synchronize();
+
+  /// accessor to check if a non-blocking synchronization is in progress
+  /// @return true between begin_synchronize_all (or begin_synchronize) and end_synchronize
+  bool is_synchronizing() const { return m_is_synchronizing; }
+
   /// synchronize the parallel object designated by its name
   /// @param name the name of the parallel object
   void synchronize( const std::string& name );
@@ -295,6 +316,17 @@ protected: // helper function
   /// @param rcvbuf vector for intermediate buffer for recieve
   void synchronize_this( const CommWrapper& pobj, std::vector<unsigned char>& sndbuf, std::vector<unsigned char>& rcvbuf );
 
+  /// packs the data of m_pending into the neighbour buffers and starts the persistent requests
+  /// the requests are rebuilt if the pattern or the size of the packed items changed since last call
+  void start_neighbour_exchange();
+
+  /// (re)builds the neighbour lists, the per-neighbour maps, the buffers and the persistent requests
+  /// @param item_size sum of size_of()*stride() of all the pending parallel objects, in bytes
+  void setup_neighbour_exchange(const Uint item_size);
+
+  /// frees the persistent requests, next exchange will rebuild them
+  void free_neighbour_exchange();
+
 private:
 
   /// @name PROPERTIES
@@ -349,6 +381,38 @@ private:
   /// Rank for all the gids in local index space
   std::vector<int> m_ranks;
 
+  /// @name NEIGHBOUR EXCHANGE
+  //@{
+
+  /// flag telling if a non-blocking synchronization is in progress
+  bool m_is_synchronizing;
+
+  /// parallel objects taking part in the synchronization in progress
+  std::vector< Handle<CommWrapper> > m_pending;
+
+  /// ranks which this rank sends to or receives from, the rest of the processes is not involved
+  std::vector<int> m_neighbours;
+
+  /// sending map split per neighbour, subset of m_sendMap
+  std::vector< std::vector<int> > m_neighbour_sendmaps;
+
+  /// receiving map split per neighbour, subset of m_recvMap
+  std::vector< std::vector<int> > m_neighbour_recvmaps;
+
+  /// aggregated send buffer, the data of all pending objects for a neighbour is contiguous
+  std::vector<unsigned char> m_neighbour_sndbuf;
+
+  /// aggregated receive buffer, same layout as m_neighbour_sndbuf
+  std::vector<unsigned char> m_neighbour_rcvbuf;
+
+  /// persistent requests, first the receives then the sends
+  std::vector<Request> m_neighbour_requests;
+
+  /// item size in bytes the persistent requests were built for, zero if they need to be rebuilt
+  Uint m_neighbour_item_size;
+
+  //@} END NEIGHBOUR EXCHANGE
+
 }; // CommPattern
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -46,6 +46,9 @@ typedef MPI_Op Operation;
 /// datatype
 typedef MPI_Datatype Datatype;
 
+/// request handle of non-blocking and persistent communication
+typedef MPI_Request Request;
+
 ////////////////////////////////////////////////////////////////////////////////
 
 } // namespace PE
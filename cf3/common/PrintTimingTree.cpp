@@ -7,6 +7,7 @@
 #include "common/Builder.hpp"
 #include "common/OptionList.hpp"
 #include "common/TimedComponent.hpp"
+#include "common/Trace.hpp"
 
 #include "PrintTimingTree.hpp"
 
@@ -24,12 +25,21 @@ PrintTimingTree::PrintTimingTree(const std::string& name): Action(name)
     .pretty_name("Root")
     .link_to(&m_root)
     .mark_basic();
+
+  options().add("chrome_trace", std::string())
+    .description("If not empty, the file to write the events of the trace to, in the Chrome trace format")
+    .pretty_name("Chrome Trace")
+    .mark_basic();
 }
 
 void PrintTimingTree::execute()
 {
   if(is_not_null(m_root))
     print_timing_tree(*m_root);
+
+  const std::string chrome_trace = options().value<std::string>("chrome_trace");
+  if(!chrome_trace.empty())
+    Trace::instance().write_chrome_trace(chrome_trace);
 }
 
 
@@ -65,7 +65,7 @@ public: // functions
 
   /// Contructor
   /// @param name of the component
-  Table ( const std::string& name )  : Component ( name ), m_pos(0)
+  Table ( const std::string& name )  : Component ( name ), m_pos(0), m_nb_views(0)
   {  }
 
   /// Get the component type name
@@ -77,6 +77,7 @@ public: // functions
   /// @param[in] nb_cols number of columns in the table.
   void set_row_size(const Uint nb_cols)
   {
+    check_no_views();
     m_array.resize(boost::extents[size()][nb_cols]);
   }
 
@@ -84,9 +85,20 @@ public: // functions
   /// @param[in] nb_rows The number of rows after resizing
   virtual void resize(const Uint nb_rows)
   {
+    check_no_views();
     m_array.resize(boost::extents[nb_rows][row_size()]);
   }
 
+  /// Register an external view on the array data, such as a Python buffer. Resizing throws while views exist,
+  /// since it would invalidate the memory the views refer to.
+  void add_view() const { ++m_nb_views; }
+
+  /// Unregister a view added using add_view
+  void remove_view() const { cf3_assert(m_nb_views != 0); --m_nb_views; }
+
+  /// Number of external views on the array data
+  Uint nb_views() const { return m_nb_views; }
+
   /// Modifiable access to the internal structure
   /// @return A reference to the array data
   ArrayT& array() { return m_array; }
@@ -165,6 +177,14 @@ private: // data
   ArrayT m_array;
   /// position when used as output stream
   Uint m_pos;
+  /// number of external views on the data
+  mutable Uint m_nb_views;
+
+  void check_no_views() const
+  {
+    if(m_nb_views != 0)
+      throw SetupError(FromHere(), "Table " + uri().path() + " can't be resized while " + to_str(m_nb_views) + " external views of its data exist");
+  }
 };
 
 /////////////////////////////////////////////////////////////////////////////////
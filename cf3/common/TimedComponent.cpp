@@ -11,6 +11,7 @@
 #include "common/Foreach.hpp"
 #include "common/PropertyList.hpp"
 #include "common/TimedComponent.hpp"
+#include "common/Trace.hpp"
 
 #include "common/PE/Comm.hpp"
 
@@ -103,8 +104,13 @@ void print_timing_tree(cf3::common::Component& root, const bool print_untimed, c
     print_timing_tree(component, print_untimed, prefix + "  ");
   }
 
-  if(prefix.empty() && PE::Comm::instance().rank() == 0)
-    std::cout << "</pre></body></html>]]></DartMeasurement>" << std::endl;
+  if(prefix.empty())
+  {
+    // Wall time of the always-on trace, which also covers loops, solves, synchronizations and I/O
+    Trace::instance().print_statistics(std::cout);
+    if(PE::Comm::instance().rank() == 0)
+      std::cout << "</pre></body></html>]]></DartMeasurement>" << std::endl;
+  }
 }
 
 
@@ -30,7 +30,7 @@ public:
 /// Store accumulated timings in properties for readout
 void store_timings(Component& root);
 
-/// Print timing tree based on the existing properties
+/// Print timing tree based on the existing properties, followed by the statistics of Trace::instance()
 void print_timing_tree(Component& root, const bool print_untimed = false, const std::string& prefix="");
 
 }
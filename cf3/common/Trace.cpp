@@ -0,0 +1,368 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/StringConversion.hpp"
+#include "common/Trace.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#ifdef CF3_OS_LINUX
+extern "C"
+{
+  #include <time.h>
+}
+#endif
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+/// Wall clock time in seconds, from an arbitrary origin
+Real wall_time()
+{
+#ifdef CF3_OS_LINUX
+  timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return static_cast<Real>(now.tv_sec) + 1e-9*static_cast<Real>(now.tv_nsec);
+#else
+  static const boost::posix_time::ptime origin = boost::posix_time::microsec_clock::universal_time();
+  return 1e-6*static_cast<Real>((boost::posix_time::microsec_clock::universal_time() - origin).total_microseconds());
+#endif
+}
+
+/// Collect a string from every process on rank 0, in rank order
+std::vector<std::string> gather_on_root(const std::string& local)
+{
+  std::vector<std::string> result;
+  if(!PE::Comm::instance().is_active() || PE::Comm::instance().size() == 1)
+  {
+    result.push_back(local);
+    return result;
+  }
+
+  const Uint nb_procs = PE::Comm::instance().size();
+  std::vector< std::vector<char> > send(nb_procs), recv;
+  send[0].assign(local.begin(), local.end());
+  PE::Comm::instance().all_to_all(send, recv);
+
+  if(PE::Comm::instance().rank() == 0)
+  {
+    for(Uint rank = 0; rank != nb_procs; ++rank)
+      result.push_back(std::string(recv[rank].begin(), recv[rank].end()));
+  }
+  return result;
+}
+
+/// Scope of the trees of all processes, merged on rank 0
+struct MergedNode
+{
+  MergedNode(const std::string& node_name, const Uint nb_procs) : name(node_name), counts(nb_procs, 0), times(nb_procs, 0.) {}
+  std::string name;
+  std::vector<Uint> children;
+  std::vector<Uint> counts;
+  std::vector<Real> times;
+};
+
+void collect_statistics(const std::vector<MergedNode>& nodes, const Uint node, const std::string& parent_path, const Uint depth, std::vector<TraceStatistics>& result)
+{
+  const MergedNode& merged = nodes[node];
+  const Uint nb_procs = merged.counts.size();
+
+  TraceStatistics stats;
+  stats.path = parent_path.empty() ? merged.name : parent_path + "/" + merged.name;
+  stats.depth = depth;
+  stats.nb_ranks = nb_procs - std::count(merged.counts.begin(), merged.counts.end(), 0u);
+  stats.min_count = *std::min_element(merged.counts.begin(), merged.counts.end());
+  stats.max_count = *std::max_element(merged.counts.begin(), merged.counts.end());
+  stats.min_time = *std::min_element(merged.times.begin(), merged.times.end());
+  stats.max_time = *std::max_element(merged.times.begin(), merged.times.end());
+  stats.mean_time = 0.;
+  for(Uint rank = 0; rank != nb_procs; ++rank)
+    stats.mean_time += merged.times[rank];
+  stats.mean_time /= static_cast<Real>(nb_procs);
+  stats.imbalance = stats.mean_time > 0. ? stats.max_time / stats.mean_time : 1.;
+  result.push_back(stats);
+
+  for(std::vector<Uint>::const_iterator child = merged.children.begin(); child != merged.children.end(); ++child)
+    collect_statistics(nodes, *child, stats.path, depth+1, result);
+}
+
+/// Escape a string for use in JSON
+std::string json_string(const std::string& str)
+{
+  std::string result("\"");
+  for(std::string::const_iterator c = str.begin(); c != str.end(); ++c)
+  {
+    if(*c == '"' || *c == '\\')
+      result.push_back('\\');
+    result.push_back(*c);
+  }
+  result.push_back('"');
+  return result;
+}
+
+} // namespace
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+Trace& Trace::instance()
+{
+  static Trace trace;
+  return trace;
+}
+
+Trace::Trace() :
+  m_max_events(100000),
+  m_nb_dropped_events(0),
+  m_enabled(true),
+  m_origin(wall_time())
+{
+  m_nodes.push_back(Node("", 0));
+}
+
+Real Trace::now() const
+{
+  return wall_time() - m_origin;
+}
+
+void Trace::enter(const std::string& name)
+{
+  if(!m_enabled)
+  {
+    m_stack.push_back(ignored_scope());
+    m_start_times.push_back(0.);
+    return;
+  }
+
+  // Innermost scope that is being recorded
+  Uint parent = 0;
+  for(std::vector<Uint>::const_reverse_iterator it = m_stack.rbegin(); it != m_stack.rend(); ++it)
+  {
+    if(*it != ignored_scope())
+    {
+      parent = *it;
+      break;
+    }
+  }
+
+  Uint node = 0;
+  const std::vector<Uint>& children = m_nodes[parent].children;
+  for(std::vector<Uint>::const_iterator child = children.begin(); child != children.end(); ++child)
+  {
+    if(m_nodes[*child].name == name)
+    {
+      node = *child;
+      break;
+    }
+  }
+  if(node == 0)
+  {
+    node = m_nodes.size();
+    m_nodes.push_back(Node(name, parent));
+    m_nodes[parent].children.push_back(node);
+  }
+
+  m_stack.push_back(node);
+  m_start_times.push_back(now());
+}
+
+void Trace::leave()
+{
+  if(m_stack.empty())
+    return;
+
+  const Uint node = m_stack.back();
+  const Real start = m_start_times.back();
+  m_stack.pop_back();
+  m_start_times.pop_back();
+  if(node == ignored_scope())
+    return;
+
+  const Real duration = now() - start;
+  Node& timed = m_nodes[node];
+  ++timed.count;
+  timed.total += duration;
+
+  if(m_events.size() < m_max_events)
+  {
+    const Event event = { node, start, duration };
+    m_events.push_back(event);
+  }
+  else
+  {
+    ++m_nb_dropped_events;
+  }
+}
+
+void Trace::max_events(const Uint nb_events)
+{
+  m_max_events = nb_events;
+  if(m_events.size() > m_max_events)
+  {
+    m_nb_dropped_events += m_events.size() - m_max_events;
+    m_events.resize(m_max_events);
+  }
+}
+
+void Trace::reset()
+{
+  if(!m_stack.empty())
+    throw SetupError(FromHere(), "Trace can't be reset while " + to_str(m_stack.size()) + " scopes are open");
+
+  m_nodes.clear();
+  m_nodes.push_back(Node("", 0));
+  m_events.clear();
+  m_nb_dropped_events = 0;
+  m_origin = wall_time();
+}
+
+std::string Trace::path(const Uint node) const
+{
+  std::string result = m_nodes[node].name;
+  for(Uint parent = m_nodes[node].parent; parent != 0; parent = m_nodes[parent].parent)
+    result = m_nodes[parent].name + "/" + result;
+  return result;
+}
+
+std::vector<TraceStatistics> Trace::statistics() const
+{
+  // Serialize the tree depth-first, one line per scope: depth, count, time and name
+  std::ostringstream local;
+  local << std::setprecision(17);
+  std::vector< std::pair<Uint, Uint> > todo; // node and depth
+  for(std::vector<Uint>::const_reverse_iterator child = m_nodes[0].children.rbegin(); child != m_nodes[0].children.rend(); ++child)
+    todo.push_back(std::make_pair(*child, 0u));
+  while(!todo.empty())
+  {
+    const Uint node = todo.back().first;
+    const Uint depth = todo.back().second;
+    todo.pop_back();
+    local << depth << " " << m_nodes[node].count << " " << m_nodes[node].total << " " << m_nodes[node].name << "\n";
+    for(std::vector<Uint>::const_reverse_iterator child = m_nodes[node].children.rbegin(); child != m_nodes[node].children.rend(); ++child)
+      todo.push_back(std::make_pair(*child, depth+1));
+  }
+
+  const std::vector<std::string> trees = gather_on_root(local.str());
+  std::vector<TraceStatistics> result;
+  if(trees.empty())
+    return result;
+
+  // Merge the trees by name, in the order the scopes appear on the lowest rank that has them
+  const Uint nb_procs = trees.size();
+  std::vector<MergedNode> merged(1, MergedNode("", nb_procs));
+  for(Uint rank = 0; rank != nb_procs; ++rank)
+  {
+    std::istringstream tree(trees[rank]);
+    std::vector<Uint> stack(1, 0); // merged node for each depth, offset by one for the root
+    Uint depth, count;
+    Real time;
+    std::string name;
+    while(tree >> depth >> count >> time && std::getline(tree.ignore(1), name))
+    {
+      stack.resize(depth+1);
+      const Uint parent = stack.back();
+      Uint node = 0;
+      for(std::vector<Uint>::const_iterator child = merged[parent].children.begin(); child != merged[parent].children.end(); ++child)
+      {
+        if(merged[*child].name == name)
+        {
+          node = *child;
+          break;
+        }
+      }
+      if(node == 0)
+      {
+        node = merged.size();
+        merged.push_back(MergedNode(name, nb_procs));
+        merged[parent].children.push_back(node);
+      }
+      merged[node].counts[rank] = count;
+      merged[node].times[rank] = time;
+      stack.push_back(node);
+    }
+  }
+
+  for(std::vector<Uint>::const_iterator child = merged[0].children.begin(); child != merged[0].children.end(); ++child)
+    collect_statistics(merged, *child, "", 0, result);
+
+  return result;
+}
+
+void Trace::print_statistics(std::ostream& os) const
+{
+  const std::vector<TraceStatistics> stats = statistics();
+  if(PE::Comm::instance().is_active() && PE::Comm::instance().rank() != 0)
+    return;
+
+  const Uint nb_procs = PE::Comm::instance().is_active() ? PE::Comm::instance().size() : 1u;
+  os << "Wall time in seconds, with [min, mean, max] over " << nb_procs << " CPUs\n";
+  for(std::vector<TraceStatistics>::const_iterator it = stats.begin(); it != stats.end(); ++it)
+  {
+    const std::string::size_type name_begin = it->path.find_last_of('/');
+    os << std::string(2*it->depth, ' ') << (name_begin == std::string::npos ? it->path : it->path.substr(name_begin+1))
+       << ": [" << it->min_time << ", " << it->mean_time << ", " << it->max_time << "]"
+       << ", imbalance: " << it->imbalance
+       << ", count: " << it->min_count;
+    if(it->max_count != it->min_count)
+      os << "-" << it->max_count;
+    os << "\n";
+  }
+  os << std::flush;
+}
+
+void Trace::write_chrome_trace(const std::string& file_name) const
+{
+  const Uint rank = PE::Comm::instance().is_active() ? PE::Comm::instance().rank() : 0;
+
+  // Complete events ("X"), with times in microseconds
+  std::ostringstream local;
+  local << std::fixed << std::setprecision(3);
+  local << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank << ",\"tid\":0,\"args\":{\"name\":\"rank " << rank << "\"}}";
+  for(std::vector<Event>::const_iterator event = m_events.begin(); event != m_events.end(); ++event)
+  {
+    local << ",\n{\"name\":" << json_string(m_nodes[event->node].name)
+          << ",\"cat\":\"cf3\",\"ph\":\"X\",\"ts\":" << 1e6*event->start << ",\"dur\":" << 1e6*event->duration
+          << ",\"pid\":" << rank << ",\"tid\":0,\"args\":{\"path\":" << json_string(path(event->node)) << "}}";
+  }
+
+  const std::vector<std::string> all_events = gather_on_root(local.str());
+  if(rank != 0)
+    return;
+
+  std::ofstream file(file_name.c_str());
+  if(!file)
+    throw FileSystemError(FromHere(), "Could not open " + file_name + " for writing");
+
+  file << "{\"traceEvents\":[\n";
+  for(Uint i = 0; i != all_events.size(); ++i)
+  {
+    if(i != 0)
+      file << ",\n";
+    file << all_events[i];
+  }
+  file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+}
+
+/////////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+/////////////////////////////////////////////////////////////////////////////////////
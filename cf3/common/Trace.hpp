@@ -0,0 +1,157 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_common_Trace_hpp
+#define cf3_common_Trace_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+#include <boost/noncopyable.hpp>
+
+#include "common/CF.hpp"
+#include "common/CommonAPI.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace common {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Timing of one scope of the trace tree, aggregated over all processes
+struct Common_API TraceStatistics
+{
+  /// Names of the enclosing scopes and of the scope itself, separated by "/"
+  std::string path;
+  /// Nesting depth, 0 for the outermost scopes
+  Uint depth;
+  /// Number of processes that entered the scope
+  Uint nb_ranks;
+  /// Minimum and maximum number of times a process entered the scope
+  Uint min_count;
+  Uint max_count;
+  /// Minimum, mean and maximum over the processes of the total wall time spent in the scope, in seconds.
+  /// Processes that never entered the scope count as 0 s.
+  Real min_time;
+  Real mean_time;
+  Real max_time;
+  /// max_time / mean_time, 1 when perfectly balanced
+  Real imbalance;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Lightweight hierarchical timing of named code regions, always compiled in.
+/// Each process keeps a tree of scopes, identified by their name and the scope they are nested in,
+/// with the number of times they were entered and the accumulated wall time. The tree is updated with
+/// two clock reads and a search among the children of the current scope, so it can stay on in production runs.
+/// Optionally, the individual scope executions are kept as events, up to a maximum number, for
+/// export to the Chrome trace format (chrome://tracing, Perfetto).
+///
+/// Scopes are opened and closed through TraceScope, from the main thread only.
+/// Both statistics() and write_chrome_trace() are collective over PE::Comm when it is active.
+class Common_API Trace : public boost::noncopyable
+{
+public:
+
+  static Trace& instance();
+
+  /// Open a scope nested in the current scope
+  void enter(const std::string& name);
+
+  /// Close the current scope
+  void leave();
+
+  /// Switch the recording on or off. Scopes that are open when switching off are still closed properly.
+  void enabled(const bool enable) { m_enabled = enable; }
+  bool enabled() const { return m_enabled; }
+
+  /// Maximum number of events kept for write_chrome_trace(). 0 keeps only the statistics.
+  void max_events(const Uint nb_events);
+  Uint max_events() const { return m_max_events; }
+
+  /// Number of events that were not kept because the maximum was reached
+  Uint nb_dropped_events() const { return m_nb_dropped_events; }
+
+  /// Forget all timings and events. Must not be called while scopes are open.
+  void reset();
+
+  /// Statistics of all scopes entered on any process, in depth-first order.
+  /// Collective, the result is complete on rank 0 only.
+  std::vector<TraceStatistics> statistics() const;
+
+  /// Print the statistics as an indented tree on rank 0. Collective.
+  void print_statistics(std::ostream& os) const;
+
+  /// Write the events of all processes to a file in the Chrome trace JSON format, one "pid" per rank.
+  /// The file is written by rank 0. Collective.
+  void write_chrome_trace(const std::string& file_name) const;
+
+private:
+
+  Trace();
+
+  struct Node
+  {
+    Node(const std::string& node_name, const Uint node_parent) : name(node_name), parent(node_parent), count(0), total(0.) {}
+    std::string name;
+    Uint parent;
+    std::vector<Uint> children;
+    Uint count;
+    Real total;
+  };
+
+  struct Event
+  {
+    Uint node;
+    Real start;
+    Real duration;
+  };
+
+  /// Seconds since the construction of the trace
+  Real now() const;
+
+  /// Path of a node, as used in TraceStatistics
+  std::string path(const Uint node) const;
+
+  /// Node 0 is the root, which is never timed
+  std::vector<Node> m_nodes;
+  /// Open scopes, with their start times. Scopes entered while the recording was off are stored as
+  /// ignored_scope(), so they are ignored when closed.
+  std::vector<Uint> m_stack;
+  std::vector<Real> m_start_times;
+  static Uint ignored_scope() { return static_cast<Uint>(-1); }
+
+  std::vector<Event> m_events;
+  Uint m_max_events;
+  Uint m_nb_dropped_events;
+
+  bool m_enabled;
+  Real m_origin;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Times the enclosing block as a scope of Trace::instance()
+class Common_API TraceScope : public boost::noncopyable
+{
+public:
+  explicit TraceScope(const std::string& name) { Trace::instance().enter(name); }
+  ~TraceScope() { Trace::instance().leave(); }
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // common
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_common_Trace_hpp
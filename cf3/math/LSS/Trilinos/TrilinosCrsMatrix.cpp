@@ -9,6 +9,7 @@
 #include <iostream>
 #include <set>
 
+#include <boost/bind.hpp>
 #include <boost/pointer_cast.hpp>
 
 #include "Teuchos_ConfigDefs.hpp"
@@ -70,9 +71,17 @@ TrilinosCrsMatrix::TrilinosCrsMatrix(const std::string& name) :
   m_num_my_elements(0),
   m_p2m(0),
   m_converted_indices(0),
-  m_comm(common::PE::Comm::instance().communicator())
+  m_comm(common::PE::Comm::instance().communicator()),
+  m_cached_assembly(false),
+  m_assembly_cache_position(0)
 {
   properties().add("vector_type", std::string("cf3.math.LSS.TrilinosVector"));
+
+  options().add("cached_assembly", m_cached_assembly)
+    .pretty_name("Cached Assembly")
+    .description("Store the location in the matrix of each entry added through add_values, so later assemblies with the same sparsity pattern and insertion order skip the column search")
+    .link_to(&m_cached_assembly)
+    .attach_trigger(boost::bind(&TrilinosCrsMatrix::clear_assembly_cache, this));
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -91,6 +100,7 @@ void TrilinosCrsMatrix::create_blocked(common::PE::CommPattern& cp, const Variab
 {
   // if already created
   if (m_is_created) destroy();
+  clear_assembly_cache();
 
   // Copy node connectivity
   m_node_connectivity.resize(node_connectivity.size());
@@ -159,6 +169,7 @@ void TrilinosCrsMatrix::destroy()
   m_neq=0;
   m_num_my_elements=0;
   m_is_created=false;
+  clear_assembly_cache();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -228,6 +239,11 @@ void TrilinosCrsMatrix::set_values(const BlockAccumulator& values)
 void TrilinosCrsMatrix::add_values(const BlockAccumulator& values)
 {
   cf3_assert(m_is_created);
+  if(m_cached_assembly && m_mat->StorageOptimized())
+  {
+    add_values_cached(values);
+    return;
+  }
   const Uint nb_nodes = values.indices.size();
   const int num_entries = nb_nodes*m_neq;
   cf3_assert(values.mat.rows() == num_entries);
@@ -251,6 +267,89 @@ void TrilinosCrsMatrix::add_values(const BlockAccumulator& values)
 
 ////////////////////////////////////////////////////////////////////////////////////////////
 
+void TrilinosCrsMatrix::add_values_cached(const BlockAccumulator& values)
+{
+  const Uint nb_nodes = values.indices.size();
+  const int num_entries = nb_nodes*m_neq;
+  const int nb_values = num_entries*num_entries;
+  cf3_assert(values.mat.rows() == num_entries);
+
+  int* index_offsets;
+  int* col_indices;
+  Real* matrix_values;
+  TRILINOS_THROW(m_mat->ExtractCrsDataPointers(index_offsets, col_indices, matrix_values));
+
+  // The cache can be used if the previous assembly added values for the same nodes at this point
+  const Uint cache_size = 1 + nb_nodes + nb_values;
+  bool cache_hit = m_assembly_cache_position + cache_size <= m_assembly_cache.size() && static_cast<Uint>(m_assembly_cache[m_assembly_cache_position]) == nb_nodes;
+  for(Uint i = 0; cache_hit && i != nb_nodes; ++i)
+    cache_hit = static_cast<Uint>(m_assembly_cache[m_assembly_cache_position + 1 + i]) == values.indices[i];
+
+  // Otherwise, the rest of the cache is no longer valid
+  if(!cache_hit)
+  {
+    m_assembly_cache.resize(m_assembly_cache_position);
+    cache_value_offsets(values, index_offsets, col_indices);
+  }
+
+  const int* offsets = &m_assembly_cache[m_assembly_cache_position + 1 + nb_nodes];
+  const Real* element_values = values.mat.data();
+  for(int i = 0; i != nb_values; ++i)
+  {
+    if(offsets[i] >= 0)
+      matrix_values[offsets[i]] += element_values[i];
+  }
+
+  m_assembly_cache_position += cache_size;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosCrsMatrix::cache_value_offsets(const BlockAccumulator& values, const int* index_offsets, const int* col_indices)
+{
+  const Uint nb_nodes = values.indices.size();
+  const int num_entries = nb_nodes*m_neq;
+
+  m_assembly_cache.push_back(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    m_assembly_cache.push_back(values.indices[i]);
+    const Uint local_start_idx = values.indices[i]*m_neq;
+    for(int j = 0; j != m_neq; ++j)
+      m_converted_indices[i*m_neq+j] = m_p2m[local_start_idx+j];
+  }
+
+  for(int i = 0; i != num_entries; ++i)
+  {
+    const int row = m_converted_indices[i];
+    if(row >= m_num_my_elements)
+    {
+      m_assembly_cache.insert(m_assembly_cache.end(), num_entries, -1);
+      continue;
+    }
+
+    const int* row_begin = col_indices + index_offsets[row];
+    const int* row_end = col_indices + index_offsets[row+1];
+    for(int j = 0; j != num_entries; ++j)
+    {
+      const int* col = std::find(row_begin, row_end, m_converted_indices[j]);
+      if(col == row_end)
+        throw common::BadValue(FromHere(),"Trying to access an illegal entry.");
+      m_assembly_cache.push_back(col - col_indices);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
+void TrilinosCrsMatrix::clear_assembly_cache()
+{
+  m_assembly_cache.clear();
+  m_assembly_cache_position = 0;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////
+
 void TrilinosCrsMatrix::get_values(BlockAccumulator& values)
 {
   cf3_assert(m_is_created);
@@ -511,6 +610,9 @@ void TrilinosCrsMatrix::reset(Real reset_to)
 
   m_symmetric_dirichlet_values.clear();
   m_dirichlet_nodes.clear();
+
+  // The next add_values call starts a new assembly
+  m_assembly_cache_position = 0;
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -533,6 +635,7 @@ void TrilinosCrsMatrix::clone_to(Matrix &other)
   other_ptr->m_node_connectivity = m_node_connectivity;
   other_ptr->m_starting_indices = m_starting_indices;
   other_ptr->m_symmetric_dirichlet_values = m_symmetric_dirichlet_values;
+  other_ptr->clear_assembly_cache();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -542,6 +645,7 @@ void TrilinosCrsMatrix::read_native(const common::URI& file)
   EpetraExt::readEpetraLinearSystem(file.path(), m_comm, &m_mat);
   
   m_is_created = true;
+  clear_assembly_cache();
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
@@ -87,6 +87,8 @@ public:
   /// Add a list of values
   /// local ibdices
   /// eigen, templatization on top level
+  /// If the cached_assembly option is set, the offsets into the matrix value array are stored for each call,
+  /// and reused when the next assembly (i.e. after a reset) adds values for the same nodes in the same order
   void add_values(const BlockAccumulator& values);
 
   /// Add a list of values
@@ -163,6 +165,7 @@ public:
   void replace_epetra_matrix(const Teuchos::RCP<Epetra_CrsMatrix>& mat)
   {
     m_mat = mat;
+    clear_assembly_cache();
   }
   
   /// Store the local matrix GIDs belonging to each variable in the given vector
@@ -204,6 +207,15 @@ public:
 
 private:
 
+  /// Add values using the offsets into the CRS value array stored in m_assembly_cache
+  void add_values_cached(const BlockAccumulator& values);
+
+  /// Append the node indices and value offsets for the given values to m_assembly_cache
+  void cache_value_offsets(const BlockAccumulator& values, const int* index_offsets, const int* col_indices);
+
+  /// Discard the cached value offsets, called when the matrix structure changes
+  void clear_assembly_cache();
+
   /// teuchos style smart pointer wrapping the matrix
   Teuchos::RCP<Epetra_CrsMatrix> m_mat;
 
@@ -234,6 +246,16 @@ private:
   DirichletMapT m_symmetric_dirichlet_values;
 
   std::vector< std::pair<Uint,Uint> > m_dirichlet_nodes;
+
+  /// True if add_values should cache the value offsets
+  bool m_cached_assembly;
+
+  /// For each add_values call since the last reset: the number of nodes, the node indices and the offset into the CRS value array
+  /// for each entry of the element matrix, in row-major order. The offset is -1 for rows that are not owned by this rank.
+  std::vector<int> m_assembly_cache;
+
+  /// Position in m_assembly_cache of the data for the next add_values call
+  Uint m_assembly_cache_position;
 }; // end of class Matrix
 
 ////////////////////////////////////////////////////////////////////////////////////////////
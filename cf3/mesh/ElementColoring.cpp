@@ -0,0 +1,175 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <limits>
+
+#include "common/Builder.hpp"
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/Signal.hpp"
+#include "common/XML/SignalOptions.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+using namespace common::XML;
+
+common::ComponentBuilder < ElementColoring, Component, LibMesh > ElementColoring_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementColoring::ElementColoring(const std::string& name) :
+  Component(name),
+  m_valid(false)
+{
+  Core::instance().event_handler().connect_to_event(Tags::event_mesh_changed(), this, &ElementColoring::on_mesh_changed_event);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementColoring::~ElementColoring()
+{
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementColoring::build(const Elements& elements)
+{
+  const Connectivity& connectivity = elements.geometry_space().connectivity();
+  const Dictionary& geometry = elements.geometry_fields();
+  const Uint nb_elems = connectivity.size();
+  const Uint nb_nodes = geometry.size();
+  const Uint invalid = std::numeric_limits<Uint>::max();
+
+  // Resolve periodic links, so periodic node pairs count as the same node
+  std::vector<Uint> node_map(nb_nodes);
+  for(Uint i = 0; i != nb_nodes; ++i)
+    node_map[i] = i;
+  Handle< List<Uint> const > periodic_links_nodes_h(geometry.get_child("periodic_links_nodes"));
+  Handle< List<bool> const > periodic_links_active_h(geometry.get_child("periodic_links_active"));
+  if(is_not_null(periodic_links_nodes_h) && is_not_null(periodic_links_active_h))
+  {
+    const List<Uint>& periodic_links_nodes = *periodic_links_nodes_h;
+    const List<bool>& periodic_links_active = *periodic_links_active_h;
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      Uint target = i;
+      while(periodic_links_active[target])
+        target = periodic_links_nodes[target];
+      node_map[i] = target;
+    }
+  }
+
+  // Node to element connectivity, in compressed row format
+  std::vector<Uint> node_starts(nb_nodes+1, 0);
+  for(Uint e = 0; e != nb_elems; ++e)
+    BOOST_FOREACH(const Uint node, connectivity[e])
+      ++node_starts[node_map[node]+1];
+  for(Uint i = 0; i != nb_nodes; ++i)
+    node_starts[i+1] += node_starts[i];
+  std::vector<Uint> node_elements(node_starts.back());
+  std::vector<Uint> fill_pos(node_starts.begin(), node_starts.end()-1);
+  for(Uint e = 0; e != nb_elems; ++e)
+    BOOST_FOREACH(const Uint node, connectivity[e])
+      node_elements[fill_pos[node_map[node]]++] = e;
+
+  // Greedy coloring: each element gets the lowest color not used by a neighbour sharing a node
+  m_colors.assign(nb_elems, invalid);
+  std::vector<Uint> color_marker; // color_marker[c] == e if color c is taken by a neighbour of e
+  Uint nb_colors = 0;
+  for(Uint e = 0; e != nb_elems; ++e)
+  {
+    BOOST_FOREACH(const Uint node, connectivity[e])
+    {
+      const Uint mapped_node = node_map[node];
+      for(Uint i = node_starts[mapped_node]; i != node_starts[mapped_node+1]; ++i)
+      {
+        const Uint neighbour_color = m_colors[node_elements[i]];
+        if(neighbour_color != invalid)
+          color_marker[neighbour_color] = e;
+      }
+    }
+    Uint color = 0;
+    while(color != nb_colors && color_marker[color] == e)
+      ++color;
+    if(color == nb_colors)
+    {
+      ++nb_colors;
+      color_marker.push_back(invalid);
+    }
+    m_colors[e] = color;
+  }
+
+  // Group the elements per color
+  m_color_starts.assign(nb_colors+1, 0);
+  for(Uint e = 0; e != nb_elems; ++e)
+    ++m_color_starts[m_colors[e]+1];
+  for(Uint c = 0; c != nb_colors; ++c)
+    m_color_starts[c+1] += m_color_starts[c];
+  m_elements.resize(nb_elems);
+  fill_pos.assign(m_color_starts.begin(), m_color_starts.end()-1);
+  for(Uint e = 0; e != nb_elems; ++e)
+    m_elements[fill_pos[m_colors[e]]++] = e;
+
+  m_valid = true;
+
+  CFdebug << "Colored " << nb_elems << " elements of " << elements.uri().path() << " using " << nb_colors << " colors" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementColoring::is_valid(const Elements& elements) const
+{
+  return m_valid && m_colors.size() == elements.size();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementColoring::on_mesh_changed_event(SignalArgs& args)
+{
+  if(!m_valid)
+    return;
+
+  Handle<Mesh const> mesh = find_parent_component_ptr<Mesh>(*this);
+  if(is_null(mesh))
+    return;
+
+  SignalOptions options(args);
+  if(options.value<URI>("mesh_uri") == mesh->uri())
+    m_valid = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const ElementColoring& element_coloring(Elements& elements)
+{
+  Handle<ElementColoring> coloring(elements.get_child("element_coloring"));
+  if(is_null(coloring))
+    coloring = elements.create_component<ElementColoring>("element_coloring");
+  if(!coloring->is_valid(elements))
+    coloring->build(elements);
+  return *coloring;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,89 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementColoring_hpp
+#define cf3_mesh_ElementColoring_hpp
+
+#include "common/Component.hpp"
+#include "common/SignalHandler.hpp"
+
+#include "mesh/LibMesh.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+class Elements;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Partition of an Elements component into colors, so that no two elements with the same
+/// color share a node. Elements of the same color can then be processed concurrently, even
+/// if they accumulate into nodal data.
+/// Nodes linked through periodic boundaries count as a single node.
+/// The coloring is stored under the Elements it applies to, and invalidated when the mesh changes.
+/// @see element_coloring to obtain an up-to-date coloring
+class Mesh_API ElementColoring : public common::Component
+{
+public:
+
+  /// Contructor
+  /// @param name of the component
+  ElementColoring ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~ElementColoring();
+
+  /// Get the class name
+  static std::string type_name () { return "ElementColoring"; }
+
+  /// Compute the coloring for the given elements, which must be the parent of this component
+  void build(const Elements& elements);
+
+  /// True if the coloring was built and the mesh did not change since
+  bool is_valid(const Elements& elements) const;
+
+  /// Number of colors
+  Uint nb_colors() const { return m_color_starts.empty() ? 0 : m_color_starts.size() - 1; }
+
+  /// Number of elements with the given color
+  Uint nb_elements(const Uint color) const { return m_color_starts[color+1] - m_color_starts[color]; }
+
+  /// Element indices with the given color, sorted in ascending order
+  const Uint* elements_begin(const Uint color) const { return m_elements.empty() ? 0 : &m_elements[m_color_starts[color]]; }
+  const Uint* elements_end(const Uint color) const { return m_elements.empty() ? 0 : &m_elements[0] + m_color_starts[color+1]; }
+
+  /// Color of each element
+  const std::vector<Uint>& colors() const { return m_colors; }
+
+  /// Invalidate the coloring when the mesh it belongs to has changed
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+private:
+  /// Element indices, grouped per color
+  std::vector<Uint> m_elements;
+  /// Start of each color in m_elements, with one extra entry at the end
+  std::vector<Uint> m_color_starts;
+  /// Color of each element
+  std::vector<Uint> m_colors;
+  /// False if the mesh changed since the last build
+  bool m_valid;
+}; // ElementColoring
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Get the coloring of the given elements, building it if it does not exist or the mesh changed
+Mesh_API const ElementColoring& element_coloring(Elements& elements);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementColoring_hpp
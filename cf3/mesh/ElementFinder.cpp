@@ -11,6 +11,7 @@
 
 #include "mesh/ElementFinder.hpp"
 #include "mesh/Dictionary.hpp"
+#include "mesh/Space.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -28,5 +29,22 @@ ElementFinder::ElementFinder(const std::string &name) : common::Component(name)
 
 ////////////////////////////////////////////////////////////////////////////////
 
+void ElementFinder::find_elements(const boost::multi_array<Real,2>& target_coords, std::vector<SpaceElem>& elements, std::vector<bool>& found)
+{
+  const Uint nb_coords = target_coords.size();
+  const Uint dim = target_coords.shape()[1];
+  elements.resize(nb_coords);
+  found.resize(nb_coords);
+  RealVector coord(dim);
+  for (Uint i=0; i<nb_coords; ++i)
+  {
+    for (Uint d=0; d<dim; ++d)
+      coord[d] = target_coords[i][d];
+    found[i] = find_element(coord,elements[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // mesh
 } // cf3
@@ -10,6 +10,7 @@
 ////////////////////////////////////////////////////////////////////////////////
 
 #include "common/Component.hpp"
+#include "common/BoostArray.hpp"
 #include "mesh/LibMesh.hpp"
 #include "math/MatrixTypes.hpp"
 
@@ -40,6 +41,13 @@ public:
   /// @return if element was found
   virtual bool find_element(const RealVector& target_coord, SpaceElem& element) = 0;
 
+  /// @brief Find the elements containing each of the given coordinates
+  /// @param [in]  target_coords  Each row is a coordinate used to find an element
+  /// @param [out] elements       The found element for each coordinate
+  /// @param [out] found          For each coordinate, if an element was found
+  /// The default implementation calls find_element for each coordinate.
+  virtual void find_elements(const boost::multi_array<Real,2>& target_coords, std::vector<SpaceElem>& elements, std::vector<bool>& found);
+
 protected:
   Handle<Dictionary> m_dict;
 };
@@ -16,16 +16,13 @@
 #include "math/Consts.hpp"
 #include "math/Functions.hpp"
 
-#include "mesh/Octtree.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Elements.hpp"
 #include "mesh/Dictionary.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/ElementFinderOcttree.hpp"
-
-
-#include "common/OSystem.hpp"
-#include "common/OSystemLayer.hpp"
+#include "mesh/ElementTree.hpp"
+#include "mesh/ElementType.hpp"
 
 //////////////////////////////////////////////////////////////////////////////
 
@@ -45,141 +42,107 @@ ElementFinderOcttree::ElementFinderOcttree(const std::string &name) :
   m_closest(true),
   m_coordinates(1,1)
 {
-  options().option("dict").attach_trigger( boost::bind( &ElementFinderOcttree::configure_octtree, this ) );
+  options().option("dict").attach_trigger( boost::bind( &ElementFinderOcttree::configure_mesh, this ) );
 
   options().add("find_closest",m_closest)
     .description("If true, an inexact match is allowed, finding the closest element")
     .link_to(&m_closest);
-
-  m_octtree_idx.resize(3,0);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void ElementFinderOcttree::configure_octtree()
+void ElementFinderOcttree::configure_mesh()
 {
-  Handle<Mesh> mesh = find_parent_component_ptr<Mesh>(*m_dict);
-//  std::cout << "configuring octtree for mesh" << mesh->uri() << std::endl;
+  m_mesh = find_parent_component_ptr<Mesh>(*m_dict);
+  if (is_null(m_mesh))
+    throw SetupError(FromHere(),"Mesh was not found as parent of "+m_dict->uri().string());
+}
 
-//  std::cout << OSystem::instance().layer()->back_trace() << std::endl;
+////////////////////////////////////////////////////////////////////////////////
 
-  if (is_null(mesh))
-    throw SetupError(FromHere(),"Mesh was not found as parent of "+m_dict->uri().string());
+bool ElementFinderOcttree::find_element(const RealVector& target_coord, SpaceElem& element)
+{
+  cf3_assert(m_mesh);
 
-  if (Handle<Component> found = mesh->get_child("octtree"))
-    m_octtree = Handle<Octtree>(found);
-  else
+  if (element_tree(*m_mesh).find_element(target_coord,m_tmp))
   {
-    m_octtree = mesh->create_component<Octtree>("octtree");
-    m_octtree->options().set("mesh",mesh);
+    element = SpaceElem(*const_cast<Space*>(&m_dict->space(*m_tmp.comp)),m_tmp.idx);
+    return true;
   }
+  if (m_closest && find_closest_element(target_coord,element))
+    return true;
+
+  // if arrived here, it means no element has been found. Give up.
+  CFdebug << "coord";
+  for(Uint i = 0; i != target_coord.size(); ++i)
+  {
+    CFdebug << " " << common::to_str(target_coord[i]);
+  }
+  CFdebug << " has not been found in the element tree" << CFendl;
+  return false;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
 
-bool ElementFinderOcttree::find_element(const RealVector& target_coord, SpaceElem& element)
+void ElementFinderOcttree::find_elements(const boost::multi_array<Real,2>& target_coords, std::vector<SpaceElem>& elements, std::vector<bool>& found)
 {
-  cf3_assert(m_octtree);
-
-  if (m_octtree->is_created() == false)
-      m_octtree->create_octtree();
-
-  RealVector t_coord(m_octtree->dimension());
-  for (Uint d=0; d<target_coord.size(); ++d)
-    t_coord[d] = target_coord[d];
+  cf3_assert(m_mesh);
 
-  m_elements_pool.clear();
+  const Uint nb_coords = target_coords.size();
+  std::vector<Entity> entities;
+  element_tree(*m_mesh).find_elements(target_coords,entities);
 
-  if (m_octtree->find_octtree_cell(t_coord,m_octtree_idx))
+  elements.resize(nb_coords);
+  found.resize(nb_coords);
+  RealVector coord(target_coords.shape()[1]);
+  for (Uint i=0; i<nb_coords; ++i)
   {
-    Uint pool_size = 0;
-    Uint rings=0;
-    for ( ; pool_size==0 ; ++rings)
+    found[i] = is_not_null(entities[i].comp);
+    if (found[i])
     {
-      pool_size=m_elements_pool.size();
-      m_octtree->gather_elements_around_idx(m_octtree_idx,rings,m_elements_pool);
-      boost_foreach(const Entity& pool_elem, boost::make_iterator_range(m_elements_pool.begin()+pool_size,m_elements_pool.end()))
-      {
-        cf3_assert(is_not_null(pool_elem.comp));
-        const RealMatrix elem_coordinates = pool_elem.get_coordinates();
-        if (pool_elem.element_type().is_coord_in_element(t_coord,elem_coordinates))
-        {
-          element = SpaceElem(*const_cast<Space*>(&m_dict->space(*pool_elem.comp)),pool_elem.idx);
-          return true;
-        }
-      }
+      elements[i] = SpaceElem(*const_cast<Space*>(&m_dict->space(*entities[i].comp)),entities[i].idx);
     }
-    // if arrived here, keep searching
-    // it means no element has been found. The search is enlarged with one more ring, for possible misses.
-    m_octtree->gather_elements_around_idx(m_octtree_idx,rings,m_elements_pool);
-    boost_foreach(const Entity& pool_elem, boost::make_iterator_range(m_elements_pool.begin()+pool_size,m_elements_pool.end()))
+    else if (m_closest)
     {
-      cf3_assert(is_not_null(pool_elem.comp));
-      const RealMatrix elem_coordinates = pool_elem.get_coordinates();
-      if (pool_elem.element_type().is_coord_in_element(t_coord,elem_coordinates))
-      {
-        element = SpaceElem(*const_cast<Space*>(&m_dict->space(*pool_elem.comp)),pool_elem.idx);
-        return true;
-      }
+      for (Uint d=0; d<coord.size(); ++d)
+        coord[d] = target_coords[i][d];
+      found[i] = find_closest_element(coord,elements[i]);
     }
   }
-  if (m_closest)
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementFinderOcttree::find_closest_element(const RealVector& target_coord, SpaceElem& element)
+{
+  const ElementTree& tree = element_tree(*m_mesh);
+  m_elements_pool.clear();
+  tree.find_closest_elements(target_coord,1,m_elements_pool);
+  if (m_elements_pool.empty())
+    return false;
+
+  RealVector t_coord(tree.dimension());
+  t_coord.setZero();
+  for (Uint d=0; d<std::min(tree.dimension(),static_cast<Uint>(target_coord.size())); ++d)
+    t_coord[d] = target_coord[d];
+
+  const Entity& closest = m_elements_pool.front();
+  closest.allocate_coordinates(m_coordinates);
+  closest.put_coordinates(m_coordinates);
+  RealVector centroid(tree.dimension());
+  closest.element_type().compute_centroid(m_coordinates,centroid);
+
+  // Only accept the element if the coordinate is closer to its centroid than one of its nodes
+  const Real distance = math::Functions::get_distance(centroid,t_coord);
+  for (Uint n=0; n<closest.element_type().nb_nodes(); ++n)
   {
-//    std::cout << "didnt find element ... will look more in a pool of " << m_elements_pool.size() << std::endl;
-    Real distance=math::Consts::real_max();
-    int closest_idx=-1;
-    RealVector s_elem_centroid = t_coord;
-    for (Uint i=0; i<m_elements_pool.size(); ++i)
+    if (math::Functions::get_distance(centroid,m_coordinates.row(n)) > distance)
     {
-      int elem_dim=m_elements_pool[i].element_type().dimension();
-      m_elements_pool[i].allocate_coordinates(m_coordinates);
-      m_elements_pool[i].put_coordinates(m_coordinates);
-      m_elements_pool[i].element_type().compute_centroid( m_elements_pool[i].get_coordinates() , s_elem_centroid);
-
-      Real newdistance = math::Functions::get_distance(s_elem_centroid,t_coord);
-      if (newdistance < distance)
-      {
-        distance = newdistance;
-
-        for (Uint n=0; n<m_elements_pool[i].element_type().nb_nodes(); ++n)
-        {
-          newdistance = math::Functions::get_distance(s_elem_centroid,m_coordinates.row(n));
-          if (newdistance>distance)
-          {
-            closest_idx = i; break;
-          }
-        }
-      }
-    }
-    if (closest_idx>=0)
-    {
-//      int elem_dim=m_elements_pool[closest_idx].element_type().dimension();
-//      m_elements_pool[closest_idx].allocate_coordinates(m_coordinates);
-//      m_elements_pool[closest_idx].put_coordinates(m_coordinates);
-
-//      Real volume = m_elements_pool[closest_idx].element_type().volume( m_coordinates );
-//      Real dx3 = std::pow(distance, elem_dim);
-//      std::cout << "---> found at distance " << distance << "    vol="<<volume<<"   dx3="<<dx3<< std::endl;
-      element = SpaceElem(*const_cast<Space*>(&m_dict->space(*m_elements_pool[closest_idx].comp)),m_elements_pool[closest_idx].idx);
+      element = SpaceElem(*const_cast<Space*>(&m_dict->space(*closest.comp)),closest.idx);
       return true;
     }
   }
-//  std::cout << "---> not found" << std::endl;
-  // if arrived here, it means no element has been found in the octtree cell. Give up.
-  CFdebug << "coord";
-  for(Uint i = 0; i != t_coord.size(); ++i)
-  {
-    CFdebug << " " << common::to_str(t_coord[i]);
-  }
-  CFdebug << " has not been found in the octtree cell" << CFendl;
   return false;
-
-//  bool found = m_octtree->find_element(target_coord,m_tmp);
-//  if (!found)
-//    return false;
-
-//  element = SpaceElem(*const_cast<Space*>(&m_dict->space(*m_tmp.comp)),m_tmp.idx);
-//  return true;
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -17,9 +17,12 @@
 namespace cf3 {
 namespace mesh {
 
-  class Octtree;
-  
-/// @brief Find elements using an octtree
+  class Mesh;
+
+/// @brief Find elements using the ElementTree of the mesh
+///
+/// If find_closest is true, a coordinate that is not inside any element is attributed to the element
+/// with the closest centroid, provided the coordinate is closer to that centroid than one of its nodes.
 class Mesh_API ElementFinderOcttree : public ElementFinder
 {
 public:
@@ -32,25 +35,28 @@ public:
 
   virtual bool find_element(const RealVector& target_coord, SpaceElem& element);
 
+  /// Batched lookup in the element tree, which is threaded according to its nb_threads option
+  virtual void find_elements(const boost::multi_array<Real,2>& target_coords, std::vector<SpaceElem>& elements, std::vector<bool>& found);
+
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
 private:
 
-  void configure_octtree();
+  void configure_mesh();
+
+  /// Find the closest element, as described for the find_closest option
+  bool find_closest_element(const RealVector& target_coord, SpaceElem& element);
 
 private:
 
-  Handle<Octtree> m_octtree;
+  Handle<Mesh> m_mesh;
   Entity m_tmp;
   bool m_closest;
 
-  std::vector<Uint> m_octtree_idx;
-
   std::vector<Entity> m_elements_pool;
 
   RealMatrix m_coordinates;
 
-
 };
 
 ////////////////////////////////////////////////////////////////////////////////
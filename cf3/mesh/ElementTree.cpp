@@ -0,0 +1,470 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <limits>
+#include <queue>
+
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/Builder.hpp"
+#include "common/Core.hpp"
+#include "common/EventHandler.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Foreach.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionComponent.hpp"
+#include "common/OptionT.hpp"
+#include "common/Signal.hpp"
+#include "common/XML/SignalOptions.hpp"
+
+#include "mesh/Connectivity.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/ElementTree.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+using namespace common;
+using namespace common::XML;
+
+////////////////////////////////////////////////////////////////////////////////
+
+cf3::common::ComponentBuilder < ElementTree, Component, LibMesh > ElementTree_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace detail
+{
+
+/// Run op(begin, end) for nb_threads consecutive ranges of [0, nb_items), with the first range in the calling thread
+template<typename OpT>
+void run_threaded(const Uint nb_items, const Uint nb_threads, const OpT& op)
+{
+  const Uint used_nb_threads = std::max(Uint(1), std::min(nb_threads, nb_items));
+  boost::thread_group threads;
+  for(Uint i = 1; i < used_nb_threads; ++i)
+  {
+    threads.create_thread(boost::bind<void>(op, i*nb_items/used_nb_threads, (i+1)*nb_items/used_nb_threads));
+  }
+  op(0, nb_items/used_nb_threads);
+  threads.join_all();
+}
+
+/// Compare element indices by centroid coordinate along an axis
+struct CentroidLess
+{
+  CentroidLess(const std::vector<RealVector3>& centroids, const Uint axis) : m_centroids(centroids), m_axis(axis)
+  {
+  }
+
+  bool operator()(const Uint a, const Uint b) const
+  {
+    return m_centroids[a][m_axis] < m_centroids[b][m_axis];
+  }
+
+  const std::vector<RealVector3>& m_centroids;
+  const Uint m_axis;
+};
+
+/// Squared distance from the point to the box, zero if the point is inside
+inline Real squared_distance(const RealVector3& min, const RealVector3& max, const RealVector3& point)
+{
+  return (min - point).cwiseMax(point - max).cwiseMax(RealVector3::Zero()).squaredNorm();
+}
+
+inline bool is_in_box(const RealVector3& min, const RealVector3& max, const RealVector3& point)
+{
+  return (point.array() >= min.array()).all() && (point.array() <= max.array()).all();
+}
+
+/// Computes the box and centroid of a range of elements
+struct ElementBoxes
+{
+  ElementBoxes(const std::vector<Entity>& elements, std::vector<RealVector3>& min, std::vector<RealVector3>& max, std::vector<RealVector3>& centroids) :
+    m_elements(elements),
+    m_min(min),
+    m_max(max),
+    m_centroids(centroids)
+  {
+  }
+
+  void operator()(const Uint begin, const Uint end) const
+  {
+    RealMatrix coordinates;
+    for(Uint i = begin; i != end; ++i)
+    {
+      const Entity& element = m_elements[i];
+      element.allocate_coordinates(coordinates);
+      element.put_coordinates(coordinates);
+      const Uint dim = coordinates.cols();
+      RealVector3 min = RealVector3::Zero();
+      RealVector3 max = RealVector3::Zero();
+      RealVector3 centroid = RealVector3::Zero();
+      min.head(dim) = coordinates.colwise().minCoeff().transpose();
+      max.head(dim) = coordinates.colwise().maxCoeff().transpose();
+      centroid.head(dim) = coordinates.colwise().mean().transpose();
+
+      // Enlarge the box slightly, so points on the element boundary are not missed due to round-off
+      const RealVector3 margin = RealVector3::Constant(1e-10 * (max - min).maxCoeff());
+      m_min[i] = min - margin;
+      m_max[i] = max + margin;
+      m_centroids[i] = centroid;
+    }
+  }
+
+  const std::vector<Entity>& m_elements;
+  std::vector<RealVector3>& m_min;
+  std::vector<RealVector3>& m_max;
+  std::vector<RealVector3>& m_centroids;
+};
+
+/// Look up a range of rows of a coordinate array
+struct FindElements
+{
+  FindElements(const ElementTree& tree, const boost::multi_array<Real,2>& coordinates, std::vector<Entity>& elements) :
+    m_tree(tree),
+    m_coordinates(coordinates),
+    m_elements(elements)
+  {
+  }
+
+  void operator()(const Uint begin, const Uint end) const
+  {
+    const Uint dim = std::min(m_tree.dimension(), static_cast<Uint>(m_coordinates.shape()[1]));
+    RealVector point(m_tree.dimension());
+    point.setZero();
+    for(Uint i = begin; i != end; ++i)
+    {
+      for(Uint d = 0; d != dim; ++d)
+        point[d] = m_coordinates[i][d];
+      if(!m_tree.find_element(point, m_elements[i]))
+        m_elements[i] = Entity();
+    }
+  }
+
+  const ElementTree& m_tree;
+  const boost::multi_array<Real,2>& m_coordinates;
+  std::vector<Entity>& m_elements;
+};
+
+/// Depth of the node stacks used for the traversals, enough for any number of elements
+static const Uint max_stack_size = 128;
+
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+ElementTree::ElementTree( const std::string& name ) :
+  Component(name),
+  m_dim(0),
+  m_built(false),
+  m_leaf_size(8)
+{
+  options().add("mesh", m_mesh)
+      .description("Mesh to create the tree from")
+      .pretty_name("Mesh")
+      .mark_basic()
+      .link_to(&m_mesh);
+
+  options().add("leaf_size", m_leaf_size)
+      .description("Maximum number of elements in a leaf of the tree")
+      .pretty_name("Leaf Size");
+
+  options().add("nb_threads", 1u)
+      .description("Number of threads used to build the tree and for batched lookups")
+      .pretty_name("Number of Threads");
+
+  Core::instance().event_handler().connect_to_event(Tags::event_mesh_changed(), this, &ElementTree::on_mesh_changed_event);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementTree::build()
+{
+  if (is_null(m_mesh))
+    throw SetupError(FromHere(), "Option \"mesh\" has not been configured");
+
+  const Uint nb_threads = options().value<Uint>("nb_threads");
+  m_leaf_size = std::max(1u, options().value<Uint>("leaf_size"));
+
+  m_dim = m_mesh->dimension();
+  m_elements.clear();
+  boost_foreach (const Elements& elements, find_components_recursively_with_filter<Elements>(*m_mesh,IsElementsVolume()))
+  {
+    const Uint nb_elems = elements.size();
+    for (Uint elem_idx=0; elem_idx<nb_elems; ++elem_idx)
+      m_elements.push_back(Entity(elements,elem_idx));
+  }
+
+  const Uint nb_elems = m_elements.size();
+  m_element_min.resize(nb_elems);
+  m_element_max.resize(nb_elems);
+  m_centroids.resize(nb_elems);
+  detail::run_threaded(nb_elems, nb_threads, detail::ElementBoxes(m_elements, m_element_min, m_element_max, m_centroids));
+
+  // The node layout only depends on the number of elements, so subtrees can be built concurrently in preallocated storage
+  m_order.resize(nb_elems);
+  for (Uint i=0; i<nb_elems; ++i)
+    m_order[i] = i;
+  m_nodes.clear();
+  if (nb_elems != 0)
+  {
+    m_nodes.resize(nb_tree_nodes(nb_elems));
+    build_node(0, 0, nb_elems, nb_threads);
+  }
+
+  // Store the elements in leaf order
+  std::vector<Entity> elements(nb_elems);
+  std::vector<RealVector3> element_min(nb_elems), element_max(nb_elems), centroids(nb_elems);
+  for (Uint i=0; i<nb_elems; ++i)
+  {
+    elements[i] = m_elements[m_order[i]];
+    element_min[i] = m_element_min[m_order[i]];
+    element_max[i] = m_element_max[m_order[i]];
+    centroids[i] = m_centroids[m_order[i]];
+  }
+  m_elements.swap(elements);
+  m_element_min.swap(element_min);
+  m_element_max.swap(element_max);
+  m_centroids.swap(centroids);
+  std::vector<Uint>().swap(m_order);
+
+  m_built = true;
+
+  CFdebug << "Built element tree for " << nb_elems << " elements of " << m_mesh->uri().path() << " with " << m_nodes.size() << " nodes" << CFendl;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+Uint ElementTree::nb_tree_nodes(const Uint nb_elems) const
+{
+  if (nb_elems <= m_leaf_size)
+    return 1;
+  return 1 + nb_tree_nodes(nb_elems/2) + nb_tree_nodes(nb_elems - nb_elems/2);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementTree::build_node(const Uint node_idx, const Uint begin, const Uint end, const Uint nb_threads)
+{
+  TreeNode& node = m_nodes[node_idx];
+  node.min.setConstant(std::numeric_limits<Real>::max());
+  node.max.setConstant(-std::numeric_limits<Real>::max());
+  RealVector3 centroid_min = node.min;
+  RealVector3 centroid_max = node.max;
+  for (Uint i=begin; i!=end; ++i)
+  {
+    const Uint elem = m_order[i];
+    node.min = node.min.cwiseMin(m_element_min[elem]);
+    node.max = node.max.cwiseMax(m_element_max[elem]);
+    centroid_min = centroid_min.cwiseMin(m_centroids[elem]);
+    centroid_max = centroid_max.cwiseMax(m_centroids[elem]);
+  }
+  node.begin = begin;
+  node.end = end;
+  node.left = 0;
+  node.right = 0;
+
+  if (end - begin <= m_leaf_size)
+    return;
+
+  // Median split along the largest extent of the element centroids
+  Uint axis;
+  (centroid_max - centroid_min).maxCoeff(&axis);
+  const Uint middle = begin + (end - begin) / 2;
+  std::nth_element(m_order.begin() + begin, m_order.begin() + middle, m_order.begin() + end, detail::CentroidLess(m_centroids, axis));
+
+  node.left = node_idx + 1;
+  node.right = node.left + nb_tree_nodes(middle - begin);
+
+  // Only worth a thread for large subtrees
+  if (nb_threads > 1 && end - begin > 10000)
+  {
+    boost::thread right_thread(boost::bind(&ElementTree::build_node, this, node.right, middle, end, nb_threads - nb_threads/2));
+    build_node(node.left, begin, middle, nb_threads/2);
+    right_thread.join();
+  }
+  else
+  {
+    build_node(node.left, begin, middle, 1);
+    build_node(node.right, middle, end, 1);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementTree::is_in_element(const Uint elem_idx, const RealVector& point, RealMatrix& elem_coords) const
+{
+  const Entity& element = m_elements[elem_idx];
+  element.allocate_coordinates(elem_coords);
+  element.put_coordinates(elem_coords);
+  return element.element_type().is_coord_in_element(point, elem_coords);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+bool ElementTree::find_element(const RealVector& coordinate, Entity& element) const
+{
+  cf3_assert(m_built);
+  if (m_nodes.empty())
+    return false;
+
+  RealVector3 point = RealVector3::Zero();
+  const Uint dim = std::min(m_dim, static_cast<Uint>(coordinate.size()));
+  point.head(dim) = coordinate.head(dim);
+  RealVector elem_point(m_dim);
+  elem_point.setZero();
+  elem_point.head(dim) = coordinate.head(dim);
+  RealMatrix elem_coords;
+
+  Uint stack[detail::max_stack_size];
+  Uint stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size != 0)
+  {
+    const TreeNode& node = m_nodes[stack[--stack_size]];
+    if (!detail::is_in_box(node.min, node.max, point))
+      continue;
+
+    if (node.left == 0)
+    {
+      for (Uint i=node.begin; i!=node.end; ++i)
+      {
+        if (detail::is_in_box(m_element_min[i], m_element_max[i], point) && is_in_element(i, elem_point, elem_coords))
+        {
+          element = m_elements[i];
+          return true;
+        }
+      }
+      continue;
+    }
+
+    cf3_assert(stack_size + 2 <= detail::max_stack_size);
+    stack[stack_size++] = node.right;
+    stack[stack_size++] = node.left;
+  }
+
+  return false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementTree::find_elements(const boost::multi_array<Real,2>& coordinates, std::vector<Entity>& elements) const
+{
+  elements.resize(coordinates.size());
+  detail::run_threaded(coordinates.size(), options().value<Uint>("nb_threads"), detail::FindElements(*this, coordinates, elements));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementTree::find_closest_elements(const RealVector& coordinate, const Uint nb_elements, std::vector<Entity>& elements) const
+{
+  cf3_assert(m_built);
+  if (m_nodes.empty() || nb_elements == 0)
+    return;
+
+  RealVector3 point = RealVector3::Zero();
+  const Uint dim = std::min(m_dim, static_cast<Uint>(coordinate.size()));
+  point.head(dim) = coordinate.head(dim);
+
+  // Max-heap of the closest elements found so far, by squared centroid distance
+  std::priority_queue< std::pair<Real,Uint> > closest;
+
+  Uint stack[detail::max_stack_size];
+  Uint stack_size = 0;
+  stack[stack_size++] = 0;
+  while (stack_size != 0)
+  {
+    const TreeNode& node = m_nodes[stack[--stack_size]];
+    if (closest.size() == nb_elements && detail::squared_distance(node.min, node.max, point) >= closest.top().first)
+      continue;
+
+    if (node.left == 0)
+    {
+      for (Uint i=node.begin; i!=node.end; ++i)
+      {
+        const Real d2 = (m_centroids[i] - point).squaredNorm();
+        if (closest.size() < nb_elements)
+        {
+          closest.push(std::make_pair(d2, i));
+        }
+        else if (d2 < closest.top().first)
+        {
+          closest.pop();
+          closest.push(std::make_pair(d2, i));
+        }
+      }
+      continue;
+    }
+
+    // Visit the nearest child first, by pushing it last
+    const TreeNode& left = m_nodes[node.left];
+    const TreeNode& right = m_nodes[node.right];
+    cf3_assert(stack_size + 2 <= detail::max_stack_size);
+    if (detail::squared_distance(left.min, left.max, point) < detail::squared_distance(right.min, right.max, point))
+    {
+      stack[stack_size++] = node.right;
+      stack[stack_size++] = node.left;
+    }
+    else
+    {
+      stack[stack_size++] = node.left;
+      stack[stack_size++] = node.right;
+    }
+  }
+
+  const Uint first = elements.size();
+  elements.resize(first + closest.size());
+  for (Uint i=elements.size(); i!=first; --i)
+  {
+    elements[i-1] = m_elements[closest.top().second];
+    closest.pop();
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void ElementTree::on_mesh_changed_event(SignalArgs& args)
+{
+  if (!m_built || is_null(m_mesh))
+    return;
+
+  SignalOptions options(args);
+  if (options.value<URI>("mesh_uri") == m_mesh->uri())
+    m_built = false;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+const ElementTree& element_tree(Mesh& mesh)
+{
+  Handle<ElementTree> tree(mesh.get_child("element_tree"));
+  if (is_null(tree))
+  {
+    tree = mesh.create_component<ElementTree>("element_tree");
+    tree->options().set("mesh", mesh.handle<Mesh>());
+  }
+  if (!tree->is_built())
+    tree->build();
+  return *tree;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,134 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_ElementTree_hpp
+#define cf3_mesh_ElementTree_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "common/Component.hpp"
+#include "common/BoostArray.hpp"
+#include "common/SignalHandler.hpp"
+
+#include "math/MatrixTypes.hpp"
+
+#include "mesh/Entities.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class Mesh;
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// @brief Bounding volume hierarchy of the volume elements of a mesh
+///
+/// Each leaf holds at most "leaf_size" elements, and the tree is split at the median element centroid
+/// along the largest extent of each node, so its depth is logarithmic in the number of elements regardless
+/// of the mesh grading. The nodes and elements are stored in flat arrays, and the top levels of the tree are
+/// built concurrently using "nb_threads" threads.
+/// The tree is built on first use, and rebuilt when the mesh changes.
+/// All lookups are const and can be called concurrently.
+class Mesh_API ElementTree : public common::Component
+{
+public: // functions
+
+  /// constructor
+  ElementTree( const std::string& name );
+
+  /// Gets the Class name
+  static std::string type_name() { return "ElementTree"; }
+
+  /// Build the tree for the volume elements of the configured mesh
+  void build();
+
+  /// True if the tree was built and the mesh did not change since
+  bool is_built() const { return m_built; }
+
+  /// Dimension of the mesh
+  Uint dimension() const { return m_dim; }
+
+  /// Number of elements in the tree
+  Uint nb_elements() const { return m_elements.size(); }
+
+  /// @brief Find which element contains a given coordinate
+  /// @param [in]  coordinate  The coordinate to look for
+  /// @param [out] element     The element containing the coordinate
+  /// @return true if an element was found
+  bool find_element(const RealVector& coordinate, Entity& element) const;
+
+  /// @brief Find the elements containing each of the given coordinates, using "nb_threads" threads
+  /// @param [in]  coordinates  Each row is a coordinate to look for
+  /// @param [out] elements     The element containing each coordinate, with a null comp if none was found
+  void find_elements(const boost::multi_array<Real,2>& coordinates, std::vector<Entity>& elements) const;
+
+  /// @brief Find the elements with the centroid closest to a given coordinate
+  /// @param [in]  coordinate   The coordinate to look around
+  /// @param [in]  nb_elements  The number of elements to find
+  /// @param [out] elements     The closest elements, sorted by increasing distance. Only grows.
+  void find_closest_elements(const RealVector& coordinate, const Uint nb_elements, std::vector<Entity>& elements) const;
+
+  /// Invalidate the tree when the mesh it belongs to has changed
+  void on_mesh_changed_event(common::SignalArgs& args);
+
+private: // functions
+
+  struct TreeNode
+  {
+    RealVector3 min;
+    RealVector3 max;
+    Uint begin, end;
+    /// Child node indices, left is 0 for leaves
+    Uint left, right;
+  };
+
+  /// Number of nodes in the tree built for nb_elems elements
+  Uint nb_tree_nodes(const Uint nb_elems) const;
+
+  /// Build the node with index node_idx for the elements in [begin, end), spawning threads for the subtrees while nb_threads > 1
+  void build_node(const Uint node_idx, const Uint begin, const Uint end, const Uint nb_threads);
+
+  /// Test if the point is in the element with the given index in m_elements, using the given coordinates as storage
+  bool is_in_element(const Uint elem_idx, const RealVector& point, RealMatrix& elem_coords) const;
+
+private: // data
+
+  Handle<Mesh> m_mesh;
+
+  Uint m_dim;
+  bool m_built;
+  /// Maximum number of elements per leaf, as configured when the tree was built
+  Uint m_leaf_size;
+
+  /// Elements, ordered by leaf
+  std::vector<Entity> m_elements;
+  /// Bounding box of each element, padded to 3D
+  std::vector<RealVector3> m_element_min;
+  std::vector<RealVector3> m_element_max;
+  /// Centroid of each element, padded to 3D
+  std::vector<RealVector3> m_centroids;
+  /// Tree nodes in depth first order, with the root at index 0
+  std::vector<TreeNode> m_nodes;
+  /// Element permutation, only used while building
+  std::vector<Uint> m_order;
+
+}; // end ElementTree
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Get the element tree of the given mesh, creating it if it doesn't exist and building it if the mesh changed
+Mesh_API const ElementTree& element_tree(Mesh& mesh);
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_ElementTree_hpp
@@ -159,11 +159,8 @@ CommPattern& Field::parallelize()
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void Field::synchronize()
+CommPattern& Field::comm_pattern()
 {
-  if(!common::PE::Comm::instance().is_active())
-    return;
-
   if(is_null(m_comm_pattern))
   {
     CFdebug << "Applying default parallelization from dict for field " << uri().path() << CFendl;
@@ -171,9 +168,20 @@ void Field::synchronize()
   }
 
   cf3_assert(is_not_null(m_comm_pattern));
+  return *m_comm_pattern;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Field::synchronize()
+{
+  if(!common::PE::Comm::instance().is_active())
+    return;
+
+  CommPattern& pattern = comm_pattern();
 
   CFdebug << "Synchronizing field " << uri().path() << CFendl;
-  m_comm_pattern->synchronize( name() );
+  pattern.synchronize( name() );
 }
 
 ////////////////////////////////////////////////////////////////////////////////////////////
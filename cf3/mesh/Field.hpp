@@ -122,6 +122,9 @@ public: // functions
 
   common::PE::CommPattern& parallelize();
 
+  /// The communication pattern this field is synchronized with, the default one of the dictionary is used if none was set
+  common::PE::CommPattern& comm_pattern();
+
   void synchronize();
 
   math::VariablesDescriptor& descriptor() const { return *m_descriptor; }
@@ -4,6 +4,8 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+
 #include "common/FindComponents.hpp"
 #include "common/List.hpp"
 
@@ -151,5 +153,31 @@ void nearest_node_mapping(const RealMatrix& support_local_coords, const RealMatr
 
 ////////////////////////////////////////////////////////////////////////////////
 
+List<Real>& add_element_cost(Entities& entities, const Real cost)
+{
+  Handle< List<Real> > element_cost(entities.get_child(mesh::Tags::element_cost()));
+  if(is_null(element_cost))
+    element_cost = entities.create_component< List<Real> >(mesh::Tags::element_cost());
+
+  const Uint nb_elems = entities.size();
+  if(element_cost->size() != nb_elems)
+  {
+    element_cost->resize(nb_elems);
+    std::fill(element_cost->array().begin(), element_cost->array().end(), 0.);
+  }
+
+  if(nb_elems != 0)
+  {
+    const Real cost_per_elem = cost / static_cast<Real>(nb_elems);
+    List<Real>::ListT& costs = element_cost->array();
+    for(Uint i = 0; i != nb_elems; ++i)
+      costs[i] += cost_per_elem;
+  }
+
+  return *element_cost;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // mesh
 } // cf3
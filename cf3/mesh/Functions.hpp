@@ -50,6 +50,13 @@ void nearest_node_mapping(const RealMatrix& support_local_coords, const RealMatr
 
 ////////////////////////////////////////////////////////////////////////////////
 
+/// Add the measured cost of processing all elements of entities to its Tags::element_cost() list, spreading it evenly over the elements.
+/// The list is created if it doesn't exist, and reset to zero if the number of elements changed since the last call.
+/// @return The list with the accumulated cost of each element
+common::List<Real>& add_element_cost(Entities& entities, const Real cost);
+
+////////////////////////////////////////////////////////////////////////////////
+
 } // mesh
 } // cf3
 
@@ -0,0 +1,252 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <numeric>
+
+#include "common/Builder.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/OptionT.hpp"
+#include "common/PE/Comm.hpp"
+
+#include "math/Hilbert.hpp"
+
+#include "mesh/HilbertPartitioner.hpp"
+#include "mesh/BoundingBox.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/LibMesh.hpp"
+
+namespace cf3 {
+namespace mesh {
+
+  using namespace common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < HilbertPartitioner, MeshTransformer, LibMesh > HilbertPartitioner_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace {
+
+template <typename T>
+void exchange(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& recv)
+{
+  if (PE::Comm::instance().size() > 1)
+    PE::Comm::instance().all_to_all(send,recv);
+  else
+    recv = send;
+}
+
+/// Orders indices into arrays of Hilbert keys and global indices
+struct KeyLess
+{
+  KeyLess(const std::vector<boost::uint64_t>& keys, const std::vector<Uint>& glb_idx) : keys(keys), glb_idx(glb_idx) {}
+
+  bool operator()(const Uint a, const Uint b) const
+  {
+    return keys[a] < keys[b] || (keys[a] == keys[b] && glb_idx[a] < glb_idx[b]);
+  }
+
+  const std::vector<boost::uint64_t>& keys;
+  const std::vector<Uint>& glb_idx;
+};
+
+} // namespace
+
+////////////////////////////////////////////////////////////////////////////////
+
+HilbertPartitioner::HilbertPartitioner ( const std::string& name ) :
+    MeshPartitioner(name)
+{
+  options().add("weights", std::string("partition_weights"))
+      .description("Name of the common::List<Real> child of each Entities component holding the weights of its elements. "
+                   "Elements of components without it have weight 1.")
+      .pretty_name("Weights");
+
+  options().add("nb_samples", 32u)
+      .description("Number of keys each processor contributes to choose the splitters of the parallel sort")
+      .pretty_name("Number of Samples");
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void HilbertPartitioner::build_graph()
+{
+  Mesh& mesh = *m_mesh;
+  const std::string weights_name = options().value<std::string>("weights");
+
+  math::Hilbert compute_key(*mesh.global_bounding_box(),20);
+
+  m_keys.clear();
+  m_glb_idx.clear();
+  m_weights.clear();
+  m_entities_idx.clear();
+  m_loc_idx.clear();
+
+  const common::Table<Real>& coordinates = mesh.geometry_fields().coordinates();
+  for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+  {
+    const Entities& elements = *mesh.elements()[entities_idx];
+    Handle< common::List<Real> const > weights(elements.get_child(weights_name));
+    if (is_not_null(weights) && weights->size() != elements.size())
+      throw BadValue(FromHere(), weights->uri().string()+" has "+to_str(weights->size())+" weights for "+to_str(elements.size())+" elements");
+
+    RealMatrix element_coordinates(elements.element_type().nb_nodes(),coordinates.row_size());
+    RealVector centroid(elements.element_type().dimension());
+    for (Uint e=0; e<elements.size(); ++e)
+    {
+      if (elements.is_ghost(e))
+        continue;
+
+      const Real weight = is_not_null(weights) ? (*weights)[e] : 1.;
+      if (weight < 0.)
+        throw BadValue(FromHere(), weights->uri().string()+"["+to_str(e)+"] is negative");
+
+      elements.geometry_space().put_coordinates(element_coordinates,e);
+      elements.element_type().compute_centroid(element_coordinates,centroid);
+      m_keys.push_back(compute_key(centroid));
+      m_glb_idx.push_back(elements.glb_idx()[e]);
+      m_weights.push_back(weight);
+      m_entities_idx.push_back(entities_idx);
+      m_loc_idx.push_back(e);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void HilbertPartitioner::partition_graph()
+{
+  Mesh& mesh = *m_mesh;
+  const Uint nb_procs = PE::Comm::instance().size();
+  const Uint rank = PE::Comm::instance().rank();
+  const Uint nb_parts = options().value<Uint>("nb_parts");
+  const Uint nb_elems = m_keys.size();
+
+  for (Uint part=0; part<m_elements_to_export.size(); ++part)
+    m_elements_to_export[part].assign(mesh.elements().size(),std::vector<Uint>());
+
+  // 1) Sort the local keys
+  std::vector<Uint> order(nb_elems);
+  for (Uint i=0; i<nb_elems; ++i)
+    order[i] = i;
+  std::sort(order.begin(),order.end(),KeyLess(m_keys,m_glb_idx));
+
+  // 2) Choose the splitters between processors from regularly spaced samples of all processors
+  const Uint nb_samples = std::min(options().value<Uint>("nb_samples"),nb_elems);
+  std::vector<boost::uint64_t> sample_keys(nb_samples);
+  std::vector<Uint> sample_glb_idx(nb_samples);
+  for (Uint s=0; s<nb_samples; ++s)
+  {
+    const Uint i = order[(static_cast<boost::uint64_t>(2*s+1)*nb_elems)/(2*nb_samples)];
+    sample_keys[s] = m_keys[i];
+    sample_glb_idx[s] = m_glb_idx[i];
+  }
+  std::vector<boost::uint64_t> all_sample_keys(sample_keys);
+  std::vector<Uint> all_sample_glb_idx(sample_glb_idx);
+  if (nb_procs > 1)
+  {
+    PE::Comm::instance().all_gather(sample_keys,all_sample_keys);
+    PE::Comm::instance().all_gather(sample_glb_idx,all_sample_glb_idx);
+  }
+  std::vector<Uint> sample_order(all_sample_keys.size());
+  for (Uint i=0; i<sample_order.size(); ++i)
+    sample_order[i] = i;
+  std::sort(sample_order.begin(),sample_order.end(),KeyLess(all_sample_keys,all_sample_glb_idx));
+
+  // Splitter p is the first key that goes to processor p+1
+  std::vector<boost::uint64_t> splitter_keys(nb_procs-1);
+  std::vector<Uint> splitter_glb_idx(nb_procs-1);
+  for (Uint p=0; p+1<nb_procs; ++p)
+  {
+    const Uint s = sample_order.empty() ? 0 : sample_order[(static_cast<boost::uint64_t>(p+1)*sample_order.size())/nb_procs];
+    splitter_keys[p] = sample_order.empty() ? 0 : all_sample_keys[s];
+    splitter_glb_idx[p] = sample_order.empty() ? 0 : all_sample_glb_idx[s];
+  }
+
+  // 3) Send every key to the processor sorting its range
+  std::vector< std::vector<boost::uint64_t> > send_keys(nb_procs), recv_keys;
+  std::vector< std::vector<Uint> > send_glb_idx(nb_procs), recv_glb_idx;
+  std::vector< std::vector<Real> > send_weights(nb_procs), recv_weights;
+  std::vector<Uint> dest_of_elem(nb_elems);
+  Uint dest = 0;
+  boost_foreach(const Uint i, order)
+  {
+    while (dest+1 < nb_procs &&
+           (splitter_keys[dest] < m_keys[i] || (splitter_keys[dest] == m_keys[i] && splitter_glb_idx[dest] <= m_glb_idx[i])))
+      ++dest;
+    dest_of_elem[i] = dest;
+    send_keys[dest].push_back(m_keys[i]);
+    send_glb_idx[dest].push_back(m_glb_idx[i]);
+    send_weights[dest].push_back(m_weights[i]);
+  }
+  exchange(send_keys,recv_keys);
+  exchange(send_glb_idx,recv_glb_idx);
+  exchange(send_weights,recv_weights);
+
+  // 4) Sort the received keys, and cut the global sequence in parts of equal weight
+  std::vector<boost::uint64_t> keys;
+  std::vector<Uint> glb_idx;
+  std::vector<Real> weights;
+  for (Uint p=0; p<nb_procs; ++p)
+  {
+    keys.insert(keys.end(),recv_keys[p].begin(),recv_keys[p].end());
+    glb_idx.insert(glb_idx.end(),recv_glb_idx[p].begin(),recv_glb_idx[p].end());
+    weights.insert(weights.end(),recv_weights[p].begin(),recv_weights[p].end());
+  }
+  std::vector<Uint> sorted(keys.size());
+  for (Uint i=0; i<sorted.size(); ++i)
+    sorted[i] = i;
+  std::sort(sorted.begin(),sorted.end(),KeyLess(keys,glb_idx));
+
+  const Real local_weight = std::accumulate(weights.begin(),weights.end(),0.);
+  std::vector<Real> weight_per_proc(1,local_weight);
+  if (nb_procs > 1)
+    PE::Comm::instance().all_gather(local_weight,weight_per_proc);
+  const Real total_weight = std::accumulate(weight_per_proc.begin(),weight_per_proc.end(),0.);
+  Real weight_offset = std::accumulate(weight_per_proc.begin(),weight_per_proc.begin()+rank,0.);
+
+  std::vector<Uint> part_of_received(keys.size());
+  boost_foreach(const Uint i, sorted)
+  {
+    // The part is decided by the middle of the element on the weighted curve
+    const Real position = total_weight > 0. ? (weight_offset + 0.5*weights[i]) / total_weight : 0.;
+    part_of_received[i] = std::min(static_cast<Uint>(position*nb_parts),nb_parts-1);
+    weight_offset += weights[i];
+  }
+
+  // 5) Send the parts back, in the order the keys were received
+  std::vector< std::vector<Uint> > send_parts(nb_procs), recv_parts;
+  Uint received_idx = 0;
+  for (Uint p=0; p<nb_procs; ++p)
+  {
+    send_parts[p].assign(part_of_received.begin()+received_idx,part_of_received.begin()+received_idx+recv_keys[p].size());
+    received_idx += recv_keys[p].size();
+  }
+  exchange(send_parts,recv_parts);
+
+  m_element_parts.resize(mesh.elements().size());
+  for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+  {
+    const Entities& elements = *mesh.elements()[entities_idx];
+    m_element_parts[entities_idx].assign(elements.rank().array().begin(),elements.rank().array().end());
+  }
+  std::vector<Uint> nb_answers(nb_procs,0);
+  boost_foreach(const Uint i, order)
+  {
+    const Uint part = recv_parts[dest_of_elem[i]][nb_answers[dest_of_elem[i]]++];
+    m_element_parts[m_entities_idx[i]][m_loc_idx[i]] = part;
+    if (part != rank)
+      m_elements_to_export[part][m_entities_idx[i]].push_back(m_loc_idx[i]);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
@@ -0,0 +1,79 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_HilbertPartitioner_hpp
+#define cf3_mesh_HilbertPartitioner_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include <boost/cstdint.hpp>
+
+#include "mesh/MeshPartitioner.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// @brief Partitions the mesh along a Hilbert space-filling curve, without external dependencies
+///
+/// Every owned element gets the Hilbert key of its centroid. The keys are sorted over all processors with
+/// a parallel sample sort, and the sorted sequence is cut in "nb_parts" pieces of equal total weight.
+/// Elements with equal keys are ordered by global index, so the partition depends only on the mesh and the
+/// weights, not on the current distribution of the elements.
+///
+/// The weights of the elements of an Entities component are read from its common::List<Real> child
+/// with the name given by the "weights" option. Elements of components without such a child have weight 1.
+/// @author Willem Deconinck
+class Mesh_API HilbertPartitioner : public MeshPartitioner {
+
+public: // functions
+
+  /// Contructor
+  /// @param name of the component
+  HilbertPartitioner ( const std::string& name );
+
+  /// Virtual destructor
+  virtual ~HilbertPartitioner() {}
+
+  /// Get the class name
+  static std::string type_name () { return "HilbertPartitioner"; }
+
+  /// Compute the Hilbert key and weight of the owned elements
+  virtual void build_graph();
+
+  /// Sort the keys over all processors and assign a part to each element
+  virtual void partition_graph();
+
+  /// Part assigned to each element by the last partitioning, per component of mesh.elements().
+  /// Ghost elements are assigned their current rank.
+  const std::vector< std::vector<Uint> >& element_parts() const { return m_element_parts; }
+
+private: // data
+
+  /// Hilbert key, global index and weight of the owned elements
+  std::vector<boost::uint64_t> m_keys;
+  std::vector<Uint> m_glb_idx;
+  std::vector<Real> m_weights;
+
+  /// Index in mesh.elements() and local index of the owned elements
+  std::vector<Uint> m_entities_idx;
+  std::vector<Uint> m_loc_idx;
+
+  std::vector< std::vector<Uint> > m_element_parts;
+
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_HilbertPartitioner_hpp
@@ -4,6 +4,9 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <cmath>
+#include <limits>
+
 #include <boost/function.hpp>
 #include <boost/bind.hpp>
 
@@ -15,6 +18,7 @@
 #include "common/OptionT.hpp"
 #include "common/Signal.hpp"
 #include "common/XML/SignalOptions.hpp"
+#include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
 
 #include "mesh/Interpolator.hpp"
@@ -53,6 +57,20 @@ Interpolator::Interpolator(const std::string &name) :
       .description("Flag to store weights and stencils used for faster interpolation in the future")
       .pretty_name("Store");
 
+  std::vector<boost::any> routings;
+  routings.push_back(std::string("bounding_box"));
+  routings.push_back(std::string("ring"));
+  options().add("routing", std::string("bounding_box"))
+      .description("How target coordinates are sent to the processors that can interpolate them: "
+                   "\"bounding_box\" only sends them to processors whose source mesh bounding box contains them, "
+                   "\"ring\" sends them to every processor in turn")
+      .pretty_name("Routing")
+      .restricted_list() = routings;
+
+  options().add("bounding_box_tolerance", 1e-6)
+      .description("Enlargement of the source mesh bounding boxes, relative to their size, used with bounding_box routing")
+      .pretty_name("Bounding Box Tolerance");
+
   m_point_interpolator = Handle<APointInterpolator>(create_component<PointInterpolator>("point_interpolator"));
 }
 
@@ -81,6 +99,145 @@ void Interpolator_send_receive(const Uint send_to_pid, std::vector<T>& send, con
 ////////////////////////////////////////////////////////////////////////////////
 
 
+namespace detail {
+
+/// Regular grid over the bounding boxes of the source mesh on all processors, listing for each cell
+/// the processors whose box overlaps it, so the candidates for a point are found without checking all boxes
+struct ProcessorBoxes
+{
+  /// @param [in] boxes  For each processor, dim minima followed by dim maxima. Empty boxes have minima larger than maxima.
+  ProcessorBoxes(const std::vector<Real>& boxes, const Uint dimension) :
+    dim(dimension),
+    nb_procs(boxes.size() / (2*dimension)),
+    m_boxes(boxes),
+    m_min(dimension, std::numeric_limits<Real>::max()),
+    m_max(dimension, -std::numeric_limits<Real>::max()),
+    m_cell_size(dimension, 1.)
+  {
+    for(Uint p = 0; p != nb_procs; ++p)
+    {
+      if(is_empty(p))
+        continue;
+      for(Uint d = 0; d != dim; ++d)
+      {
+        m_min[d] = std::min(m_min[d], box_min(p, d));
+        m_max[d] = std::max(m_max[d], box_max(p, d));
+      }
+    }
+
+    // About one cell per processor
+    m_nb_cells = std::max(1, static_cast<int>(std::ceil(std::pow(static_cast<Real>(nb_procs), 1./static_cast<Real>(dim)))));
+    Uint total_nb_cells = 1;
+    for(Uint d = 0; d != dim; ++d)
+    {
+      if(m_max[d] > m_min[d])
+        m_cell_size[d] = (m_max[d] - m_min[d]) / static_cast<Real>(m_nb_cells);
+      total_nb_cells *= m_nb_cells;
+    }
+
+    // Processors overlapping each cell, in compressed row format
+    std::vector< std::vector<Uint> > cell_procs(total_nb_cells);
+    std::vector<Uint> first(dim), last(dim), idx(dim);
+    for(Uint p = 0; p != nb_procs; ++p)
+    {
+      if(is_empty(p))
+        continue;
+      for(Uint d = 0; d != dim; ++d)
+      {
+        first[d] = cell_index(box_min(p, d), d);
+        last[d] = cell_index(box_max(p, d), d);
+        idx[d] = first[d];
+      }
+      while(true)
+      {
+        cell_procs[flat_index(idx)].push_back(p);
+        Uint d = 0;
+        for(; d != dim; ++d)
+        {
+          if(idx[d] != last[d])
+          {
+            ++idx[d];
+            break;
+          }
+          idx[d] = first[d];
+        }
+        if(d == dim)
+          break;
+      }
+    }
+    m_cell_starts.assign(1, 0);
+    boost_foreach(const std::vector<Uint>& procs, cell_procs)
+    {
+      m_cell_procs.insert(m_cell_procs.end(), procs.begin(), procs.end());
+      m_cell_starts.push_back(m_cell_procs.size());
+    }
+  }
+
+  /// True if the box of processor p contains the given point
+  bool contains(const Uint p, const Table<Real>::ConstRow& point) const
+  {
+    for(Uint d = 0; d != dim; ++d)
+    {
+      if(point[d] < box_min(p, d) || point[d] > box_max(p, d))
+        return false;
+    }
+    return true;
+  }
+
+  /// Append the processors whose box contains the given point to candidates
+  void candidates(const Table<Real>::ConstRow& point, std::vector<Uint>& result) const
+  {
+    result.clear();
+    std::vector<Uint> idx(dim);
+    for(Uint d = 0; d != dim; ++d)
+    {
+      if(point[d] < m_min[d] || point[d] > m_max[d])
+        return;
+      idx[d] = cell_index(point[d], d);
+    }
+    const Uint cell = flat_index(idx);
+    for(Uint i = m_cell_starts[cell]; i != m_cell_starts[cell+1]; ++i)
+    {
+      if(contains(m_cell_procs[i], point))
+        result.push_back(m_cell_procs[i]);
+    }
+  }
+
+  const Uint dim;
+  const Uint nb_procs;
+
+private:
+  Real box_min(const Uint p, const Uint d) const { return m_boxes[2*dim*p + d]; }
+  Real box_max(const Uint p, const Uint d) const { return m_boxes[2*dim*p + dim + d]; }
+  bool is_empty(const Uint p) const { return box_min(p, 0) > box_max(p, 0); }
+
+  Uint cell_index(const Real x, const Uint d) const
+  {
+    const int i = static_cast<int>((x - m_min[d]) / m_cell_size[d]);
+    return static_cast<Uint>(std::min(std::max(i, 0), m_nb_cells-1));
+  }
+
+  Uint flat_index(const std::vector<Uint>& idx) const
+  {
+    Uint result = 0;
+    for(Uint d = dim; d != 0; --d)
+      result = result*m_nb_cells + idx[d-1];
+    return result;
+  }
+
+  const std::vector<Real>& m_boxes;
+  std::vector<Real> m_min;
+  std::vector<Real> m_max;
+  std::vector<Real> m_cell_size;
+  int m_nb_cells;
+  std::vector<Uint> m_cell_starts;
+  std::vector<Uint> m_cell_procs;
+};
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
 void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coords)
 {
   m_dict  = dict.handle<Dictionary>();
@@ -89,16 +246,7 @@ void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coord
   cf3_assert(m_point_interpolator);
   m_point_interpolator->options().set("dict", const_cast<Dictionary*>(m_dict.get())->handle<Dictionary>());
 
-  Uint nb_coords = target_coords.size();
-  Uint dim = target_coords.row_size();
-
-  std::vector<Uint> not_found; not_found.reserve(nb_coords);
-  for (Uint i=0; i<nb_coords; ++i)
-    not_found.push_back(i);
-
-  m_proc.resize(nb_coords,-1);
-
-  m_proc.clear();
+  m_proc.assign(target_coords.size(),-1);
   m_expect_recv.clear();
   m_stored_element.clear();
   m_stored_stencil.clear();
@@ -111,6 +259,22 @@ void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coord
   m_stored_source_field_points.resize(PE::Comm::instance().size());
   m_stored_source_field_weights.resize(PE::Comm::instance().size());
 
+  if (options().value<std::string>("routing") == "ring")
+    store_ring(target_coords);
+  else
+    store_bounding_box(target_coords);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Interpolator::store_ring(const Table<Real>& target_coords)
+{
+  Uint nb_coords = target_coords.size();
+  Uint dim = target_coords.row_size();
+
+  std::vector<Uint> not_found; not_found.reserve(nb_coords);
+  for (Uint i=0; i<nb_coords; ++i)
+    not_found.push_back(i);
 
   // Now find missing on other procs.
   for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
@@ -213,32 +377,201 @@ void Interpolator::store(const Dictionary& dict, const Table<Real>& target_coord
 
 ////////////////////////////////////////////////////////////////////////////////
 
-void Interpolator::stored_interpolation(const Field& source_field, Table<Real>& target)
+void Interpolator::store_bounding_box(const Table<Real>& target_coords)
 {
-  // Do interpolation on processors that can do the interpolation,
-  // and send back an array of interpolated values
-  for (Uint pid=0; pid<PE::Comm::instance().size(); pid++)
+  PE::Comm& comm = PE::Comm::instance();
+  const Uint nb_procs = comm.size();
+  const Uint nb_coords = target_coords.size();
+  const Uint dim = target_coords.row_size();
+
+  // Bounding box of the source mesh on this processor, as dim minima followed by dim maxima
+  const Field& source_coords = find_parent_component<Mesh>(*m_dict).geometry_fields().coordinates();
+  if (source_coords.row_size() != dim)
+    throw BadValue(FromHere(), "Target coordinates of dimension " + to_str(dim) + " can't be located in source mesh of dimension " + to_str(source_coords.row_size()));
+
+  std::vector<Real> local_box(2*dim);
+  for (Uint d=0; d<dim; ++d)
   {
-    // Trade my requests with processor send and recv
-    const Uint pid_send_interpolated = (PE::Comm::instance().size() + PE::Comm::instance().rank() - pid) %
-                                        PE::Comm::instance().size();
-    const Uint pid_recv_interpolated = (PE::Comm::instance().rank() + pid) %
-                                        PE::Comm::instance().size();
+    local_box[d]     =  std::numeric_limits<Real>::max();
+    local_box[dim+d] = -std::numeric_limits<Real>::max();
+  }
+  const Uint nb_source_nodes = source_coords.size();
+  for (Uint n=0; n<nb_source_nodes; ++n)
+  {
+    for (Uint d=0; d<dim; ++d)
+    {
+      local_box[d]     = std::min(local_box[d],     source_coords[n][d]);
+      local_box[dim+d] = std::max(local_box[dim+d], source_coords[n][d]);
+    }
+  }
+  if (nb_source_nodes != 0)
+  {
+    Real margin = 0.;
+    for (Uint d=0; d<dim; ++d)
+      margin = std::max(margin, local_box[dim+d] - local_box[d]);
+    margin *= options().value<Real>("bounding_box_tolerance");
+    for (Uint d=0; d<dim; ++d)
+    {
+      local_box[d]     -= margin;
+      local_box[dim+d] += margin;
+    }
+  }
 
-    // number of points to be interpolated
-    const Uint nb_points = m_stored_element[pid_send_interpolated].size();
+  std::vector<Real> boxes = local_box;
+  if (nb_procs > 1)
+    comm.all_gather(local_box, boxes);
+  const detail::ProcessorBoxes processor_boxes(boxes, dim);
 
-    // number of variables for each point to be interpolated
-    const Uint nb_vars = m_source_vars.size();
+  // First try only the processors whose bounding box contains the coordinate
+  std::vector< std::vector<Uint> > candidates(nb_procs);
+  std::vector<Uint> coord_candidates;
+  for (Uint t=0; t<nb_coords; ++t)
+  {
+    processor_boxes.candidates(target_coords[t], coord_candidates);
+    boost_foreach (const Uint pid, coord_candidates)
+      candidates[pid].push_back(t);
+  }
+  locate_on_candidates(target_coords, candidates);
 
-    // storage for interpolated variables, which will be sent to the pid that reqests it (pid_recv_interpolated)
-    std::vector<Real> interpolated; interpolated.reserve(nb_points*nb_vars);
+  // Coordinates on the boundary of a bounding box may not be found due to round-off, so try these on all other processors
+  Uint nb_not_found = std::count(m_proc.begin(), m_proc.end(), -1);
+  Uint glb_nb_not_found = nb_not_found;
+  if (nb_procs > 1)
+    comm.all_reduce(PE::plus(), &nb_not_found, 1, &glb_nb_not_found);
+  if (glb_nb_not_found == 0)
+    return;
+
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    candidates[pid].clear();
+    for (Uint t=0; t<nb_coords; ++t)
+    {
+      if (m_proc[t] < 0 && !processor_boxes.contains(pid, target_coords[t]))
+        candidates[pid].push_back(t);
+    }
+  }
+  locate_on_candidates(target_coords, candidates);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Interpolator::locate_on_candidates(const Table<Real>& target_coords, const std::vector< std::vector<Uint> >& candidates)
+{
+  PE::Comm& comm = PE::Comm::instance();
+  const Uint nb_procs = comm.size();
+  const Uint dim = target_coords.row_size();
+
+  // Send the coordinates to their candidate processors
+  std::vector< std::vector<Real> > send_coords(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    send_coords[pid].reserve(candidates[pid].size()*dim);
+    boost_foreach (const Uint t, candidates[pid])
+      send_coords[pid].insert(send_coords[pid].end(), target_coords[t].begin(), target_coords[t].end());
+  }
+  std::vector< std::vector<Real> > received_coords(nb_procs);
+  if (nb_procs > 1)
+    comm.all_to_all(send_coords, received_coords);
+  else
+    received_coords.swap(send_coords);
+
+  // Compute the storage for the received coordinates that can be interpolated on this processor
+  std::vector< std::vector<Uint> > send_found_coords(nb_procs);
+  std::vector< std::vector< SpaceElem              > > found_element(nb_procs);
+  std::vector< std::vector< std::vector<SpaceElem> > > found_stencil(nb_procs);
+  std::vector< std::vector< std::vector<Uint>      > > found_points(nb_procs);
+  std::vector< std::vector< std::vector<Real>      > > found_weights(nb_procs);
+
+  RealVector t_point(dim);
+  SpaceElem element;
+  std::vector<SpaceElem> stencil;
+  std::vector<Uint> points;
+  std::vector<Real> weights;
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const Uint nb_received_coords = received_coords[pid].size()/dim;
+    for (Uint t=0; t<nb_received_coords; ++t)
+    {
+      t_point = RealVector::MapType(&received_coords[pid][t*dim],dim);
+      if (m_point_interpolator->compute_storage(t_point, element, stencil, points, weights))
+      {
+        send_found_coords[pid].push_back(t);
+        found_element[pid].push_back(element);
+        found_stencil[pid].push_back(stencil);
+        found_points[pid].push_back(points);
+        found_weights[pid].push_back(weights);
+      }
+    }
+  }
+
+  std::vector< std::vector<Uint> > recv_found_coords(nb_procs);
+  if (nb_procs > 1)
+    comm.all_to_all(send_found_coords, recv_found_coords);
+  else
+    recv_found_coords.swap(send_found_coords);
+
+  // Each coordinate is interpolated by the lowest ranked processor that found it.
+  // Tell each processor which of its found coordinates were accepted, by their index in its found list.
+  std::vector< std::vector<Uint> > send_accepted(nb_procs);
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    const Uint nb_found = recv_found_coords[pid].size();
+    for (Uint i=0; i<nb_found; ++i)
+    {
+      cf3_assert(recv_found_coords[pid][i]<candidates[pid].size());
+      const Uint t = candidates[pid][ recv_found_coords[pid][i] ];
+      if (m_proc[t] < 0)
+      {
+        m_proc[t] = pid;
+        m_expect_recv[pid].push_back(t);
+        send_accepted[pid].push_back(i);
+      }
+    }
+  }
+
+  std::vector< std::vector<Uint> > recv_accepted(nb_procs);
+  if (nb_procs > 1)
+    comm.all_to_all(send_accepted, recv_accepted);
+  else
+    recv_accepted.swap(send_accepted);
+
+  for (Uint pid=0; pid<nb_procs; ++pid)
+  {
+    boost_foreach (const Uint i, recv_accepted[pid])
+    {
+      cf3_assert(i<found_element[pid].size());
+      m_stored_element[pid].push_back(found_element[pid][i]);
+      m_stored_stencil[pid].push_back(found_stencil[pid][i]);
+      m_stored_source_field_points[pid].push_back(found_points[pid][i]);
+      m_stored_source_field_weights[pid].push_back(found_weights[pid][i]);
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+void Interpolator::stored_interpolation(const Field& source_field, Table<Real>& target)
+{
+  const Uint nb_procs = PE::Comm::instance().size();
+
+  // number of variables for each point to be interpolated
+  const Uint nb_vars = m_source_vars.size();
+
+  // Do interpolation for the points requested by each processor
+  std::vector< std::vector<Real> > send_interpolated(nb_procs);
+  for (Uint pid=0; pid<nb_procs; pid++)
+  {
+    // number of points to be interpolated
+    const Uint nb_points = m_stored_element[pid].size();
+
+    // storage for interpolated variables, which will be sent to the pid that reqests it
+    std::vector<Real>& interpolated = send_interpolated[pid];
+    interpolated.reserve(nb_points*nb_vars);
 
     // Interpolation points and weights
-    const std::vector< std::vector<Uint> >& s_points  = m_stored_source_field_points[pid_send_interpolated];
-    const std::vector< std::vector<Real> >& s_weights = m_stored_source_field_weights[pid_send_interpolated];
+    const std::vector< std::vector<Uint> >& s_points  = m_stored_source_field_points[pid];
+    const std::vector< std::vector<Real> >& s_weights = m_stored_source_field_weights[pid];
 
-    // Do interpolation
     for (Uint t=0; t<nb_points; ++t)
     {
       for (Uint v=0; v<nb_vars; ++v)
@@ -251,20 +584,25 @@ void Interpolator::stored_interpolation(const Field& source_field, Table<Real>&
         }
       }
     }
+  }
 
-    // Send/Receive interpolated variables
-    std::vector<Real> recv_interpolated;
-    Interpolator_send_receive(pid_send_interpolated   , interpolated,
-                              pid_recv_interpolated   , recv_interpolated);
+  // Send/Receive interpolated variables
+  std::vector< std::vector<Real> > recv_interpolated(nb_procs);
+  if (nb_procs > 1)
+    PE::Comm::instance().all_to_all(send_interpolated, recv_interpolated);
+  else
+    recv_interpolated.swap(send_interpolated);
 
-    // Fill the target_field with received interpolated variables from requested processor
+  // Fill the target_field with received interpolated variables from each processor
+  for (Uint pid=0; pid<nb_procs; pid++)
+  {
     Uint it=0;
-    boost_foreach( const Uint t, m_expect_recv[pid_recv_interpolated] )
+    boost_foreach( const Uint t, m_expect_recv[pid] )
     {
       for (Uint v=0; v<nb_vars; ++v)
       {
         cf3_assert(t<target.size());
-        target[t][ m_target_vars[v] ] = recv_interpolated[it++];
+        target[t][ m_target_vars[v] ] = recv_interpolated[pid][it++];
       }
     }
   }
@@ -404,6 +742,19 @@ void Interpolator::interpolate_vars(const Field& source_field, const common::Tab
 //    }
     stored_interpolation(source_field,target);
   }
+  else if (options().value<std::string>("routing") == "bounding_box")
+  {
+    // Locating the coordinates dominates the cost, so compute the storage once and discard it afterwards
+    store(source_field.dict(),target_coords);
+    stored_interpolation(source_field,target);
+    m_source_dict_uri = URI();
+    m_source_dict_size = 0;
+    m_target_size = 0;
+    m_stored_element.clear();
+    m_stored_stencil.clear();
+    m_stored_source_field_points.clear();
+    m_stored_source_field_weights.clear();
+  }
   else
   {
     unstored_interpolation(source_field,target_coords,target);
@@ -27,6 +27,10 @@ class APointInterpolator;
 /// mesh as the source, depending on concrete implementations
 /// The interpolation also works with parallel distributed fields. Interpolation
 /// is delegated to the processor that has the necessary source values.
+/// With the "routing" option set to "bounding_box", each target coordinate is only sent to
+/// the processors whose source mesh bounding box contains it, and to all others only
+/// if none of these could interpolate it. The "ring" routing sends all coordinates
+/// that were not found yet to every processor in turn.
 /// @author Willem Deconinck
 class Mesh_API Interpolator : public AInterpolator {
 
@@ -58,6 +62,16 @@ private: // functions
 
   void store(const Dictionary& dict, const common::Table<Real>& target_coords);
 
+  /// Find the processors that can interpolate each target coordinate, by trying all processors in turn
+  void store_ring(const common::Table<Real>& target_coords);
+
+  /// Find the processors that can interpolate each target coordinate, using the bounding boxes of the source mesh on each processor
+  void store_bounding_box(const common::Table<Real>& target_coords);
+
+  /// Try to locate the target coordinates on the given candidate processors, storing the results of those that were found.
+  /// @param [in] candidates  For each processor, the target coordinate indices to send it
+  void locate_on_candidates(const common::Table<Real>& target_coords, const std::vector< std::vector<Uint> >& candidates);
+
   void stored_interpolation(const Field& source_field, common::Table<Real>& target);
 
   void unstored_interpolation(const Field& source_field, const common::Table<Real>& target_coords, common::Table<Real>& target);
@@ -102,7 +116,7 @@ public:
   /// @param name of the component
   InterpolatorT<POINTINTERPOLATOR> ( const std::string& name ) : Interpolator(name)
   {
-    remove_component(*m_point_interpolator);
+    remove_component("point_interpolator");
     m_point_interpolator = Handle<APointInterpolator>( create_component<POINTINTERPOLATOR>("point_interpolator") );
   }
 
@@ -9,6 +9,7 @@
 #include "common/Foreach.hpp"
 #include "common/BoostFilesystem.hpp"
 #include "common/Signal.hpp"
+#include "common/Trace.hpp"
 #include "common/OptionList.hpp"
 #include "common/OptionT.hpp"
 #include "common/OptionArray.hpp"
@@ -82,7 +83,9 @@ void MeshReader::execute()
   if (is_null(m_mesh))
     throw SetupError(FromHere(), "Mesh is not configured");
 
-  // Call the concrete implementation
+  // Call the concrete implementation, notifying the creation of its components once
+  TraceScope trace_scope("read_mesh");
+  TreeUpdateBatch tree_update_batch(*m_mesh);
   do_read_mesh_into(m_file_path, *m_mesh);
 }
 
@@ -109,7 +112,11 @@ void MeshReader::signal_read( SignalArgs& node  )
     {
       // Call the concrete implementation
       mesh->block_mesh_changed(true);
-      do_read_mesh_into(file, *mesh);
+      {
+        TraceScope trace_scope("read_mesh");
+        TreeUpdateBatch tree_update_batch(*mesh);
+        do_read_mesh_into(file, *mesh);
+      }
       mesh->block_mesh_changed(false);
     }
     // Raise an event to indicate that a mesh was loaded happened
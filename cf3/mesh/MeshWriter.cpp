@@ -14,6 +14,7 @@
 #include "common/Environment.hpp"
 #include "common/Core.hpp"
 #include "common/FindComponents.hpp"
+#include "common/Trace.hpp"
 
 #include "mesh/MeshWriter.hpp"
 #include "mesh/MeshMetadata.hpp"
@@ -168,6 +169,7 @@ void MeshWriter::execute()
       m_filtered_entities.push_back(entities.handle<Entities>());
 
   // Call implementation
+  TraceScope trace_scope("write_mesh");
   write();
 }
 
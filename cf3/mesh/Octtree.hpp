@@ -26,7 +26,8 @@ namespace mesh {
 
 //////////////////////////////////////////////////////////////////////////////
 
-/// This class defines neutral mesh format reader
+/// Uniform grid of cells over the local bounding box of a mesh, each cell listing the elements with their centroid in it.
+/// @note The cell size is uniform, so this degrades on strongly graded meshes. ElementTree is used for element lookups instead.
 /// @author Willem Deconinck
 class Mesh_API Octtree : public common::Component
 {
@@ -19,11 +19,11 @@ namespace mesh {
 
   class Mesh;
   class Entity;
-  class Octtree;
 
 //////////////////////////////////////////////////////////////////////////////
 
-/// This class defines neutral mesh format reader
+/// Computes a stencil of the elements with the centroids closest to the centroid of a given element,
+/// looked up in the ElementTree of the mesh
 /// @author Willem Deconinck
 class Mesh_API StencilComputerOcttree : public StencilComputer {
 
@@ -38,16 +38,14 @@ public: // functions
 
 private: // functions
 
-  void configure_octtree();
+  void configure_mesh();
 
 private: // data
-  
-  Handle<Octtree> m_octtree;
-  
+
+  Handle<Mesh> m_mesh;
+
   Uint m_dim;
-  Uint m_nb_elems_in_mesh;
 
-  std::vector<Uint> m_octtree_cell;
   RealVector m_centroid;
 
   std::vector<Entity> m_stencil;
@@ -38,6 +38,8 @@ const char * Tags::bdry_faces ()  { return "bdry_faces"; }
 
 const char * Tags::connectivity_table () { return "connectivity_table"; }
 
+const char * Tags::element_cost () { return "element_cost"; }
+
 const char * Tags::event_mesh_loaded() { return "mesh_loaded"; }
 const char * Tags::event_mesh_changed() { return "mesh_changed"; }
 
@@ -50,6 +50,9 @@ public:
 
   static const char * connectivity_table ();
 
+  /// Name of the common::List<Real> child of an Entities holding the measured cost of each element
+  static const char * element_cost ();
+
   static const char * event_mesh_loaded();
   static const char * event_mesh_changed();
 
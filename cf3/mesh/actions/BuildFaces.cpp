@@ -99,6 +99,7 @@ void BuildFaces::execute()
   // traverse regions and make interface region between connected regions recursively
   //make_interfaces(m_mesh);
   Mesh& mesh = *m_mesh;
+  TreeUpdateBatch tree_update_batch(mesh);
   PE::Comm::instance().barrier();
   build_face_cell_connectivity_bottom_up(mesh);
 
@@ -20,7 +20,7 @@
 #include "mesh/Space.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/ShapeFunction.hpp"
-#include "mesh/Octtree.hpp"
+#include "mesh/ElementTree.hpp"
 #include "mesh/Connectivity.hpp"
 
 #include "mesh/actions/Interpolate.hpp"
@@ -157,16 +157,7 @@ void Interpolate::interpolate(const Field& source, const common::Table<Real>& co
 
   Mesh& source_mesh = find_parent_component<Mesh>(source);
 
-  if ( is_null(m_octtree) )
-  {
-    if (Handle<Component> found = source_mesh.get_child("octtree"))
-      m_octtree = Handle<Octtree>(found);
-    else
-    {
-      m_octtree = source_mesh.create_component<Octtree>("octtree");
-      m_octtree->options().set("mesh",source_mesh.handle<Mesh>());
-    }
-  }
+  const ElementTree& tree = element_tree(source_mesh);
 
   const Uint dimension = source_mesh.dimension();
   const Uint nb_vars = source.row_size();
@@ -182,7 +173,7 @@ void Interpolate::interpolate(const Field& source, const common::Table<Real>& co
   {
     for (Uint d=0; d<target_dim; ++d)
       coord[d] = coordinates[i][d];
-    if( m_octtree->find_element(coord,element) )
+    if( tree.find_element(coord,element) )
     {
       interpolate_coordinate( coord, *element.comp, element.idx, target[i] );
 //      std::cout<< PERank << "interpolate for coord (" << coord.transpose() << ") in " << element_component->uri().path() << "["<<element_idx<<"] ... done" << std::endl;
@@ -250,7 +241,7 @@ void Interpolate::interpolate(const Field& source, const common::Table<Real>& co
         for (Uint d=0; d<target_dim; ++d)
           coord[d] = recv_coordinates[i][d];
 
-        if( m_octtree->find_element(coord,element) )
+        if( tree.find_element(coord,element) )
         {
 //          std::cout<< PERank << " send to " << root << ": interpolate for coord (" << coord.transpose() << ") in " << element_component->uri().path() << "["<<element_idx<<"]" << std::endl;
           boost::multi_array<Real,2> target_row(boost::extents[1][nb_vars]);
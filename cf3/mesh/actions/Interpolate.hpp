@@ -20,7 +20,6 @@
 namespace cf3 {
 namespace mesh {
 
-  class Octtree;
   class Field;
   class Elements;
 
@@ -64,9 +63,6 @@ private:
   /// target field
   Handle<Field> m_target;
 
-  /// source octtree
-  Handle<Octtree> m_octtree;
-
   void interpolate_coordinate(const RealVector& target_coord, const Entities& element_component, const Uint element_idx, Field::Row target_row);
 
 
@@ -0,0 +1,153 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#include <algorithm>
+#include <map>
+#include <numeric>
+
+#include "common/Builder.hpp"
+#include "common/Foreach.hpp"
+#include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Entities.hpp"
+#include "mesh/Functions.hpp"
+#include "mesh/HilbertPartitioner.hpp"
+#include "mesh/Mesh.hpp"
+
+#include "mesh/actions/GrowOverlap.hpp"
+#include "mesh/actions/RemoveGhostElements.hpp"
+#include "mesh/actions/MeasuredCostBalance.hpp"
+
+//////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+namespace actions {
+
+using namespace common;
+using namespace common::PE;
+
+////////////////////////////////////////////////////////////////////////////////
+
+common::ComponentBuilder < MeasuredCostBalance, MeshTransformer, mesh::actions::LibActions> MeasuredCostBalance_Builder;
+
+////////////////////////////////////////////////////////////////////////////////
+
+MeasuredCostBalance::MeasuredCostBalance(const std::string& name) :
+  MeshTransformer(name),
+  m_remove_ghosts(create_static_component<RemoveGhostElements>("RemoveGhostElements")),
+  m_partitioner(create_static_component<HilbertPartitioner>("HilbertPartitioner")),
+  m_grow_overlap(create_static_component<GrowOverlap>("GrowOverlap"))
+{
+  properties()["brief"] = std::string("Repartition the mesh based on the measured cost of its elements");
+  properties()["description"] = std::string("Repartitions the mesh, moving fields along, when the measured cost of the owned elements is unbalanced between processes");
+  properties()["imbalance"] = 1.;
+
+  options().add("imbalance_threshold", 1.2)
+    .pretty_name("Imbalance Threshold")
+    .description("Repartition when the cost on the most expensive process divided by the average cost exceeds this value")
+    .mark_basic();
+
+  m_partitioner->options().set("weights", std::string(mesh::Tags::element_cost()));
+}
+
+void MeasuredCostBalance::execute()
+{
+  Mesh& mesh = *m_mesh;
+  Comm& comm = Comm::instance();
+  const Uint nb_procs = comm.size();
+
+  // Total measured cost of the owned elements
+  Real local_cost = 0.;
+  Uint local_has_ghosts = 0;
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    Handle< List<Real> const > element_cost(entities->get_child(mesh::Tags::element_cost()));
+    const bool has_cost = is_not_null(element_cost) && element_cost->size() == entities->size();
+    for(Uint e = 0; e != entities->size(); ++e)
+    {
+      if(entities->is_ghost(e))
+        local_has_ghosts = 1;
+      else if(has_cost)
+        local_cost += (*element_cost)[e];
+    }
+  }
+
+  std::vector<Real> cost_per_proc(1, local_cost);
+  Uint has_ghosts = local_has_ghosts;
+  if(nb_procs > 1)
+  {
+    comm.all_gather(local_cost, cost_per_proc);
+    comm.all_reduce(PE::max(), &local_has_ghosts, 1, &has_ghosts);
+  }
+
+  const Real average_cost = std::accumulate(cost_per_proc.begin(), cost_per_proc.end(), 0.) / static_cast<Real>(nb_procs);
+  const Real imbalance = average_cost > 0. ? *std::max_element(cost_per_proc.begin(), cost_per_proc.end()) / average_cost : 1.;
+  properties()["imbalance"] = imbalance;
+
+  if(nb_procs > 1 && imbalance > options().value<Real>("imbalance_threshold"))
+  {
+    CFinfo << "rebalancing mesh " << mesh.uri().path() << " with measured cost imbalance " << imbalance << CFendl;
+
+    // The ghost elements are removed first, so keep the cost of the owned elements by global index
+    std::vector< std::map<Uint, Real> > owned_cost(mesh.elements().size());
+    for(Uint entities_idx = 0; entities_idx != mesh.elements().size(); ++entities_idx)
+    {
+      Entities& entities = *mesh.elements()[entities_idx];
+      const List<Real>& element_cost = add_element_cost(entities, 0.); // elements that were never measured have no cost
+      for(Uint e = 0; e != entities.size(); ++e)
+      {
+        if(!entities.is_ghost(e))
+          owned_cost[entities_idx][entities.glb_idx()[e]] = element_cost[e];
+      }
+    }
+
+    if(has_ghosts)
+    {
+      m_remove_ghosts->transform(mesh);
+      for(Uint entities_idx = 0; entities_idx != mesh.elements().size(); ++entities_idx)
+      {
+        Entities& entities = *mesh.elements()[entities_idx];
+        List<Real>& element_cost = add_element_cost(entities, 0.);
+        for(Uint e = 0; e != entities.size(); ++e)
+          element_cost[e] = owned_cost[entities_idx][entities.glb_idx()[e]];
+      }
+    }
+
+    CFinfo << "  + partitioning and migrating ..." << CFendl;
+    m_partitioner->transform(mesh);
+    CFinfo << "  + partitioning and migrating ... done" << CFendl;
+
+    if(has_ghosts)
+    {
+      CFinfo << "  + growing overlap layer ..." << CFendl;
+      m_grow_overlap->transform(mesh);
+      CFinfo << "  + growing overlap layer ... done" << CFendl;
+    }
+  }
+
+  // Start a new measurement
+  boost_foreach(const Handle<Entities>& entities, mesh.elements())
+  {
+    Handle< List<Real> > element_cost(entities->get_child(mesh::Tags::element_cost()));
+    if(is_not_null(element_cost))
+    {
+      element_cost->resize(entities->size());
+      std::fill(element_cost->array().begin(), element_cost->array().end(), 0.);
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
@@ -0,0 +1,58 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef cf3_mesh_actions_MeasuredCostBalance_hpp
+#define cf3_mesh_actions_MeasuredCostBalance_hpp
+
+////////////////////////////////////////////////////////////////////////////////
+
+#include "mesh/MeshTransformer.hpp"
+
+#include "mesh/actions/LibActions.hpp"
+
+////////////////////////////////////////////////////////////////////////////////
+
+namespace cf3 {
+namespace mesh {
+
+  class HilbertPartitioner;
+
+namespace actions {
+
+//////////////////////////////////////////////////////////////////////////////
+
+/// @brief Repartition the mesh during a run, based on the measured cost of the elements
+///
+/// The cost of the elements is read from the Tags::element_cost() list of each Entities, as filled in
+/// by mesh::add_element_cost (e.g. by ProtoActions with the "record_cost" option). If the total cost of the owned elements
+/// on the most expensive process exceeds the average by more than the "imbalance_threshold" factor, the mesh is
+/// repartitioned by a HilbertPartitioner using the measured costs as element weights. Fields move along with their nodes,
+/// and the overlap layer is rebuilt if the mesh had one.
+///
+/// The measured costs are reset after every execution, so each execution judges the cost measured since the previous one.
+/// The imbalance found by the last execution is stored in the "imbalance" property.
+class mesh_actions_API MeasuredCostBalance : public MeshTransformer
+{
+public:
+  MeasuredCostBalance(const std::string& name);
+  static std::string type_name() { return "MeasuredCostBalance"; }
+  virtual void execute();
+
+private:
+  Handle<MeshTransformer> m_remove_ghosts;
+  Handle<HilbertPartitioner> m_partitioner;
+  Handle<MeshTransformer> m_grow_overlap;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+} // actions
+} // mesh
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // cf3_mesh_actions_MeasuredCostBalance_hpp
@@ -4,8 +4,11 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <limits>
 #include <set>
 
+#include <boost/thread/thread.hpp>
+
 #include "common/Builder.hpp"
 
 #include "common/FindComponents.hpp"
@@ -13,6 +16,8 @@
 #include "common/Option.hpp"
 #include "common/OptionList.hpp"
 #include "common/List.hpp"
+#include "common/Table.hpp"
+#include "common/PE/Comm.hpp"
 
 #include "mesh/ConnectivityData.hpp"
 #include "mesh/DiscontinuousDictionary.hpp"
@@ -201,6 +206,393 @@ struct WallProjection
   bool m_has_nearest_element = false;
   NodeConnectivity::ElementReferenceT m_last_nearest_element;
 };
+
+/// Axis-aligned bounding box, in 3D. 2D coordinates use z = 0
+struct BoundingBox
+{
+  BoundingBox()
+  {
+    min.setConstant(std::numeric_limits<Real>::max());
+    max.setConstant(-std::numeric_limits<Real>::max());
+  }
+
+  void extend(const RealVector3& point)
+  {
+    min = min.cwiseMin(point);
+    max = max.cwiseMax(point);
+  }
+
+  void extend(const BoundingBox& other)
+  {
+    min = min.cwiseMin(other.min);
+    max = max.cwiseMax(other.max);
+  }
+
+  /// Squared distance from the point to the box, zero if the point is inside
+  Real squared_distance(const RealVector3& point) const
+  {
+    const RealVector3 gap = (min - point).cwiseMax(point - max).cwiseMax(RealVector3::Zero());
+    return gap.squaredNorm();
+  }
+
+  /// Squared distance between two boxes, zero if they overlap
+  Real squared_distance(const BoundingBox& other) const
+  {
+    const RealVector3 gap = (other.min - max).cwiseMax(min - other.max).cwiseMax(RealVector3::Zero());
+    return gap.squaredNorm();
+  }
+
+  RealVector3 min;
+  RealVector3 max;
+};
+
+/// Part of the wall for the distance computation: a single node (1 point), a line segment (2 points) or a triangle (3 points)
+struct WallFace
+{
+  /// Index of a remote face
+  static const Uint invalid = std::numeric_limits<Uint>::max();
+
+  WallFace() : nb_points(0), entities_idx(invalid), element_idx(invalid)
+  {
+  }
+
+  BoundingBox bounding_box() const
+  {
+    BoundingBox result;
+    for(Uint i = 0; i != nb_points; ++i)
+      result.extend(points[i]);
+    return result;
+  }
+
+  /// Squared distance from the point to the closest point of the face
+  Real squared_distance(const RealVector3& p) const
+  {
+    if(nb_points == 1)
+      return (p - points[0]).squaredNorm();
+
+    if(nb_points == 2)
+    {
+      const RealVector3 ab = points[1] - points[0];
+      const Real t = std::max(0., std::min(1., ab.dot(p - points[0]) / ab.squaredNorm()));
+      return (p - (points[0] + t*ab)).squaredNorm();
+    }
+
+    // Closest point on a triangle, following the Voronoi region tests from Ericson, Real-Time Collision Detection, section 5.1.5
+    const RealVector3& a = points[0];
+    const RealVector3& b = points[1];
+    const RealVector3& c = points[2];
+    const RealVector3 ab = b - a;
+    const RealVector3 ac = c - a;
+    const RealVector3 ap = p - a;
+    const Real d1 = ab.dot(ap);
+    const Real d2 = ac.dot(ap);
+    if(d1 <= 0. && d2 <= 0.)
+      return ap.squaredNorm();
+
+    const RealVector3 bp = p - b;
+    const Real d3 = ab.dot(bp);
+    const Real d4 = ac.dot(bp);
+    if(d3 >= 0. && d4 <= d3)
+      return bp.squaredNorm();
+
+    const Real vc = d1*d4 - d3*d2;
+    if(vc <= 0. && d1 >= 0. && d3 <= 0.)
+      return (p - (a + d1 / (d1 - d3) * ab)).squaredNorm();
+
+    const RealVector3 cp = p - c;
+    const Real d5 = ab.dot(cp);
+    const Real d6 = ac.dot(cp);
+    if(d6 >= 0. && d5 <= d6)
+      return cp.squaredNorm();
+
+    const Real vb = d5*d2 - d1*d6;
+    if(vb <= 0. && d2 >= 0. && d6 <= 0.)
+      return (p - (a + d2 / (d2 - d6) * ac)).squaredNorm();
+
+    const Real va = d3*d6 - d5*d4;
+    if(va <= 0. && (d4 - d3) >= 0. && (d5 - d6) >= 0.)
+      return (p - (b + (d4 - d3) / ((d4 - d3) + (d5 - d6)) * (c - b))).squaredNorm();
+
+    const Real denom = 1. / (va + vb + vc);
+    return (p - (a + ab * (vb*denom) + ac * (vc*denom))).squaredNorm();
+  }
+
+  Uint nb_points;
+  RealVector3 points[3];
+  /// Index of the wall entities in the node connectivity, or invalid for a remote face
+  Uint entities_idx;
+  /// Element index in the entities, or the node index for single point faces
+  Uint element_idx;
+};
+
+/// Bounding volume hierarchy over wall faces, for nearest face queries
+class WallFaceTree
+{
+public:
+  /// Build the tree. The faces are reordered, so face indices returned by closest_face refer to the reordered list
+  void build(std::vector<WallFace>& faces)
+  {
+    m_faces = &faces;
+    m_nodes.clear();
+    m_boxes.clear();
+    m_boxes.reserve(faces.size());
+    BOOST_FOREACH(const WallFace& face, faces)
+    {
+      m_boxes.push_back(face.bounding_box());
+    }
+    if(!faces.empty())
+      build_node(0, faces.size());
+  }
+
+  /// Find the face closest to the point. Only faces at a squared distance smaller than the input value of d2 are considered.
+  /// Returns false if no such face exists, otherwise d2 and face_idx are set to the squared distance and the index of the closest face
+  bool closest_face(const RealVector3& point, Real& d2, Uint& face_idx) const
+  {
+    if(m_nodes.empty())
+      return false;
+
+    bool found = false;
+    Uint stack[64];
+    Uint stack_size = 0;
+    stack[stack_size++] = 0;
+    while(stack_size != 0)
+    {
+      const TreeNode& node = m_nodes[stack[--stack_size]];
+      if(node.box.squared_distance(point) >= d2)
+        continue;
+
+      if(node.left == 0)
+      {
+        for(Uint i = node.begin; i != node.end; ++i)
+        {
+          const Real face_d2 = (*m_faces)[i].squared_distance(point);
+          if(face_d2 < d2)
+          {
+            d2 = face_d2;
+            face_idx = i;
+            found = true;
+          }
+        }
+        continue;
+      }
+
+      // Visit the nearest child first, by pushing it last
+      const Real left_d2 = m_nodes[node.left].box.squared_distance(point);
+      const Real right_d2 = m_nodes[node.right].box.squared_distance(point);
+      cf3_assert(stack_size + 2 <= 64);
+      if(left_d2 < right_d2)
+      {
+        stack[stack_size++] = node.right;
+        stack[stack_size++] = node.left;
+      }
+      else
+      {
+        stack[stack_size++] = node.left;
+        stack[stack_size++] = node.right;
+      }
+    }
+
+    return found;
+  }
+
+private:
+  struct TreeNode
+  {
+    BoundingBox box;
+    Uint begin, end;
+    /// Child node indices, left is 0 for leaves
+    Uint left, right;
+  };
+
+  static const Uint leaf_size = 4;
+
+  Uint build_node(const Uint begin, const Uint end)
+  {
+    const Uint node_idx = m_nodes.size();
+    m_nodes.push_back(TreeNode());
+    BoundingBox box;
+    BoundingBox centroid_box;
+    for(Uint i = begin; i != end; ++i)
+    {
+      box.extend(m_boxes[i]);
+      centroid_box.extend(0.5*(m_boxes[i].min + m_boxes[i].max));
+    }
+    m_nodes[node_idx].box = box;
+    m_nodes[node_idx].begin = begin;
+    m_nodes[node_idx].end = end;
+    m_nodes[node_idx].left = 0;
+    m_nodes[node_idx].right = 0;
+
+    if(end - begin <= leaf_size)
+      return node_idx;
+
+    // Median split along the largest extent of the face centroids
+    Uint axis;
+    (centroid_box.max - centroid_box.min).maxCoeff(&axis);
+    const Uint middle = begin + (end - begin) / 2;
+    std::vector<Uint> order(end - begin);
+    for(Uint i = 0; i != order.size(); ++i)
+      order[i] = begin + i;
+    std::nth_element(order.begin(), order.begin() + (middle - begin), order.end(), CentroidLess(m_boxes, axis));
+    std::vector<WallFace> faces(end - begin);
+    std::vector<BoundingBox> boxes(end - begin);
+    for(Uint i = 0; i != order.size(); ++i)
+    {
+      faces[i] = (*m_faces)[order[i]];
+      boxes[i] = m_boxes[order[i]];
+    }
+    std::copy(faces.begin(), faces.end(), m_faces->begin() + begin);
+    std::copy(boxes.begin(), boxes.end(), m_boxes.begin() + begin);
+
+    const Uint left = build_node(begin, middle);
+    const Uint right = build_node(middle, end);
+    m_nodes[node_idx].left = left;
+    m_nodes[node_idx].right = right;
+    return node_idx;
+  }
+
+  struct CentroidLess
+  {
+    CentroidLess(const std::vector<BoundingBox>& boxes, const Uint axis) : m_boxes(boxes), m_axis(axis)
+    {
+    }
+
+    bool operator()(const Uint a, const Uint b) const
+    {
+      return m_boxes[a].min[m_axis] + m_boxes[a].max[m_axis] < m_boxes[b].min[m_axis] + m_boxes[b].max[m_axis];
+    }
+
+    const std::vector<BoundingBox>& m_boxes;
+    const Uint m_axis;
+  };
+
+  std::vector<WallFace>* m_faces;
+  std::vector<BoundingBox> m_boxes;
+  std::vector<TreeNode> m_nodes;
+};
+
+/// Coordinates of a node, padded to 3D
+inline RealVector3 point3d(const Field& coords, const Uint node_idx)
+{
+  RealVector3 result = RealVector3::Zero();
+  const Uint dim = coords.row_size();
+  for(Uint i = 0; i != dim; ++i)
+    result[i] = coords[node_idx][i];
+  return result;
+}
+
+/// Split the wall elements into faces for the exact distance computation. Quads are split into two triangles
+void build_wall_faces(const Field& coords, const std::vector< Handle<Entities> >& surface_entities, std::vector<WallFace>& faces)
+{
+  const Uint nb_entities = surface_entities.size();
+  for(Uint entities_idx = 0; entities_idx != nb_entities; ++entities_idx)
+  {
+    const Entities& entities = *surface_entities[entities_idx];
+    const Connectivity& conn = entities.geometry_space().connectivity();
+    const Uint nb_elems = conn.size();
+    const Uint element_nb_nodes = conn.row_size();
+    for(Uint elem_idx = 0; elem_idx != nb_elems; ++elem_idx)
+    {
+      WallFace face;
+      face.entities_idx = entities_idx;
+      face.element_idx = elem_idx;
+      if(element_nb_nodes == 4)
+      {
+        face.nb_points = 3;
+        face.points[0] = point3d(coords, conn[elem_idx][0]);
+        face.points[1] = point3d(coords, conn[elem_idx][1]);
+        face.points[2] = point3d(coords, conn[elem_idx][2]);
+        faces.push_back(face);
+        face.points[1] = face.points[2];
+        face.points[2] = point3d(coords, conn[elem_idx][3]);
+        faces.push_back(face);
+      }
+      else
+      {
+        face.nb_points = element_nb_nodes;
+        for(Uint i = 0; i != element_nb_nodes; ++i)
+          face.points[i] = point3d(coords, conn[elem_idx][i]);
+        faces.push_back(face);
+      }
+    }
+  }
+}
+
+/// Get the wall faces from the other ranks that may be closer than the current wall distance for the nodes of this rank.
+/// local_box contains all nodes of this rank, and search_radius is the largest wall distance found for these nodes so far
+void gather_remote_faces(const std::vector<WallFace>& local_faces, const BoundingBox& local_box, const Real search_radius, std::vector<WallFace>& remote_faces)
+{
+  common::PE::Comm& comm = common::PE::Comm::instance();
+  const Uint nb_procs = comm.size();
+  const Uint my_rank = comm.rank();
+
+  // Bounding box and search radius of each rank
+  std::vector<Real> search_region(7);
+  for(Uint i = 0; i != 3; ++i)
+  {
+    search_region[i] = local_box.min[i];
+    search_region[3+i] = local_box.max[i];
+  }
+  search_region[6] = search_radius;
+  std::vector<Real> search_regions;
+  comm.all_gather(search_region, search_regions);
+
+  // Serialize the faces within the search radius of each rank, as the number of points followed by 3 points
+  static const Uint face_size = 10;
+  std::vector< std::vector<Real> > send_faces(nb_procs);
+  for(Uint rank = 0; rank != nb_procs; ++rank)
+  {
+    if(rank == my_rank)
+      continue;
+
+    BoundingBox rank_box;
+    for(Uint i = 0; i != 3; ++i)
+    {
+      rank_box.min[i] = search_regions[7*rank + i];
+      rank_box.max[i] = search_regions[7*rank + 3 + i];
+    }
+    const Real rank_radius = search_regions[7*rank + 6];
+    BOOST_FOREACH(const WallFace& face, local_faces)
+    {
+      if(face.bounding_box().squared_distance(rank_box) > rank_radius*rank_radius)
+        continue;
+      send_faces[rank].push_back(face.nb_points);
+      for(Uint i = 0; i != 3; ++i)
+        send_faces[rank].insert(send_faces[rank].end(), face.points[i].data(), face.points[i].data() + 3);
+    }
+  }
+
+  std::vector< std::vector<Real> > received_faces(nb_procs);
+  comm.all_to_all(send_faces, received_faces);
+
+  BOOST_FOREACH(const std::vector<Real>& rank_faces, received_faces)
+  {
+    const Uint nb_faces = rank_faces.size() / face_size;
+    for(Uint i = 0; i != nb_faces; ++i)
+    {
+      WallFace face;
+      face.nb_points = static_cast<Uint>(rank_faces[face_size*i]);
+      for(Uint j = 0; j != 3; ++j)
+        face.points[j] = Eigen::Map<const RealVector3>(&rank_faces[face_size*i + 1 + 3*j]);
+      remote_faces.push_back(face);
+    }
+  }
+}
+
+/// Run op(begin, end) for nb_threads consecutive ranges of [0, nb_items), with the first range in the calling thread
+template<typename OpT>
+void run_threaded(const Uint nb_items, const Uint nb_threads, const OpT& op)
+{
+  const Uint used_nb_threads = std::max(Uint(1), std::min(nb_threads, nb_items));
+  boost::thread_group threads;
+  for(Uint i = 1; i < used_nb_threads; ++i)
+  {
+    threads.create_thread(boost::bind<void>(op, i*nb_items/used_nb_threads, (i+1)*nb_items/used_nb_threads));
+  }
+  op(0, nb_items/used_nb_threads);
+  threads.join_all();
+}
+
 }
 
 WallDistance::WallDistance(const std::string& name) : MeshTransformer(name)
@@ -210,6 +602,14 @@ WallDistance::WallDistance(const std::string& name) : MeshTransformer(name)
       .description("Regions that are to be considered as part of the wall")
       .link_to(&m_regions)
       .mark_basic();
+
+  options().add("exact", false)
+      .pretty_name("Exact")
+      .description("Compute the exact distance to the closest wall face. Otherwise the distance is obtained by projecting onto the wall elements around the closest wall node, which is faster but approximate for curved walls");
+
+  options().add("nb_threads", 1u)
+      .pretty_name("Number of threads")
+      .description("Number of threads to use for the loop over the mesh nodes");
 }
 
 void WallDistance::execute()
@@ -264,9 +664,40 @@ void WallDistance::execute()
   const common::List<Uint>& surface_nodes = *surface_nodes_ptr;
   const Uint nb_surface_nodes = surface_nodes.size();
 
-  detail::WallProjection normal_distance(coords, *node_connectivity, normals);
+  std::vector<bool> is_surface_node(nb_nodes, false);
+  for(Uint i = 0; i != nb_surface_nodes; ++i)
+    is_surface_node[surface_nodes[i]] = true;
+
+  const bool exact = options().value<bool>("exact");
+  const Uint nb_threads = options().value<Uint>("nb_threads");
+  const bool is_parallel = common::PE::Comm::instance().is_active() && common::PE::Comm::instance().size() > 1;
+
+  // The wall faces are needed for the exact distance, and by the other ranks in a parallel run
+  std::vector<detail::WallFace> wall_faces;
+  if(exact || is_parallel)
+    detail::build_wall_faces(coords, surface_entities, wall_faces);
+
+  // Search tree over the wall faces for the exact distance, or over the wall nodes for the approximate distance
+  std::vector<detail::WallFace> search_faces;
+  if(exact)
+  {
+    search_faces = wall_faces;
+  }
+  else
+  {
+    search_faces.resize(nb_surface_nodes);
+    for(Uint i = 0; i != nb_surface_nodes; ++i)
+    {
+      search_faces[i].nb_points = 1;
+      search_faces[i].points[0] = detail::point3d(coords, surface_nodes[i]);
+      search_faces[i].element_idx = surface_nodes[i];
+    }
+  }
+  detail::WallFaceTree tree;
+  tree.build(search_faces);
 
   // Link each node to a wall element. First column: 1 if a wall element exists. Second column: index to the entities in the node connectivity. Last column: element index
+  // If the closest wall is on another rank, the first column is 0 and the second column is the node itself
   auto& node_to_wall_element = *mesh.create_component<common::Table<Uint>>("node_to_wall_element");
   node_to_wall_element.set_row_size(3);
   node_to_wall_element.resize(nb_nodes);
@@ -275,35 +706,38 @@ void WallDistance::execute()
     std::fill(row.begin(), row.end(), 0);
   }
 
-  for(Uint inner_node_idx = 0; inner_node_idx != nb_nodes; ++inner_node_idx)
+  const Real no_wall = std::numeric_limits<Real>::infinity();
+  const NodeConnectivity& const_node_connectivity = *node_connectivity;
+  detail::run_threaded(nb_nodes, nb_threads, [&](const Uint nodes_begin, const Uint nodes_end)
   {
-    bool is_surface_node = false;
-    Real shortest_distance = 1e20;
-    Uint closest_surface_node = 0;
-    for(Uint j = 0; j != nb_surface_nodes; ++j)
+    detail::WallProjection normal_distance(coords, const_node_connectivity, normals);
+    for(Uint inner_node_idx = nodes_begin; inner_node_idx != nodes_end; ++inner_node_idx)
     {
-      const Uint surface_node_idx = surface_nodes[j];
-      if(surface_node_idx == inner_node_idx)
+      if(is_surface_node[inner_node_idx])
       {
-        is_surface_node = true;
-        break;
+        d[inner_node_idx][0] = 0.;
+        continue;
       }
-      const Real d2 = (to_vector(coords[inner_node_idx]) - to_vector(coords[surface_node_idx])).squaredNorm();
-      if(d2 < shortest_distance)
+
+      Real d2 = no_wall;
+      Uint face_idx = 0;
+      if(!tree.closest_face(detail::point3d(coords, inner_node_idx), d2, face_idx))
       {
-        shortest_distance = d2;
-        closest_surface_node = surface_node_idx;
+        d[inner_node_idx][0] = no_wall;
+        continue;
       }
-    }
 
-    if(is_surface_node)
-    {
-      d[inner_node_idx][0] = 0.;
-      // Eigen::Map<RealVector> node_normal(&nodal_normals[inner_node_idx][0], dim);
-      // node_normal /= node_normal.norm();
-    }
-    else
-    {
+      const detail::WallFace& closest_face = search_faces[face_idx];
+      if(exact)
+      {
+        d[inner_node_idx][0] = std::sqrt(d2);
+        node_to_wall_element[inner_node_idx][0] = 1;
+        node_to_wall_element[inner_node_idx][1] = closest_face.entities_idx;
+        node_to_wall_element[inner_node_idx][2] = closest_face.element_idx;
+        continue;
+      }
+
+      const Uint closest_surface_node = closest_face.element_idx;
       d[inner_node_idx][0] = normal_distance(inner_node_idx, closest_surface_node);
       if(normal_distance.m_has_nearest_element)
       {
@@ -317,7 +751,44 @@ void WallDistance::execute()
         node_to_wall_element[inner_node_idx][1] = closest_surface_node;
       }
     }
+  });
+
+  if(!is_parallel)
+    return;
+
+  // Check the wall faces of the other ranks that may be closer than the local wall
+  detail::BoundingBox local_box;
+  Real search_radius = 0.;
+  for(Uint i = 0; i != nb_nodes; ++i)
+  {
+    local_box.extend(detail::point3d(coords, i));
+    search_radius = std::max(search_radius, d[i][0]);
   }
+
+  std::vector<detail::WallFace> remote_faces;
+  detail::gather_remote_faces(wall_faces, local_box, search_radius, remote_faces);
+  detail::WallFaceTree remote_tree;
+  remote_tree.build(remote_faces);
+
+  detail::run_threaded(nb_nodes, nb_threads, [&](const Uint nodes_begin, const Uint nodes_end)
+  {
+    for(Uint inner_node_idx = nodes_begin; inner_node_idx != nodes_end; ++inner_node_idx)
+    {
+      if(is_surface_node[inner_node_idx])
+        continue;
+
+      const Real local_d = d[inner_node_idx][0];
+      Real d2 = local_d == no_wall ? no_wall : local_d*local_d;
+      Uint face_idx = 0;
+      if(remote_tree.closest_face(detail::point3d(coords, inner_node_idx), d2, face_idx))
+      {
+        d[inner_node_idx][0] = std::sqrt(d2);
+        node_to_wall_element[inner_node_idx][0] = 0;
+        node_to_wall_element[inner_node_idx][1] = inner_node_idx;
+        node_to_wall_element[inner_node_idx][2] = 0;
+      }
+    }
+  });
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -22,6 +22,11 @@ namespace actions {
 
 //////////////////////////////////////////////////////////////////////////////
 
+/// Compute the distance to the closest wall for each node of the mesh, stored in the field tagged "wall_distance".
+/// The table "node_to_wall_element" under the mesh links each node to the closest wall element. In parallel, nodes
+/// with the closest wall on another rank refer to themselves, with 0 in the first column.
+/// The nearest wall node or face is found using a bounding volume hierarchy, and in parallel only the wall faces that are
+/// within reach of the nodes of a rank are sent to it.
 class WallDistance : public MeshTransformer
 {
 public:
@@ -4,6 +4,12 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+
+#include <boost/cstdint.hpp>
 #include <boost/foreach.hpp>
 #include <boost/tokenizer.hpp>
 #include <boost/regex.hpp>
@@ -20,6 +26,7 @@
 #include "common/List.hpp"
 #include "common/DynTable.hpp"
 
+#include "common/PE/Comm.hpp"
 #include "common/PE/debug.hpp"
 
 #include "mesh/Region.hpp"
@@ -51,6 +58,246 @@ cf3::common::ComponentBuilder < gmsh::Reader, MeshReader, LibGmsh> aGmshReader_B
 
 //////////////////////////////////////////////////////////////////////////////
 
+namespace {
+
+/// Size of a node in a binary file: number and 3 coordinates
+const std::size_t binary_node_size = sizeof(boost::int32_t) + 3*sizeof(double);
+
+/// Powers of ten that are exactly representable as a double
+const double exact_powers_of_ten[] = { 1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                       1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+
+/// Cursor on a mapped range of a gmsh file, parsing numbers without going through iostreams
+struct Parser
+{
+  Parser(const char* begin, const char* end, const bool swap_bytes=false) :
+    p(begin), end(end), swap_bytes(swap_bytes) {}
+
+  void skip_space()
+  {
+    while (p != end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n'))
+      ++p;
+  }
+
+  /// Move to the start of the next line
+  void skip_line()
+  {
+    const char* eol = static_cast<const char*>(std::memchr(p, '\n', end-p));
+    p = eol ? eol+1 : end;
+  }
+
+  /// Rest of the current line, without trailing white space
+  std::string read_line()
+  {
+    const char* begin = p;
+    skip_line();
+    const char* line_end = p;
+    while (line_end != begin && std::isspace(static_cast<unsigned char>(*(line_end-1))))
+      --line_end;
+    return std::string(begin,line_end);
+  }
+
+  Uint parse_uint()
+  {
+    skip_space();
+    if (p == end || *p < '0' || *p > '9')
+      throw ParsingFailed(FromHere(), "Expected an unsigned integer in gmsh file, found \"" + excerpt() + "\"");
+    Uint value = 0;
+    for ( ; p != end && *p >= '0' && *p <= '9'; ++p)
+      value = 10*value + (*p-'0');
+    return value;
+  }
+
+  /// Parse a decimal number. It is computed directly when both the mantissa and the power of ten
+  /// are exact doubles, which makes the result correctly rounded, and by strtod otherwise.
+  Real parse_real()
+  {
+    skip_space();
+    const char* start = p;
+    bool negative = false;
+    if (p != end && (*p == '-' || *p == '+'))
+      negative = (*p++ == '-');
+
+    boost::uint64_t mantissa = 0;
+    int nb_digits = 0;
+    int exponent = 0;
+    bool exact = true;
+    bool has_digits = false;
+    for ( ; p != end && *p >= '0' && *p <= '9'; ++p)
+    {
+      has_digits = true;
+      if (nb_digits < 19)
+      {
+        mantissa = 10*mantissa + (*p-'0');
+        if (mantissa) ++nb_digits;
+      }
+      else
+      {
+        ++exponent;
+        exact &= (*p == '0');
+      }
+    }
+    if (p != end && *p == '.')
+    {
+      for (++p; p != end && *p >= '0' && *p <= '9'; ++p)
+      {
+        has_digits = true;
+        if (nb_digits < 19)
+        {
+          mantissa = 10*mantissa + (*p-'0');
+          if (mantissa) ++nb_digits;
+          --exponent;
+        }
+        else
+        {
+          exact &= (*p == '0');
+        }
+      }
+    }
+    if (has_digits && p != end && (*p == 'e' || *p == 'E'))
+    {
+      ++p;
+      bool negative_exponent = false;
+      if (p != end && (*p == '-' || *p == '+'))
+        negative_exponent = (*p++ == '-');
+      int value = 0;
+      for ( ; p != end && *p >= '0' && *p <= '9'; ++p)
+        if (value < 100000) value = 10*value + (*p-'0');
+      exponent += negative_exponent ? -value : value;
+    }
+
+    if (has_digits && exact && mantissa <= (boost::uint64_t(1) << 53) && exponent >= -22 && exponent <= 22)
+    {
+      const double value = exponent < 0 ? static_cast<double>(mantissa) / exact_powers_of_ten[-exponent]
+                                        : static_cast<double>(mantissa) * exact_powers_of_ten[exponent];
+      return static_cast<Real>(negative ? -value : value);
+    }
+
+    // The data of a section is always followed by its end marker, so strtod stops inside the mapped range
+    char* parsed_end;
+    const double value = std::strtod(start, &parsed_end);
+    if (parsed_end == start)
+    {
+      p = start;
+      throw ParsingFailed(FromHere(), "Expected a real number in gmsh file, found \"" + excerpt() + "\"");
+    }
+    p = parsed_end;
+    return static_cast<Real>(value);
+  }
+
+  /// Parse a string, stripping the quotes if it has them
+  std::string parse_quoted()
+  {
+    skip_space();
+    if (p != end && *p == '"')
+    {
+      const char* begin = ++p;
+      while (p != end && *p != '"' && *p != '\n')
+        ++p;
+      const std::string str(begin,p);
+      if (p != end && *p == '"')
+        ++p;
+      return str;
+    }
+    const char* begin = p;
+    while (p != end && !std::isspace(static_cast<unsigned char>(*p)))
+      ++p;
+    return std::string(begin,p);
+  }
+
+  template <typename T>
+  T read_binary()
+  {
+    if (static_cast<std::size_t>(end-p) < sizeof(T))
+      throw ParsingFailed(FromHere(), "Unexpected end of binary data in gmsh file");
+    T value;
+    if (swap_bytes)
+    {
+      char bytes[sizeof(T)];
+      std::reverse_copy(p, p+sizeof(T), bytes);
+      std::memcpy(&value, bytes, sizeof(T));
+    }
+    else
+    {
+      std::memcpy(&value, p, sizeof(T));
+    }
+    p += sizeof(T);
+    return value;
+  }
+
+  /// Start of the remaining text, for error messages
+  std::string excerpt() const
+  {
+    return std::string(p, p + std::min<std::ptrdiff_t>(end-p, 20));
+  }
+
+  const char* p;
+  const char* end;
+  bool swap_bytes;
+};
+
+/// Position of the first marker at the start of a line, searching from position "from".
+/// If the marker is not found, size is returned, or ParsingFailed is thrown if it is required.
+std::size_t find_marker(const char* data, const std::size_t size, std::size_t from, const std::string& marker, const bool required=true)
+{
+  while (from < size)
+  {
+    const char* found = static_cast<const char*>(std::memchr(data+from, marker[0], size-from));
+    if (!found)
+      break;
+    const std::size_t pos = found-data;
+    if ((pos == 0 || data[pos-1] == '\n') && size-pos >= marker.size() && std::memcmp(found, marker.data(), marker.size()) == 0)
+      return pos;
+    from = pos+1;
+  }
+  if (required)
+    throw ParsingFailed(FromHere(), "Gmsh file has no " + marker + " marker");
+  return size;
+}
+
+/// Start of the first line at or after position "target", clamped to [begin, end]
+std::size_t line_start(const char* data, const std::size_t begin, const std::size_t end, const std::size_t target)
+{
+  if (target <= begin)
+    return begin;
+  if (target >= end)
+    return end;
+  const char* eol = static_cast<const char*>(std::memchr(data+target-1, '\n', end-target+1));
+  return eol ? static_cast<std::size_t>(eol-data)+1 : end;
+}
+
+/// Index of the first of nb objects in chunk c of nb_chunks
+Uint split_point(const Uint nb, const Uint c, const Uint nb_chunks)
+{
+  return static_cast<Uint>(static_cast<boost::uint64_t>(nb)*c/nb_chunks);
+}
+
+template <typename T>
+void exchange(const std::vector< std::vector<T> >& send, std::vector< std::vector<T> >& recv)
+{
+  if (PE::Comm::instance().size() > 1)
+    PE::Comm::instance().all_to_all(send,recv);
+  else
+    recv = send;
+}
+
+/// Throw on all ranks if parsing failed on any rank, so that no rank keeps waiting in a collective operation
+void check_parsing_errors(const std::string& error)
+{
+  Uint nb_errors = error.empty() ? 0 : 1;
+  if (PE::Comm::instance().size() > 1)
+  {
+    const Uint local_nb_errors = nb_errors;
+    PE::Comm::instance().all_reduce(PE::plus(),&local_nb_errors,1,&nb_errors);
+  }
+  if (nb_errors)
+    throw ParsingFailed(FromHere(), error.empty() ? std::string("Reading the gmsh file failed on another rank") : error);
+}
+
+} // namespace
+
+//////////////////////////////////////////////////////////////////////////////
+
 Reader::Reader( const std::string& name )
 : MeshReader(name),
   Shared()
@@ -71,6 +318,11 @@ Reader::Reader( const std::string& name )
       .pretty_name("Read Fields")
       .mark_basic();
 
+  options().add("nb_io_ranks", 4u)
+      .description("Number of ranks reading the nodes and elements from the file, each parsing a part of it. "
+                   "Limited to the number of processes.")
+      .pretty_name("Number of I/O Ranks");
+
   // properties
 
   properties()["brief"] = std::string("Gmsh file reader component");
@@ -100,14 +352,9 @@ std::vector<std::string> Reader::get_extensions()
 void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
 {
 
-  // if the file is present open it
+  // if the file is not present throw exception
   boost::filesystem::path fp (file.path());
-  if( boost::filesystem::exists(fp) )
-  {
-    CFinfo <<  "Opening file " <<  fp.string() << CFendl;
-    m_file.open(fp,std::ios_base::in); // exists so open it
-  }
-  else // doesnt exist so throw exception
+  if( !boost::filesystem::exists(fp) )
   {
      throw boost::filesystem::filesystem_error( fp.string() + " does not exist", boost::system::error_code() );
   }
@@ -121,145 +368,367 @@ void Reader::do_read_mesh_into(const URI& file, Mesh& mesh)
   // NOTE: since gmsh contains several 'physical entities' in one mesh, we create one region per physical entity
   m_region = Handle<Region>(m_mesh->topology().handle<Component>());
 
-  // Read file once and store positions
-  get_file_positions();
-  cf3_assert(m_hash);
+  // Only the I/O ranks map the file
+  const Uint nb_io_ranks = std::max(1u, std::min(options().value<Uint>("nb_io_ranks"), PE::Comm::instance().size()));
+  m_node_chunks.assign(nb_io_ranks, Chunk());
+  m_elem_chunks.assign(nb_io_ranks, Chunk());
+
+  bool is_io_rank = false;
+  for (Uint c=0; c<nb_io_ranks; ++c)
+    is_io_rank |= (io_rank_of_chunk(c) == PE::Comm::instance().rank());
+
+  std::string error;
+  try
+  {
+    if (is_io_rank)
+    {
+      CFinfo <<  "Opening file " <<  fp.string() << CFendl;
+      m_mapped_file.open(fp.string());
+    }
+    // Read the file layout once and distribute it
+    if (PE::Comm::instance().rank() == IO_rank)
+      scan_file_layout();
+  }
+  catch (std::exception& e)
+  {
+    error = e.what();
+  }
+  check_parsing_errors(error);
+  broadcast_file_layout();
+
+  //Create a hash
+  m_hash = create_component<MergedParallelDistribution>("hash");
+  std::vector<Uint> num_obj(2);
+  num_obj[0] = m_total_nb_nodes;
+  num_obj[1] = m_total_nb_elements;
+  m_hash->options().set("nb_parts",options().value<Uint>("nb_parts"));
+  m_hash->options().set("nb_obj",num_obj);
 
   m_mesh->initialize_nodes(0, m_mesh_dimension);
 
-  find_used_nodes();
+  read_elements();
   read_coordinates();
+  if (m_mapped_file.is_open())
+    m_mapped_file.close();
   read_connectivity();
 
   fix_negative_volumes(*m_mesh);
 
   if (options().value<bool>("read_fields"))
   {
-    read_element_node_data();
-    read_node_data();
+    if (m_element_node_data_positions.size() || m_node_data_positions.size())
+    {
+      if (m_binary)
+      {
+        CFwarn << "Field data in binary gmsh file " << fp.string() << " is not read" << CFendl;
+      }
+      else
+      {
+        m_file.open(fp,std::ios_base::in);
+        read_element_node_data();
+        read_node_data();
+        m_file.close();
+      }
+    }
   }
 
-  m_node_idx_gmsh_to_cf.clear();
-  m_elem_idx_gmsh_to_cf.clear();
-
   // clean-up
-  m_ghost_nodes.clear();
-  m_used_nodes.clear();
   m_node_idx_gmsh_to_cf.clear();
+  m_elem_idx_gmsh_to_cf.clear();
+  std::vector<Uint>().swap(m_elements);
   if (is_not_null(m_hash))
     remove_component(*m_hash);
 
-  // close the file
-  m_file.close();
-
   mesh.raise_mesh_loaded();
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Reader::get_file_positions()
+void Reader::scan_file_layout()
 {
-  std::string region_names("$PhysicalNames");
-  std::string nodes("$Nodes");
-  std::string elements("$Elements");
-  std::string element_data("$ElementData");
-  std::string node_data("$NodeData");
-  std::string element_node_data("$ElementNodeData");
-
+  const char* data = m_mapped_file.data();
+  const std::size_t size = m_mapped_file.size();
+
+  m_binary = false;
+  m_swap_bytes = false;
+  m_nb_regions = 0;
+  m_region_list.clear();
+  m_mesh_dimension = options().value<Uint>("dimension");
+  m_total_nb_nodes = 0;
+  m_total_nb_elements = 0;
   m_element_data_positions.clear();
   m_node_data_positions.clear();
   m_element_node_data_positions.clear();
-  m_elements_position=0;
-  std::streampos p;
-  std::string line;
-  while (!m_file.eof())
+
+  std::size_t nodes_begin(0), nodes_end(0), elems_begin(0), elems_end(0);
+  std::vector<Chunk> elem_blocks;
+
+  // Jump from section to section. Only the $Nodes and $Elements sections are large, and their end
+  // is found with memchr in ASCII files, or computed from the record sizes in binary files
+  std::size_t pos = find_marker(data, size, 0, "$");
+  while (pos != size)
   {
-    p = m_file.tellg();
-    getline(m_file,line);
-    if (line.find(region_names)!=std::string::npos) {
-      m_region_names_position=p;
-      m_file >> m_nb_regions;
-      m_region_list.resize(m_nb_regions);
+    Parser parser(data+pos, data+size, m_swap_bytes);
+    const std::string name = parser.read_line().substr(1);
+    std::size_t body_end = parser.p - data;
 
-      m_nb_gmsh_elem_in_region.resize(m_nb_regions);
-      for(Uint ir = 0; ir < m_nb_regions; ++ir)
+    if (name == "MeshFormat")
+    {
+      const Real version = parser.parse_real();
+      const Uint file_type = parser.parse_uint();
+      const Uint data_size = parser.parse_uint();
+      parser.skip_line();
+      if (version < 2. || version >= 3.)
+        throw FileFormatError(FromHere(), "Only version 2 of the gmsh format is supported, file has version " + to_str(version));
+      if (file_type == 1)
       {
-        m_nb_gmsh_elem_in_region[ir].resize(Shared::nb_gmsh_types);
-        for(Uint type = 0; type < Shared::nb_gmsh_types; ++ type)
-           (m_nb_gmsh_elem_in_region[ir])[type] = 0;
+        if (data_size != sizeof(double))
+          throw FileFormatError(FromHere(), "Binary gmsh files must store reals as 8 byte doubles");
+        m_binary = true;
+        // The integer 1, written in the endianness of the machine that wrote the file
+        if (parser.read_binary<boost::int32_t>() != 1)
+        {
+          parser.p -= sizeof(boost::int32_t);
+          parser.swap_bytes = true;
+          if (parser.read_binary<boost::int32_t>() != 1)
+            throw FileFormatError(FromHere(), "Binary gmsh file has an invalid endianness marker");
+          m_swap_bytes = true;
+        }
       }
-
-      m_mesh_dimension = options().value<Uint>("dimension");
+      body_end = parser.p - data;
+    }
+    else if (name == "PhysicalNames")
+    {
+      m_nb_regions = parser.parse_uint();
+      m_region_list.resize(m_nb_regions);
       for(Uint ir = 0; ir < m_nb_regions; ++ir)
       {
-        Uint phys_group_dimensionality;
-        Uint phys_group_index;
-        std::string phys_group_name;
-        m_file >> phys_group_dimensionality >> phys_group_index >> phys_group_name;
+        const Uint phys_group_dimensionality = parser.parse_uint();
+        const Uint phys_group_index = parser.parse_uint();
+        //The original name of the region in the mesh file has quotes, we want to strip them off
+        const std::string phys_group_name = parser.parse_quoted();
+        if (phys_group_index == 0 || phys_group_index > m_nb_regions)
+          throw ParsingFailed(FromHere(), "Physical group \"" + phys_group_name + "\" has index " + to_str(phys_group_index) + ", indices must range from 1 to " + to_str(m_nb_regions));
         m_region_list[phys_group_index-1].dim=phys_group_dimensionality;
         m_region_list[phys_group_index-1].index=phys_group_index;
-        //The original name of the region in the mesh file has quotes, we want to strip them off
-        m_region_list[phys_group_index-1].name=phys_group_name.substr(1,phys_group_name.length()-2);
-        m_region_list[phys_group_index-1].region = create_region(m_region_list[phys_group_index-1].name);
-        m_mesh_dimension = std::max(m_region_list[phys_group_index-1].dim,m_mesh_dimension);
+        m_region_list[phys_group_index-1].name=phys_group_name;
+        m_mesh_dimension = std::max(phys_group_dimensionality,m_mesh_dimension);
       }
+      body_end = parser.p - data;
     }
-    else if (line.find(nodes)!=std::string::npos) {
-      m_coordinates_position=p;
-      m_file >> m_total_nb_nodes;
-//      CFinfo << "The total number of nodes is " << m_total_nb_nodes << CFendl;
+    else if (name == "Nodes")
+    {
+      m_total_nb_nodes = parser.parse_uint();
+      parser.skip_line();
       if (m_total_nb_nodes == 0) throw ParsingFailed(FromHere(),"File contains no nodes");
+      nodes_begin = parser.p - data;
+      if (m_binary)
+      {
+        nodes_end = nodes_begin + static_cast<std::size_t>(m_total_nb_nodes)*binary_node_size;
+        if (nodes_end > size)
+          throw ParsingFailed(FromHere(), "Binary gmsh file is truncated in the $Nodes section");
+      }
+      else
+      {
+        nodes_end = find_marker(data, size, nodes_begin, "$EndNodes");
+      }
+      body_end = nodes_end;
     }
-    else if (line.find(elements)!=std::string::npos)
+    else if (name == "Elements")
     {
-      m_elements_position = p;
-      m_file >> m_total_nb_elements;
-//      CFinfo << "The total number of elements is " << m_total_nb_elements << CFendl;
+      m_total_nb_elements = parser.parse_uint();
+      parser.skip_line();
       if (m_total_nb_elements == 0) throw ParsingFailed(FromHere(),"File contains no elements");
-      //Create a hash
-      m_hash = create_component<MergedParallelDistribution>("hash");
-      std::vector<Uint> num_obj(2);
-      num_obj[0] = m_total_nb_nodes;
-      num_obj[1] = m_total_nb_elements;
-      m_hash->options().set("nb_parts",options().value<Uint>("nb_parts"));
-      m_hash->options().set("nb_obj",num_obj);
-
-
-      Uint elem_idx, elem_type, nb_tags, phys_tag;
-
-      //Let's count how many elements of each type are present
-      for(Uint ie = 0; ie < m_total_nb_elements; ++ie)
+      elems_begin = parser.p - data;
+      if (m_binary)
       {
-          m_file >> elem_idx;
-          m_file >> elem_type;
-          m_file >> nb_tags;
-          m_file >> phys_tag;
-          cf3_assert(phys_tag > 0);
-          getline(m_file,line);
-          if (m_hash->subhash(ELEMS).owns(ie))
-            (m_nb_gmsh_elem_in_region[phys_tag-1])[elem_type]++;
-          m_region_list[phys_tag-1].element_types.insert(elem_type);
+        // Walk the headers of the element blocks
+        Parser blocks(data+elems_begin, data+size, m_swap_bytes);
+        for (Uint count=0; count<m_total_nb_elements; )
+        {
+          Chunk block;
+          block.begin = blocks.p - data;
+          block.elem_type = blocks.read_binary<boost::int32_t>();
+          block.remaining = blocks.read_binary<boost::int32_t>();
+          block.nb_tags = blocks.read_binary<boost::int32_t>();
+          check_element_type(block.elem_type);
+          const std::size_t block_size = static_cast<std::size_t>(block.remaining)*binary_element_size(block.elem_type,block.nb_tags);
+          if (block_size > static_cast<std::size_t>(blocks.end-blocks.p))
+            throw ParsingFailed(FromHere(), "Binary gmsh file is truncated in the $Elements section");
+          blocks.p += block_size;
+          block.end = blocks.p - data;
+          elem_blocks.push_back(block);
+          count += block.remaining;
+        }
+        elems_end = blocks.p - data;
       }
+      else
+      {
+        elems_end = find_marker(data, size, elems_begin, "$EndElements");
+      }
+      body_end = elems_end;
     }
-    else if (line.find(element_data)!=std::string::npos)
+    else if (name == "ElementData")
     {
-      m_element_data_positions.push_back(p);
+      m_element_data_positions.push_back(pos);
     }
-    else if (line.find(node_data)!=std::string::npos)
+    else if (name == "NodeData")
     {
-      m_node_data_positions.push_back(p);
+      m_node_data_positions.push_back(pos);
     }
-    else if (line.find(element_node_data)!=std::string::npos)
+    else if (name == "ElementNodeData")
     {
-      m_element_node_data_positions.push_back(p);
+      m_element_node_data_positions.push_back(pos);
     }
 
+    // Move past the end marker of the section, to the next section
+    Parser end_marker(data+find_marker(data, size, body_end, "$End"+name), data+size);
+    end_marker.skip_line();
+    pos = find_marker(data, size, end_marker.p-data, "$", false);
   }
-  if (m_elements_position==0)
-  {
+
+  if (m_total_nb_nodes == 0)
+    throw ParsingFailed(FromHere(),"File does not contain any nodes");
+  if (m_total_nb_elements == 0)
     throw ParsingFailed(FromHere(),"File does not contain any elements");
+
+  compute_chunks(nodes_begin, nodes_end, elems_begin, elems_end, elem_blocks);
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::compute_chunks(const std::size_t nodes_begin, const std::size_t nodes_end,
+                            const std::size_t elems_begin, const std::size_t elems_end,
+                            const std::vector<Chunk>& elem_blocks)
+{
+  const char* data = m_mapped_file.data();
+  const Uint nb_chunks = m_node_chunks.size();
+  const Chunk empty = { 0, 0, 0, 0, 0 };
+
+  for (Uint c=0; c<nb_chunks; ++c)
+  {
+    m_node_chunks[c] = empty;
+    m_elem_chunks[c] = empty;
+    if (m_binary)
+    {
+      m_node_chunks[c].begin = nodes_begin + static_cast<std::size_t>(split_point(m_total_nb_nodes,c,nb_chunks))*binary_node_size;
+      m_node_chunks[c].end = nodes_begin + static_cast<std::size_t>(split_point(m_total_nb_nodes,c+1,nb_chunks))*binary_node_size;
+    }
+    else
+    {
+      // Split in equal byte ranges, moved forward to the start of a line
+      m_node_chunks[c].begin = line_start(data, nodes_begin, nodes_end, nodes_begin + (nodes_end-nodes_begin)*c/nb_chunks);
+      m_node_chunks[c].end = line_start(data, nodes_begin, nodes_end, nodes_begin + (nodes_end-nodes_begin)*(c+1)/nb_chunks);
+      m_elem_chunks[c].begin = line_start(data, elems_begin, elems_end, elems_begin + (elems_end-elems_begin)*c/nb_chunks);
+      m_elem_chunks[c].end = line_start(data, elems_begin, elems_end, elems_begin + (elems_end-elems_begin)*(c+1)/nb_chunks);
+    }
   }
-  m_file.clear();
+
+  if (m_binary)
+  {
+    // Split in equal numbers of elements, starting chunks inside element blocks when needed
+    m_elem_chunks[0].begin = elems_begin;
+    Uint c = 1;
+    Uint count = 0;
+    boost_foreach(const Chunk& block, elem_blocks)
+    {
+      const std::size_t records_begin = block.begin + 3*sizeof(boost::int32_t);
+      const std::size_t element_size = binary_element_size(block.elem_type,block.nb_tags);
+      for ( ; c<nb_chunks && split_point(m_total_nb_elements,c,nb_chunks) < count+block.remaining; ++c)
+      {
+        const Uint offset = split_point(m_total_nb_elements,c,nb_chunks) - count;
+        if (offset == 0)
+        {
+          m_elem_chunks[c].begin = block.begin;
+        }
+        else
+        {
+          m_elem_chunks[c].begin = records_begin + offset*element_size;
+          m_elem_chunks[c].elem_type = block.elem_type;
+          m_elem_chunks[c].nb_tags = block.nb_tags;
+          m_elem_chunks[c].remaining = block.remaining - offset;
+        }
+        m_elem_chunks[c-1].end = m_elem_chunks[c].begin;
+      }
+      count += block.remaining;
+    }
+    for ( ; c<nb_chunks; ++c)
+    {
+      m_elem_chunks[c].begin = elems_end;
+      m_elem_chunks[c-1].end = elems_end;
+    }
+    m_elem_chunks[nb_chunks-1].end = elems_end;
+  }
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+Uint Reader::io_rank_of_chunk(const Uint chunk) const
+{
+  // Spread the I/O ranks evenly over all ranks, so that they don't share a compute node
+  return static_cast<Uint>(static_cast<boost::uint64_t>(chunk)*PE::Comm::instance().size()/m_node_chunks.size());
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+void Reader::broadcast_file_layout()
+{
+  if (PE::Comm::instance().size() > 1)
+  {
+    std::vector<char> send, recv;
+    if (PE::Comm::instance().rank() == IO_rank)
+    {
+      std::ostringstream out;
+      out << m_binary << " " << m_swap_bytes << " " << m_mesh_dimension << " "
+          << m_total_nb_nodes << " " << m_total_nb_elements << " " << m_nb_regions << "\n";
+      boost_foreach(const RegionData& region_data, m_region_list)
+        out << region_data.dim << " " << region_data.index << "\n" << region_data.name << "\n";
+      for (Uint c=0; c<m_node_chunks.size(); ++c)
+      {
+        out << m_node_chunks[c].begin << " " << m_node_chunks[c].end << "\n";
+        out << m_elem_chunks[c].begin << " " << m_elem_chunks[c].end << " " << m_elem_chunks[c].elem_type << " "
+            << m_elem_chunks[c].nb_tags << " " << m_elem_chunks[c].remaining << "\n";
+      }
+      out << m_element_data_positions.size() << " " << m_node_data_positions.size() << " " << m_element_node_data_positions.size() << "\n";
+      boost_foreach(const std::streampos& p, m_element_data_positions)      out << static_cast<boost::uint64_t>(p) << "\n";
+      boost_foreach(const std::streampos& p, m_node_data_positions)         out << static_cast<boost::uint64_t>(p) << "\n";
+      boost_foreach(const std::streampos& p, m_element_node_data_positions) out << static_cast<boost::uint64_t>(p) << "\n";
+      const std::string layout = out.str();
+      send.assign(layout.begin(),layout.end());
+    }
+    PE::Comm::instance().broadcast(send,recv,IO_rank);
+
+    if (PE::Comm::instance().rank() != IO_rank)
+    {
+      std::istringstream in(std::string(recv.begin(),recv.end()));
+      in >> m_binary >> m_swap_bytes >> m_mesh_dimension >> m_total_nb_nodes >> m_total_nb_elements >> m_nb_regions;
+      m_region_list.clear();
+      m_region_list.resize(m_nb_regions);
+      boost_foreach(RegionData& region_data, m_region_list)
+      {
+        in >> region_data.dim >> region_data.index >> std::ws;
+        getline(in,region_data.name);
+      }
+      for (Uint c=0; c<m_node_chunks.size(); ++c)
+      {
+        in >> m_node_chunks[c].begin >> m_node_chunks[c].end;
+        in >> m_elem_chunks[c].begin >> m_elem_chunks[c].end >> m_elem_chunks[c].elem_type
+           >> m_elem_chunks[c].nb_tags >> m_elem_chunks[c].remaining;
+      }
+      std::size_t nb_element_data, nb_node_data, nb_element_node_data;
+      boost::uint64_t p;
+      in >> nb_element_data >> nb_node_data >> nb_element_node_data;
+      m_element_data_positions.clear();
+      m_node_data_positions.clear();
+      m_element_node_data_positions.clear();
+      for (std::size_t i=0; i<nb_element_data; ++i)      { in >> p; m_element_data_positions.push_back(std::streamoff(p)); }
+      for (std::size_t i=0; i<nb_node_data; ++i)         { in >> p; m_node_data_positions.push_back(std::streamoff(p)); }
+      for (std::size_t i=0; i<nb_element_node_data; ++i) { in >> p; m_element_node_data_positions.push_back(std::streamoff(p)); }
+    }
+  }
+
+  boost_foreach(RegionData& region_data, m_region_list)
+    region_data.region = create_region(region_data.name);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -283,217 +752,369 @@ Handle< Region > Reader::create_region(std::string const& relative_path)
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Reader::find_used_nodes()
+void Reader::check_element_type(const Uint gmsh_type) const
 {
-  m_used_nodes.clear();
-  std::string line;
+  if (gmsh_type == 0 || gmsh_type >= Shared::nb_gmsh_types || Shared::m_nodes_in_gmsh_elem[gmsh_type] == 0)
+    throw ParsingFailed(FromHere(), "Gmsh element type " + to_str(gmsh_type) + " is not supported");
+}
 
-  m_file.seekg(m_elements_position,std::ios::beg);
-  // skip next line
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "header = " << line << std::endl;
-  //Skip the line containing the actual number of elements
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "nb_elems = " << line << std::endl;
+//////////////////////////////////////////////////////////////////////////////
+
+std::size_t Reader::binary_element_size(const Uint gmsh_type, const Uint nb_tags) const
+{
+  return (1 + nb_tags + Shared::m_nodes_in_gmsh_elem[gmsh_type])*sizeof(boost::int32_t);
+}
 
-  // read every line and store the connectivity in the correct region through the buffer
-  Uint elementNumber, elementType, nbElementNodes;
-  Uint gmsh_node_number, nb_tags, phys_tag, other_tag;
+//////////////////////////////////////////////////////////////////////////////
 
-  std::set<Uint>::iterator it=m_used_nodes.begin();
+Uint Reader::parse_elements(const Chunk& chunk, std::vector<Uint>& elements) const
+{
+  Parser parser(m_mapped_file.data()+chunk.begin, m_mapped_file.data()+chunk.end, m_swap_bytes);
+  Uint nb_elems = 0;
+  Uint element_number, gmsh_element_type, nb_tags, phys_tag;
+  Uint remaining = chunk.remaining;
+  if (m_binary)
+  {
+    gmsh_element_type = chunk.elem_type;
+    nb_tags = chunk.nb_tags;
+  }
 
-//  if (PE::Comm::instance().rank()==IO_rank)
-//  {
-//    std::cout << "nb_obj = "   << m_hash->subhash(ELEMS).options()["nb_obj"].value<Uint>() << std::endl;
-//    std::cout << "nb_parts = " <<m_hash->subhash(ELEMS).options()["nb_parts"].value<Uint>() << std::endl;
-//  }
-  for (Uint i=0; i<m_total_nb_elements; ++i)
+  while (true)
   {
-//    if (m_total_nb_elements > 100000)
-//    {
-//      if(i%(m_total_nb_elements/20)==0)
-//        CFinfo << 100*i/m_total_nb_elements << "% " << CFflush;
-//    }
-
-    cf3_assert(m_hash);
-    if (m_hash->subhash(ELEMS).owns(i))
+    if (m_binary)
     {
-      // element description
-      m_file >> elementNumber >> elementType;
-      nbElementNodes = Shared::m_nodes_in_gmsh_elem[elementType];
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << i << ":  elem["<<m_hash->subhash(ELEMS).part_of_obj(i)<<"] " << elementNumber << " :    ";
-      m_file >> nb_tags;
-      m_file >> phys_tag;
-      for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
-
-      for (Uint j=0; j<nbElementNodes; ++j)
+      if (parser.p == parser.end)
+        break;
+      if (remaining == 0)
       {
-        m_file >> gmsh_node_number;
-        it = m_used_nodes.insert(it,gmsh_node_number);
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "  " << gmsh_node_number;
+        // Header of the next element block
+        gmsh_element_type = parser.read_binary<boost::int32_t>();
+        remaining = parser.read_binary<boost::int32_t>();
+        nb_tags = parser.read_binary<boost::int32_t>();
+        check_element_type(gmsh_element_type);
+        continue;
       }
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << "\n";
+      element_number = parser.read_binary<boost::int32_t>();
+      if (nb_tags == 0)
+        throw ParsingFailed(FromHere(), "Element " + to_str(element_number) + " has no physical tag");
+      phys_tag = parser.read_binary<boost::int32_t>();
+      for(Uint itag = 1; itag < nb_tags; ++itag)
+        parser.read_binary<boost::int32_t>();
+      --remaining;
+    }
+    else
+    {
+      parser.skip_space();
+      if (parser.p == parser.end)
+        break;
+      element_number = parser.parse_uint();
+      gmsh_element_type = parser.parse_uint();
+      check_element_type(gmsh_element_type);
+      nb_tags = parser.parse_uint();
+      if (nb_tags == 0)
+        throw ParsingFailed(FromHere(), "Element " + to_str(element_number) + " has no physical tag");
+      phys_tag = parser.parse_uint();
+      for(Uint itag = 1; itag < nb_tags; ++itag)
+        parser.parse_uint();
     }
-    getline(m_file,line); // finnish the line
-  }
 
-  // Now we have all nodes, used by the elements
+    if (phys_tag == 0 || phys_tag > m_nb_regions)
+      throw ParsingFailed(FromHere(), "Element " + to_str(element_number) + " has physical tag " + to_str(phys_tag) + " which is not in $PhysicalNames");
 
-  // Now add owned nodes
-  m_file.seekg(m_coordinates_position,std::ios::beg);
-  //Skip the line with keyword '$Nodes':
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "header = " << line << std::endl;
-  // skip one line, which says how many (total) nodes are  present in the mesh
-  getline(m_file,line);
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << "nb_nodes = " << line << std::endl;
+    elements.push_back(element_number);
+    elements.push_back(gmsh_element_type);
+    elements.push_back(phys_tag);
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
+    for (Uint j=0; j<nb_element_nodes; ++j)
+      elements.push_back(m_binary ? static_cast<Uint>(parser.read_binary<boost::int32_t>()) : parser.parse_uint());
+    ++nb_elems;
+  }
+  return nb_elems;
+}
 
-  for (Uint node_idx=0; node_idx<m_total_nb_nodes; ++node_idx)
+//////////////////////////////////////////////////////////////////////////////
+
+Uint Reader::parse_nodes(const Chunk& chunk, std::vector<Uint>& numbers, std::vector<Real>& coordinates) const
+{
+  Parser parser(m_mapped_file.data()+chunk.begin, m_mapped_file.data()+chunk.end, m_swap_bytes);
+  Uint nb_nodes = 0;
+  while (true)
   {
-//    if (m_total_nb_nodes > 100000)
-//    {
-//      if(node_idx%(m_total_nb_nodes/20)==0)
-//        CFinfo << 100*node_idx/m_total_nb_nodes << "% " << CFflush;
-//      if (node_idx == m_total_nb_nodes-1)
-//        CFinfo << CFendl;
-//    }
-    getline(m_file,line);
-
-    std::stringstream ss(line);
-    ss >> gmsh_node_number;
-    getline(ss,line);
-    if (m_hash->subhash(NODES).owns(node_idx))
+    if (m_binary)
     {
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << "node " << gmsh_node_number << "\n";
-
-      it = m_used_nodes.insert(it,gmsh_node_number);
+      if (parser.p == parser.end)
+        break;
+      numbers.push_back(parser.read_binary<boost::int32_t>());
+      //Gmsh always stores 3 coordinates, even for 2D meshes
+      for (Uint dim=0; dim<DIM_3D; ++dim)
+        coordinates.push_back(parser.read_binary<double>());
     }
     else
     {
-      it = m_used_nodes.find(gmsh_node_number);
-      if (it != m_used_nodes.end())
-      {
-        m_ghost_nodes.insert(node_idx);
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "ghostnode " << gmsh_node_number << "\n";
-      }
+      parser.skip_space();
+      if (parser.p == parser.end)
+        break;
+      numbers.push_back(parser.parse_uint());
+      for (Uint dim=0; dim<DIM_3D; ++dim)
+        coordinates.push_back(parser.parse_real());
     }
+    ++nb_nodes;
   }
-//  if (PE::Comm::instance().rank()==IO_rank)
-//    std::cout << std::flush;
+  return nb_nodes;
 }
 
 //////////////////////////////////////////////////////////////////////////////
 
-void Reader::read_coordinates()
+Uint Reader::first_parsed_index(const Uint nb_parsed, const Uint nb_total, const std::string& entity_name) const
 {
+  std::vector<Uint> nb_parsed_per_rank(1,nb_parsed);
+  if (PE::Comm::instance().size() > 1)
+    PE::Comm::instance().all_gather(nb_parsed,nb_parsed_per_rank);
 
-  m_file.seekg(m_coordinates_position,std::ios::beg);
+  Uint first_index = 0;
+  Uint total = 0;
+  for (Uint r=0; r<nb_parsed_per_rank.size(); ++r)
+  {
+    if (r < PE::Comm::instance().rank())
+      first_index += nb_parsed_per_rank[r];
+    total += nb_parsed_per_rank[r];
+  }
+  if (total != nb_total)
+    throw ParsingFailed(FromHere(), "Gmsh file announces " + to_str(nb_total) + " " + entity_name + ", but contains " + to_str(total));
+  return first_index;
+}
 
-  Dictionary& nodes = m_mesh->geometry_fields();
-  nodes.resize(m_used_nodes.size());
-  m_used_nodes.clear();
+//////////////////////////////////////////////////////////////////////////////
 
-  Uint part = options().value<Uint>("part");
+void Reader::read_elements()
+{
+  const Uint rank = PE::Comm::instance().rank();
 
-  std::string line;
-  //Skip the line with keyword '$Nodes':
-  getline(m_file,line);
-//  CFinfo << line << CFendl;
-  // skip one line, which says how many (total) nodes are  present in the mesh
-  getline(m_file,line);
-//  CFinfo << line << CFendl;
+  // Parse the chunk of this rank, if it is an I/O rank
+  std::vector<Uint> parsed;
+  Uint nb_parsed = 0;
+  std::string error;
+  try
+  {
+    for (Uint c=0; c<m_elem_chunks.size(); ++c)
+    {
+      if (io_rank_of_chunk(c) == rank)
+        nb_parsed += parse_elements(m_elem_chunks[c],parsed);
+    }
+  }
+  catch (std::exception& e)
+  {
+    error = e.what();
+  }
+  check_parsing_errors(error);
 
+  // The chunks are in file order, so the elements parsed by lower ranks come first
+  Uint elem_idx = first_parsed_index(nb_parsed,m_total_nb_elements,"elements");
 
-  // declare and allocate one coordinate row
-//  std::vector<Real> rowVector(m_mesh_dimension);
+  // Send every element to the rank owning it
+  const ParallelDistribution& distribution = m_hash->subhash(ELEMS);
+  std::vector< std::vector<Uint> > send(PE::Comm::instance().size());
+  std::vector< std::vector<Uint> > recv;
+  for (std::size_t i=0; i<parsed.size(); ++elem_idx)
+  {
+    const Uint record_size = 3 + Shared::m_nodes_in_gmsh_elem[parsed[i+1]];
+    std::vector<Uint>& dest = send[distribution.proc_of_obj(elem_idx)];
+    dest.insert(dest.end(),parsed.begin()+i,parsed.begin()+i+record_size);
+    i += record_size;
+  }
+  std::vector<Uint>().swap(parsed);
+  exchange(send,recv);
 
-  std::set<Uint>::const_iterator it;
+  m_elements.clear();
+  boost_foreach(const std::vector<Uint>& received, recv)
+    m_elements.insert(m_elements.end(),received.begin(),received.end());
+}
 
-  Uint coord_idx=0;
-  Uint gmsh_node_number;
+//////////////////////////////////////////////////////////////////////////////
 
-  for (Uint node_idx=0; node_idx<m_total_nb_nodes; ++node_idx)
+void Reader::read_coordinates()
+{
+  const Uint rank = PE::Comm::instance().rank();
+  const Uint nb_procs = PE::Comm::instance().size();
+  const ParallelDistribution& distribution = m_hash->subhash(NODES);
+
+  // Parse the chunk of this rank, if it is an I/O rank
+  std::vector<Uint> parsed_numbers;
+  std::vector<Real> parsed_coordinates;
+  Uint nb_parsed = 0;
+  std::string error;
+  try
   {
-//    if (m_total_nb_nodes > 100000)
-//    {
-//      if(node_idx%(m_total_nb_nodes/20)==0)
-//        CFinfo << 100*node_idx/m_total_nb_nodes << "% " << CFflush;
-//      if(node_idx==m_total_nb_nodes-1)
-//        CFinfo << CFendl;
-//    }
-    getline(m_file,line);
-//    CFinfo << line << CFendl;
-    if (m_hash->subhash(NODES).owns(node_idx))
+    for (Uint c=0; c<m_node_chunks.size(); ++c)
     {
-      std::stringstream ss(line);
-      ss >> gmsh_node_number;
-      m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
+      if (io_rank_of_chunk(c) == rank)
+        nb_parsed += parse_nodes(m_node_chunks[c],parsed_numbers,parsed_coordinates);
+    }
+  }
+  catch (std::exception& e)
+  {
+    error = e.what();
+  }
+  check_parsing_errors(error);
 
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
+  Uint node_idx = first_parsed_index(nb_parsed,m_total_nb_nodes,"nodes");
 
-      for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-      if(m_mesh_dimension < DIM_3D) getline(ss,line); //Gmsh always stores 3 coordinates, even for 2D meshes
+  // Send every node to the rank owning it, as (gmsh number, part) and coordinates
+  std::vector< std::vector<Uint> > send_numbers(nb_procs), recv_numbers;
+  std::vector< std::vector<Real> > send_coordinates(nb_procs), recv_coordinates;
+  Uint nb_renumbered = 0;
+  for (Uint n=0; n<nb_parsed; ++n, ++node_idx)
+  {
+    if (parsed_numbers[n] != node_idx+1)
+      ++nb_renumbered;
+    const Uint dest = distribution.proc_of_obj(node_idx);
+    send_numbers[dest].push_back(parsed_numbers[n]);
+    send_numbers[dest].push_back(distribution.part_of_obj(node_idx));
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      send_coordinates[dest].push_back(parsed_coordinates[DIM_3D*n+dim]);
+  }
+  std::vector<Uint>().swap(parsed_numbers);
+  std::vector<Real>().swap(parsed_coordinates);
+  exchange(send_numbers,recv_numbers);
+  exchange(send_coordinates,recv_coordinates);
+
+  // Owned nodes, in file order
+  std::vector<Uint> owned_numbers;
+  std::vector<Uint> owned_parts;
+  std::vector<Real> owned_coordinates;
+  for (Uint r=0; r<recv_numbers.size(); ++r)
+  {
+    for (Uint i=0; i<recv_numbers[r].size(); i+=2)
+    {
+      m_node_idx_gmsh_to_cf[recv_numbers[r][i]] = owned_numbers.size();
+      owned_numbers.push_back(recv_numbers[r][i]);
+      owned_parts.push_back(recv_numbers[r][i+1]);
+    }
+    owned_coordinates.insert(owned_coordinates.end(),recv_coordinates[r].begin(),recv_coordinates[r].end());
+  }
 
-      nodes.rank()[coord_idx] = part;
-      nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
+  // Nodes used by the owned elements, but owned by other ranks
+  std::set<Uint> ghost_set;
+  for (std::size_t i=0; i<m_elements.size(); )
+  {
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[m_elements[i+1]];
+    for (Uint j=0; j<nb_element_nodes; ++j)
+    {
+      const Uint gmsh_node_number = m_elements[i+3+j];
+      if (m_node_idx_gmsh_to_cf.find(gmsh_node_number) == m_node_idx_gmsh_to_cf.end())
+        ghost_set.insert(gmsh_node_number);
+    }
+    i += 3+nb_element_nodes;
+  }
+  const std::vector<Uint> ghost_numbers(ghost_set.begin(),ghost_set.end());
+  ghost_set.clear();
 
-      coord_idx++;
+  // Find the rank owning each ghost node
+  if (nb_procs > 1)
+  {
+    Uint total_nb_renumbered;
+    PE::Comm::instance().all_reduce(PE::plus(),&nb_renumbered,1,&total_nb_renumbered);
+    nb_renumbered = total_nb_renumbered;
+  }
+  std::vector<Uint> ghost_owners(ghost_numbers.size(),nb_procs);
+  if (nb_renumbered == 0)
+  {
+    // Node n is the n-th node in the file
+    for (Uint g=0; g<ghost_numbers.size(); ++g)
+    {
+      if (ghost_numbers[g] > 0 && ghost_numbers[g] <= m_total_nb_nodes)
+        ghost_owners[g] = distribution.proc_of_obj(ghost_numbers[g]-1);
     }
-    else
+  }
+  else
+  {
+    // Ask a directory of node owners, distributed over the ranks by gmsh node number
+    std::vector< std::vector<Uint> > send(nb_procs), recv;
+    boost_foreach(const Uint gmsh_node_number, owned_numbers)
+      send[gmsh_node_number%nb_procs].push_back(gmsh_node_number);
+    exchange(send,recv);
+    std::map<Uint,Uint> directory;
+    for (Uint r=0; r<recv.size(); ++r)
+      boost_foreach(const Uint gmsh_node_number, recv[r])
+        directory[gmsh_node_number] = r;
+
+    send.assign(nb_procs,std::vector<Uint>());
+    boost_foreach(const Uint gmsh_node_number, ghost_numbers)
+      send[gmsh_node_number%nb_procs].push_back(gmsh_node_number);
+    exchange(send,recv);
+    for (Uint r=0; r<recv.size(); ++r)
     {
-      it = m_ghost_nodes.find(node_idx);
-      if (it != m_ghost_nodes.end())
+      boost_foreach(Uint& requested_node, recv[r])
       {
-        std::stringstream ss(line);
-        ss >> gmsh_node_number;
-        m_node_idx_gmsh_to_cf[gmsh_node_number]=coord_idx;
-
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << gmsh_node_number << " --> " << coord_idx << std::endl;
-
-        for (Uint dim=0; dim<m_mesh_dimension; ++dim)
-        ss >> nodes.coordinates()[coord_idx][dim];
-        if(m_mesh_dimension < DIM_3D) getline(ss, line);
-
-        nodes.rank()[coord_idx] = m_hash->subhash(NODES).part_of_obj(node_idx);
-        nodes.glb_idx()[coord_idx] = gmsh_node_number-1;
-
-        coord_idx++;
+        std::map<Uint,Uint>::const_iterator it = directory.find(requested_node);
+        requested_node = (it != directory.end()) ? it->second : nb_procs;
       }
     }
+    std::vector< std::vector<Uint> > owners;
+    exchange(recv,owners);
 
+    std::vector<Uint> nb_answers(nb_procs,0);
+    for (Uint g=0; g<ghost_numbers.size(); ++g)
+    {
+      const Uint dir_rank = ghost_numbers[g]%nb_procs;
+      ghost_owners[g] = owners[dir_rank][nb_answers[dir_rank]++];
+    }
+  }
 
-  } //loop over nodes
-
+  error.clear();
+  for (Uint g=0; g<ghost_numbers.size(); ++g)
+  {
+    if (ghost_owners[g] >= nb_procs || ghost_owners[g] == rank)
+      error = "Node " + to_str(ghost_numbers[g]) + " is used by an element, but is not defined in the $Nodes section";
+  }
+  check_parsing_errors(error);
+
+  // Fetch the part and coordinates of the ghost nodes from their owners
+  std::vector< std::vector<Uint> > requests(nb_procs), requested;
+  for (Uint g=0; g<ghost_numbers.size(); ++g)
+    requests[ghost_owners[g]].push_back(ghost_numbers[g]);
+  exchange(requests,requested);
+  std::vector< std::vector<Uint> > send_parts(nb_procs), recv_parts;
+  send_coordinates.assign(nb_procs,std::vector<Real>());
+  for (Uint r=0; r<requested.size(); ++r)
+  {
+    boost_foreach(const Uint gmsh_node_number, requested[r])
+    {
+      const Uint owned_idx = m_node_idx_gmsh_to_cf[gmsh_node_number];
+      send_parts[r].push_back(owned_parts[owned_idx]);
+      for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+        send_coordinates[r].push_back(owned_coordinates[m_mesh_dimension*owned_idx+dim]);
+    }
+  }
+  exchange(send_parts,recv_parts);
+  exchange(send_coordinates,recv_coordinates);
 
+  // Fill the geometry dictionary, with the owned nodes first
+  Dictionary& nodes = m_mesh->geometry_fields();
+  const Uint nb_owned = owned_numbers.size();
+  nodes.resize(nb_owned+ghost_numbers.size());
 
-  /*
-  CFinfo << "Printing all nodal coordinates:" << CFendl;
-  for(Uint i = 0; i < m_total_nb_nodes; ++i)
+  Uint part = options().value<Uint>("part");
+  for (Uint n=0; n<nb_owned; ++n)
   {
-      CFinfo << "\t";
-      for(Uint dim = 0; dim < m_mesh_dimension; ++dim)
-        {
-            CFinfo << nodes.coordinates()[i][dim] << " ";
-        }
-      CFinfo << CFendl;
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      nodes.coordinates()[n][dim] = owned_coordinates[m_mesh_dimension*n+dim];
+    nodes.rank()[n] = part;
+    nodes.glb_idx()[n] = owned_numbers[n]-1;
   }
-  */
 
-  getline(m_file,line);
+  std::vector<Uint> nb_answers(nb_procs,0);
+  for (Uint g=0; g<ghost_numbers.size(); ++g)
+  {
+    const Uint coord_idx = nb_owned+g;
+    const Uint owner = ghost_owners[g];
+    const Uint answer = nb_answers[owner]++;
+    m_node_idx_gmsh_to_cf[ghost_numbers[g]] = coord_idx;
+    for (Uint dim=0; dim<m_mesh_dimension; ++dim)
+      nodes.coordinates()[coord_idx][dim] = recv_coordinates[owner][m_mesh_dimension*answer+dim];
+    nodes.rank()[coord_idx] = recv_parts[owner][answer];
+    nodes.glb_idx()[coord_idx] = ghost_numbers[g]-1;
+  }
 }
 
 //////////////////////////////////////////////////////////////////////////////
@@ -503,42 +1124,35 @@ void Reader::read_connectivity()
 
   Dictionary& nodes = m_mesh->geometry_fields();
 
-
   Uint part = options().value<Uint>("part");
 
-  //Each entry of this vector holds a map (gmsh_type_idx, pointer to connectivity table of this gmsh type).
- //Each row corresponds to one region of the mesh
- std::vector<std::map<Uint, Entities* > > conn_table_idx;
- conn_table_idx.resize(m_nb_regions);
- for(Uint ir = 0; ir < m_nb_regions; ++ir)
- {
-    conn_table_idx[ir].clear();
- }
+  // Count the owned elements of each type in each region
+  const Uint nb_tables = m_nb_regions*Shared::nb_gmsh_types;
+  std::vector<Uint> nb_elems(nb_tables,0);
+  for (std::size_t i=0; i<m_elements.size(); i+=3+Shared::m_nodes_in_gmsh_elem[m_elements[i+1]])
+    ++nb_elems[(m_elements[i+2]-1)*Shared::nb_gmsh_types+m_elements[i+1]];
 
- std::map<Uint, Entities*>::iterator elem_table_iter;
-
-// std::vector<std::map<std::string,Handle< Elements > > > elements(m_nb_regions);
-// std::vector<std::map<std::string,Handle< Connectivity::Buffer > > > buffer(m_nb_regions);
+  // Every rank creates the element types present in a region on any rank
+  std::vector<Uint> nb_elems_on_any_rank(nb_elems);
+  if (PE::Comm::instance().size() > 1 && nb_tables)
+    PE::Comm::instance().all_reduce(PE::plus(),&nb_elems[0],nb_tables,&nb_elems_on_any_rank[0]);
 
+  std::vector< Handle<Elements> > tables(nb_tables);
 
  m_elem_idx_gmsh_to_cf.clear();
  //Loop over all regions and allocate a connectivity table of proper size for each element type that
- //is present in each region. Counting of elements was done during the first pass in the function
- //get_file_positions
+ //is present in each region.
  for(Uint ir = 0; ir < m_nb_regions; ++ir)
  {
    // create new region
    Handle< Region > region = m_region_list[ir].region;
 
-//   elements[ir] = create_cells_in_region(*region,m_mesh->geometry_fields(),m_supported_types);
-//   buffer[ir] = create_connectivity_buffermap(elements[ir]);
-
-
    // Take the gmsh element types present in this region and generate new names of elements which correspond
    // to coolfuid naming:
    for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
    {
-     if(m_region_list[ir].element_types.find(etype) !=  m_region_list[ir].element_types.end())
+     const Uint table_idx = ir*Shared::nb_gmsh_types+etype;
+     if(nb_elems_on_any_rank[table_idx])
      {
        const std::string cf_elem_name = Shared::gmsh_name_to_cf_name(m_mesh_dimension,etype);
 
@@ -553,102 +1167,37 @@ void Reader::read_connectivity()
       region->add_component(elements);
       elements->initialize(cf_elem_name,nodes);
 
-       Connectivity& elem_table = Handle<Elements>(elements)->geometry_space().connectivity();
+       tables[table_idx] = Handle<Elements>(elements);
+       Connectivity& elem_table = tables[table_idx]->geometry_space().connectivity();
        elem_table.set_row_size(Shared::m_nodes_in_gmsh_elem[etype]);
-       elem_table.resize((m_nb_gmsh_elem_in_region[ir])[etype]);
-       elements->rank().resize(m_nb_gmsh_elem_in_region[ir][etype]);
-       elements->glb_idx().resize(m_nb_gmsh_elem_in_region[ir][etype]);
-       conn_table_idx[ir].insert(std::pair<Uint,Entities*>(etype,elements.get()));
+       elem_table.resize(nb_elems[table_idx]);
+       elements->rank().resize(nb_elems[table_idx]);
+       elements->glb_idx().resize(nb_elems[table_idx]);
      }
    }
  }
 
-   std::string etype_CF;
-   std::set<Uint>::const_iterator it;
-   std::vector<Uint> cf_element;
-   Uint element_number, gmsh_element_type, nb_element_nodes;
-   Uint gmsh_node_number, nb_tags, phys_tag, other_tag;
-   Uint cf_node_number;
-   Uint cf_idx;
-
-   m_file.seekg(m_elements_position,std::ios::beg);
-   // skip next line
-   std::string line;
-   //Re-read the line that contains the keyword '$Elements':
-   getline(m_file,line);
-   //Parse the following line (containing the actual number of elements)
-   getline(m_file,line);
-
-   for(Uint ir = 0; ir < m_nb_regions; ++ir)
-     for(Uint etype = 0; etype < Shared::nb_gmsh_types; ++etype)
-      (m_nb_gmsh_elem_in_region[ir])[etype] = 0;
-
-  for (Uint i=0; i<m_total_nb_elements; ++i)
+  // Fill the tables in file order
+  std::vector<Uint> row_idx(nb_tables,0);
+  for (std::size_t i=0; i<m_elements.size(); )
   {
-//    if (m_total_nb_elements > 100000)
-//    {
-//      if(i%(m_total_nb_elements/20)==0)
-//        CFinfo << 100*i/m_total_nb_elements << "% " << CFflush;
-//      if(i==m_total_nb_elements-1)
-//        CFinfo << CFendl;
-//    }
-
-    // element description
-    m_file >> element_number >> gmsh_element_type;
-
-    nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
-
-    // get element nodes
-    if (m_hash->subhash(ELEMS).owns(i))
-    {
-      m_file >> nb_tags;
-      m_file >> phys_tag;
-      for(Uint itag = 0; itag < (nb_tags-1); ++itag)
-          m_file >> other_tag;
-
-//      CFinfo << "Reading element " << element_number << " of type " << gmsh_element_type;
-//      CFinfo << " in region " << phys_tag << " with " << nb_element_nodes << " nodes " << CFendl;
-
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << element_number << "   -->   ";
-
-      cf_element.resize(nb_element_nodes);
-      for (Uint j=0; j<nb_element_nodes; ++j)
-      {
-        cf_idx = Shared::m_nodes_gmsh_to_cf[gmsh_element_type][j];
-        m_file >> gmsh_node_number;
-        cf_node_number = m_node_idx_gmsh_to_cf[gmsh_node_number];
-        cf_element[cf_idx] = cf_node_number;
-//        if (PE::Comm::instance().rank()==IO_rank)
-//          std::cout << "  " << gmsh_node_number << "("<<m_node_idx_gmsh_to_cf[gmsh_node_number]<<")";
-      }
-//      if (PE::Comm::instance().rank()==IO_rank)
-//        std::cout << std::endl;
-
-      elem_table_iter = conn_table_idx[phys_tag-1].find(gmsh_element_type);
-      const Uint row_idx = (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type];
-
-      Handle< Elements > elements_region = Handle<Elements>(elem_table_iter->second->handle<Component>());
-      Connectivity::Row element_nodes = elements_region->geometry_space().connectivity()[row_idx];
-
-      m_elem_idx_gmsh_to_cf[element_number] = std::make_pair( elements_region , row_idx);
-
-      for(Uint node = 0; node < nb_element_nodes; ++node)
-      {
-         element_nodes[node] = cf_element[node];
-      }
-
-      elements_region->rank()[row_idx] = part;
-      elements_region->glb_idx()[row_idx] = element_number-1;
-
-      (m_nb_gmsh_elem_in_region[phys_tag-1])[gmsh_element_type]++;
-
-    }
-
-    // finish the line
-    getline(m_file,line);
+    const Uint element_number = m_elements[i];
+    const Uint gmsh_element_type = m_elements[i+1];
+    const Uint table_idx = (m_elements[i+2]-1)*Shared::nb_gmsh_types+gmsh_element_type;
+    const Uint nb_element_nodes = Shared::m_nodes_in_gmsh_elem[gmsh_element_type];
+    const Uint row = row_idx[table_idx]++;
+
+    Elements& elements_region = *tables[table_idx];
+    Connectivity::Row element_nodes = elements_region.geometry_space().connectivity()[row];
+    for (Uint j=0; j<nb_element_nodes; ++j)
+      element_nodes[Shared::m_nodes_gmsh_to_cf[gmsh_element_type][j]] = m_node_idx_gmsh_to_cf[m_elements[i+3+j]];
+
+    m_elem_idx_gmsh_to_cf[element_number] = std::make_pair( tables[table_idx] , row);
+    elements_region.rank()[row] = part;
+    elements_region.glb_idx()[row] = element_number-1;
+
+    i += 3+nb_element_nodes;
   }
-  getline(m_file,line);  // ENDOFSECTION
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -11,6 +11,7 @@
 
 #include <set>
 #include <boost/tuple/tuple.hpp>
+#include <boost/iostreams/device/mapped_file.hpp>
 
 #include "mesh/MeshReader.hpp"
 
@@ -34,6 +35,11 @@ namespace gmsh {
 //////////////////////////////////////////////////////////////////////////////
 
 /// This class defines gmsh mesh format reader
+///
+/// Both the ASCII and the binary variant of the msh 2.2 format can be read.
+/// Only "nb_io_ranks" ranks access the file: the first one scans the section layout and broadcasts it,
+/// then each I/O rank parses a byte range of the $Nodes and $Elements sections and sends every node
+/// and element to the rank owning it. Other ranks never open the file, except to read field data.
 /// @author Willem Deconinck
 /// @author Martin Vymazal
 class gmsh_API Reader : public MeshReader, public Shared
@@ -51,12 +57,56 @@ public: // functions
 
 private: // functions
 
-  void get_file_positions();
+  /// Byte range of a section parsed by one I/O rank.
+  /// In binary files a range of elements can start inside an element block, whose
+  /// element type, number of tags and number of remaining elements are then stored.
+  struct Chunk
+  {
+    std::size_t begin;
+    std::size_t end;
+    Uint elem_type;
+    Uint nb_tags;
+    Uint remaining;
+  };
+
+  /// Scan the mapped file for the sections, on the first I/O rank only
+  void scan_file_layout();
+
+  /// Send the file layout from the first I/O rank to all ranks, and create the regions
+  void broadcast_file_layout();
+
+  /// Split the node and element sections in one chunk per I/O rank.
+  /// For binary files, elem_blocks holds the element blocks, with their number of elements in "remaining"
+  void compute_chunks(const std::size_t nodes_begin, const std::size_t nodes_end,
+                      const std::size_t elems_begin, const std::size_t elems_end,
+                      const std::vector<Chunk>& elem_blocks);
+
+  /// Rank that parses the given chunk
+  Uint io_rank_of_chunk(const Uint chunk) const;
+
+  /// Throw ParsingFailed if the gmsh element type is not known
+  void check_element_type(const Uint gmsh_type) const;
+
+  /// Size in bytes of an element in a binary file
+  std::size_t binary_element_size(const Uint gmsh_type, const Uint nb_tags) const;
+
+  /// Parse the elements of a chunk, appending them to elements in the layout of m_elements
+  /// @return the number of parsed elements
+  Uint parse_elements(const Chunk& chunk, std::vector<Uint>& elements) const;
+
+  /// Parse the nodes of a chunk, appending their gmsh numbers and 3 coordinates each
+  /// @return the number of parsed nodes
+  Uint parse_nodes(const Chunk& chunk, std::vector<Uint>& numbers, std::vector<Real>& coordinates) const;
+
+  /// Index in the file of the first object parsed by this rank, checking that the ranks parsed nb_total objects together
+  Uint first_parsed_index(const Uint nb_parsed, const Uint nb_total, const std::string& entity_name) const;
 
   Handle<Region> create_region(std::string const& relative_path);
 
-  void find_used_nodes();
+  /// Parse the elements of this I/O rank and send them to the ranks owning them
+  void read_elements();
 
+  /// Parse the nodes of this I/O rank, send them to the ranks owning them and fetch the ghost nodes
   void read_coordinates();
 
   void read_connectivity();
@@ -79,6 +129,8 @@ private: // data
   std::map<Uint, Uint> m_node_idx_gmsh_to_cf;
 
   boost::filesystem::fstream m_file;
+  /// The mesh file, only mapped on the I/O ranks
+  boost::iostreams::mapped_file_source m_mapped_file;
   Handle<Mesh> m_mesh;
   Handle<Region> m_region;
 
@@ -90,7 +142,6 @@ private: // data
     Uint index;
     std::string name;
     Handle<Region> region;
-    std::set<Uint> element_types;
   };
 
   Uint m_nb_regions; // This corresponds to the number of physical groups in
@@ -100,22 +151,25 @@ private: // data
 
   std::vector<RegionData> m_region_list;
 
-  std::set<Uint> m_ghost_nodes;
-  //std::set<Uint> m_ghost_elems;
-  std::set<Uint> m_used_nodes;
-  
-  std::vector<std::set<Uint> > m_node_to_glb_elements;
+  /// True if the file is in the binary msh format
+  bool m_binary;
+  /// True if the binary data has a different endianness than this machine
+  bool m_swap_bytes;
+
+  /// Chunks of the node and element sections, one per I/O rank
+  std::vector<Chunk> m_node_chunks;
+  std::vector<Chunk> m_elem_chunks;
+
+  /// Elements owned by this rank, in file order, stored as
+  /// gmsh number, gmsh type, physical tag, gmsh node numbers
+  std::vector<Uint> m_elements;
 
   //Markers for important places in the file to be read
-  std::streampos m_region_names_position;
-  std::streampos m_coordinates_position;
-  std::streampos m_elements_position;
   std::vector<std::streampos> m_element_data_positions;
   std::vector<std::streampos> m_node_data_positions;
   std::vector<std::streampos> m_element_node_data_positions;
 
 
-  std::vector<std::vector<Uint> > m_nb_gmsh_elem_in_region;
   Uint m_total_nb_elements;
   Uint m_total_nb_nodes;
 
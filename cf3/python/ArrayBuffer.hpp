@@ -0,0 +1,138 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#ifndef CF3_Python_ArrayBuffer_hpp
+#define CF3_Python_ArrayBuffer_hpp
+
+#include "python/BoostPython.hpp"
+
+#include <boost/mpl/if.hpp>
+#include <boost/shared_ptr.hpp>
+
+#include "common/List.hpp"
+#include "common/Table.hpp"
+
+#include "python/ComponentWrapper.hpp"
+
+namespace cf3 {
+namespace python {
+
+/// Format character of the Python struct module for each value type
+template<typename ValueT> struct BufferFormat;
+template<> struct BufferFormat<Real> { static const char* format() { return "d"; } };
+template<> struct BufferFormat<Uint> { static const char* format() { return "I"; } };
+template<> struct BufferFormat<bool> { static const char* format() { return "?"; } };
+
+/// Python buffer protocol for Table and List components, so the data can be accessed without copying
+/// using numpy.asarray(table) or memoryview(table). While a buffer is exported, the component is kept alive
+/// and resizing it raises an error, so the buffer can never refer to freed memory.
+template<typename ArrayComponentT, bool ReadOnly>
+struct ArrayBuffer
+{
+  typedef typename ArrayComponentT::value_type ValueT;
+  typedef typename boost::mpl::if_c<ReadOnly, ComponentWrapperConst, ComponentWrapper>::type WrapperT;
+
+  /// Data owned by each exported buffer
+  struct ViewData
+  {
+    boost::shared_ptr<common::Component const> component;
+    Py_ssize_t shape[2];
+    Py_ssize_t strides[2];
+  };
+
+  /// Add the buffer protocol to the given python class
+  static void enable(boost::python::object& python_class)
+  {
+    static PyBufferProcs buffer_procs;
+    buffer_procs.bf_getbuffer = &ArrayBuffer::get_buffer;
+    buffer_procs.bf_releasebuffer = &ArrayBuffer::release_buffer;
+    PyTypeObject* python_type = reinterpret_cast<PyTypeObject*>(python_class.ptr());
+    python_type->tp_as_buffer = &buffer_procs;
+#if PY_MAJOR_VERSION < 3
+    python_type->tp_flags |= Py_TPFLAGS_HAVE_NEWBUFFER;
+#endif
+  }
+
+  static int get_buffer(PyObject* exporter, Py_buffer* view, int flags)
+  {
+    if(ReadOnly && (flags & PyBUF_WRITABLE) == PyBUF_WRITABLE)
+    {
+      PyErr_SetString(PyExc_BufferError, "Buffer of a const component is read-only");
+      view->obj = 0;
+      return -1;
+    }
+
+    try
+    {
+      const WrapperT& wrapped = boost::python::extract<const WrapperT&>(exporter);
+      const ArrayComponentT& array_component = static_cast<const ComponentWrapperBase&>(wrapped).component<ArrayComponentT>();
+
+      boost::shared_ptr<common::Component const> component = array_component.shared_from_this();
+      ViewData* view_data = new ViewData();
+      view_data->component = component;
+      const Uint ndim = fill_shape(array_component, view_data->shape);
+      view_data->strides[ndim-1] = sizeof(ValueT);
+      if(ndim == 2)
+        view_data->strides[0] = view_data->shape[1]*sizeof(ValueT);
+
+      static ValueT empty_data;
+      const ValueT* data = array_component.array().num_elements() == 0 ? &empty_data : array_component.array().data();
+
+      view->buf = const_cast<ValueT*>(data);
+      view->obj = exporter;
+      Py_INCREF(exporter);
+      view->len = array_component.array().num_elements() * sizeof(ValueT);
+      view->readonly = ReadOnly ? 1 : 0;
+      view->itemsize = sizeof(ValueT);
+      view->format = (flags & PyBUF_FORMAT) == PyBUF_FORMAT ? const_cast<char*>(BufferFormat<ValueT>::format()) : 0;
+      view->ndim = ndim;
+      view->shape = (flags & PyBUF_ND) == PyBUF_ND ? view_data->shape : 0;
+      view->strides = (flags & PyBUF_STRIDES) == PyBUF_STRIDES ? view_data->strides : 0;
+      view->suboffsets = 0;
+      view->internal = view_data;
+
+      array_component.add_view();
+    }
+    catch(std::exception& e)
+    {
+      PyErr_SetString(PyExc_BufferError, e.what());
+      view->obj = 0;
+      return -1;
+    }
+
+    return 0;
+  }
+
+  static void release_buffer(PyObject* exporter, Py_buffer* view)
+  {
+    ViewData* view_data = reinterpret_cast<ViewData*>(view->internal);
+    static_cast<const ArrayComponentT&>(*view_data->component).remove_view();
+    delete view_data;
+  }
+
+private:
+  template<typename T>
+  static Uint fill_shape(const common::Table<T>& table, Py_ssize_t* shape)
+  {
+    shape[0] = table.size();
+    shape[1] = table.row_size();
+    return 2;
+  }
+
+  template<typename T>
+  static Uint fill_shape(const common::List<T>& list, Py_ssize_t* shape)
+  {
+    shape[0] = list.size();
+    return 1;
+  }
+};
+
+} // python
+} // cf3
+
+////////////////////////////////////////////////////////////////////////////////
+
+#endif // CF3_Python_ArrayBuffer_hpp
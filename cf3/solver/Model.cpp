@@ -21,6 +21,7 @@
 #include "common/Group.hpp"
 #include "common/OptionList.hpp"
 #include "common/PropertyList.hpp"
+#include "common/Trace.hpp"
 
 #include "common/XML/Protocol.hpp"
 #include "common/XML/SignalOptions.hpp"
@@ -138,6 +139,7 @@ void Model::simulate()
   {
     boost_foreach(Solver& solver, find_components<Solver>(*this))
     {
+      TraceScope trace_scope(solver.name());
       solver.execute();
     }
     CFinfo << name() << ": end simulation\n" << CFendl;
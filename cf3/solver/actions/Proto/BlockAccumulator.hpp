@@ -11,6 +11,8 @@
 #include <boost/mpl/assert.hpp>
 #include <boost/proto/core.hpp>
 #include <boost/proto/traits.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
 
 
 #include "math/MatrixTypes.hpp"
@@ -54,8 +56,132 @@ namespace detail {
   {
     throw common::ShouldNotBeHere(FromHere(), "Number of element nodes was found to be zero.");
   }
+
+  /// Mutex protecting insertion into the LSS, since element loops may run in several threads
+  /// and the LSS implementations are not thread safe
+  inline boost::mutex& lss_mutex()
+  {
+    static boost::mutex mutex;
+    return mutex;
+  }
 }
 
+/// Inserts element contributions into the LSS. Between begin_batch and end_batch, the insertions are buffered
+/// and performed together at the end of the batch, so the LSS lock is taken only once per batch.
+/// The order of the insertions is preserved.
+class LSSInsertionBuffer
+{
+public:
+  LSSInsertionBuffer() : m_nb_insertions(0), m_is_buffering(false)
+  {
+  }
+
+  /// Start buffering insertions
+  void begin_batch()
+  {
+    m_is_buffering = true;
+  }
+
+  /// Insert all buffered values and stop buffering
+  void end_batch()
+  {
+    flush();
+    m_is_buffering = false;
+  }
+
+  void set_values(math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
+  {
+    insert(SET_VALUES, &lss_matrix, nullptr, block_accumulator);
+  }
+
+  void add_values(math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
+  {
+    insert(ADD_VALUES, &lss_matrix, nullptr, block_accumulator);
+  }
+
+  void set_rhs_values(math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator)
+  {
+    insert(SET_RHS_VALUES, nullptr, &lss_rhs, block_accumulator);
+  }
+
+  void add_rhs_values(math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator)
+  {
+    insert(ADD_RHS_VALUES, nullptr, &lss_rhs, block_accumulator);
+  }
+
+  /// Insert the buffered values
+  void flush()
+  {
+    if(m_nb_insertions == 0)
+      return;
+
+    boost::lock_guard<boost::mutex> lock(detail::lss_mutex());
+    for(Uint i = 0; i != m_nb_insertions; ++i)
+    {
+      const Insertion& insertion = m_insertions[i];
+      apply(insertion.operation, insertion.matrix, insertion.vector, insertion.block_accumulator);
+    }
+    m_nb_insertions = 0;
+  }
+
+private:
+  enum OperationT { SET_VALUES, ADD_VALUES, SET_RHS_VALUES, ADD_RHS_VALUES };
+
+  struct Insertion
+  {
+    OperationT operation;
+    math::LSS::Matrix* matrix;
+    math::LSS::Vector* vector;
+    math::LSS::BlockAccumulator block_accumulator;
+  };
+
+  void insert(const OperationT operation, math::LSS::Matrix* matrix, math::LSS::Vector* vector, const math::LSS::BlockAccumulator& block_accumulator)
+  {
+    if(!m_is_buffering)
+    {
+      boost::lock_guard<boost::mutex> lock(detail::lss_mutex());
+      apply(operation, matrix, vector, block_accumulator);
+      return;
+    }
+
+    // Storage is reused between batches, so copying only allocates during the first batch
+    if(m_nb_insertions == m_insertions.size())
+      m_insertions.push_back(Insertion());
+    Insertion& insertion = m_insertions[m_nb_insertions++];
+    insertion.operation = operation;
+    insertion.matrix = matrix;
+    insertion.vector = vector;
+    insertion.block_accumulator.indices = block_accumulator.indices;
+    if(is_not_null(matrix))
+      insertion.block_accumulator.mat = block_accumulator.mat;
+    else
+      insertion.block_accumulator.rhs = block_accumulator.rhs;
+  }
+
+  static void apply(const OperationT operation, math::LSS::Matrix* matrix, math::LSS::Vector* vector, const math::LSS::BlockAccumulator& block_accumulator)
+  {
+    switch(operation)
+    {
+      case SET_VALUES:
+        matrix->set_values(block_accumulator);
+        break;
+      case ADD_VALUES:
+        matrix->add_values(block_accumulator);
+        break;
+      case SET_RHS_VALUES:
+        vector->set_rhs_values(block_accumulator);
+        break;
+      case ADD_RHS_VALUES:
+        vector->add_rhs_values(block_accumulator);
+        break;
+    }
+  }
+
+  std::vector<Insertion> m_insertions;
+  Uint m_nb_insertions;
+  bool m_is_buffering;
+};
+
 
 /// Tag for system matrix
 struct SystemMatrixTag
@@ -92,38 +218,38 @@ struct MatrixAssignOpsCases
 };
 
 /// Translate tag to operator
-inline void do_assign_op_matrix(boost::proto::tag::assign, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
+inline void do_assign_op_matrix(boost::proto::tag::assign, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator, LSSInsertionBuffer& insertions)
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
-    lss_matrix.set_values(block_accumulator);
+    insertions.set_values(lss_matrix, block_accumulator);
   }
 }
 
 /// Translate tag to operator
-inline void do_assign_op_matrix(boost::proto::tag::plus_assign, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator)
+inline void do_assign_op_matrix(boost::proto::tag::plus_assign, math::LSS::Matrix& lss_matrix, const math::LSS::BlockAccumulator& block_accumulator, LSSInsertionBuffer& insertions)
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
-    lss_matrix.add_values(block_accumulator);
+    insertions.add_values(lss_matrix, block_accumulator);
   }
 }
 
 /// Translate tag to operator
-inline void do_assign_op_rhs(boost::proto::tag::assign, math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator)
+inline void do_assign_op_rhs(boost::proto::tag::assign, math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator, LSSInsertionBuffer& insertions)
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
-    lss_rhs.set_rhs_values(block_accumulator);
+    insertions.set_rhs_values(lss_rhs, block_accumulator);
   }
 }
 
 /// Translate tag to operator
-inline void do_assign_op_rhs(boost::proto::tag::plus_assign, math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator)
+inline void do_assign_op_rhs(boost::proto::tag::plus_assign, math::LSS::Vector& lss_rhs, const math::LSS::BlockAccumulator& block_accumulator, LSSInsertionBuffer& insertions)
 {
   if(std::count(block_accumulator.indices.begin(), block_accumulator.indices.end(), static_cast<Uint>(-1)) == 0)
   {
-    lss_rhs.add_rhs_values(block_accumulator);
+    insertions.add_rhs_values(lss_rhs, block_accumulator);
   }
 }
 
@@ -166,7 +292,7 @@ struct BlockAssignmentOp<SystemMatrixTag, OpTagT>
         block_accumulator.mat(block_row, block_col) = rhs(row, col);
       }
     }
-    do_assign_op_matrix(OpTagT(), lss.matrix(), block_accumulator);
+    do_assign_op_matrix(OpTagT(), lss.matrix(), block_accumulator, data.lss_insertions);
   }
 };
 
@@ -191,7 +317,7 @@ struct BlockAssignmentOp<SystemRHSTag, OpTagT>
       block_accumulator.rhs[block_idx] = rhs[i];
     }
 
-    do_assign_op_rhs(OpTagT(), lss.rhs(), block_accumulator);
+    do_assign_op_rhs(OpTagT(), lss.rhs(), block_accumulator, data.lss_insertions);
   }
 };
 
@@ -267,7 +393,7 @@ boost::proto::transform< RHSAccumulator >
         const Uint block_idx = (i % nb_nodes)*nb_dofs + i / nb_nodes;
         block_accumulator.rhs[block_idx] = 0.;
       }
-      do_assign_op_rhs(boost::proto::tag::plus_assign(), *lss.rhs(), block_accumulator);
+      do_assign_op_rhs(boost::proto::tag::plus_assign(), *lss.rhs(), block_accumulator, data.lss_insertions);
     }
 
     result_type operator ()(
@@ -43,6 +43,11 @@
 #include "FieldSync.hpp"
 #include "Terminals.hpp"
 
+// Number of elements that are gathered together in batched element loops. Defaults to the number of Reals in a SIMD register.
+#ifndef CF3_PROTO_ELEMENT_BATCH_SIZE
+  #define CF3_PROTO_ELEMENT_BATCH_SIZE Eigen::internal::packet_traits<Real>::size
+#endif
+
 namespace cf3 {
 namespace solver {
 namespace actions {
@@ -197,6 +202,41 @@ public:
     mesh::fill(m_nodes, m_coordinates, m_connectivity);
   }
 
+  /// Number of elements in a batch
+  static const Uint batch_size = CF3_PROTO_ELEMENT_BATCH_SIZE;
+
+  /// Gather the connectivity and the node coordinates for a batch of at most batch_size elements.
+  /// Coordinates are stored with the batch elements as the fastest varying index, i.e. structure-of-arrays
+  void set_batch(const Uint* elems_begin, const Uint* elems_end)
+  {
+    cf3_assert(static_cast<Uint>(elems_end - elems_begin) <= batch_size);
+    const Uint nb_batch_elems = elems_end - elems_begin;
+    for(Uint lane = 0; lane != nb_batch_elems; ++lane)
+    {
+      const mesh::Connectivity::ConstRow row = m_connectivity_array[elems_begin[lane]];
+      for(Uint node = 0; node != EtypeT::nb_nodes; ++node)
+      {
+        const Uint node_idx = row[node];
+        m_batch_connectivity[lane][node] = node_idx;
+        const common::Table<Real>::ConstRow coords = m_coordinates[node_idx];
+        for(Uint i = 0; i != EtypeT::dimension; ++i)
+          m_batch_nodes(lane, node*EtypeT::dimension + i) = coords[i];
+      }
+    }
+  }
+
+  /// Make the element at position lane in the current batch the current element
+  void set_batch_element(const Uint lane, const Uint element_idx)
+  {
+    m_element_idx = element_idx;
+    m_connectivity = m_batch_connectivity[lane];
+    for(Uint node = 0; node != EtypeT::nb_nodes; ++node)
+    {
+      for(Uint i = 0; i != EtypeT::dimension; ++i)
+        m_nodes(node, i) = m_batch_nodes(lane, node*EtypeT::dimension + i);
+    }
+  }
+
   /// Reference to the current nodes
   ValueResultT nodes() const
   {
@@ -354,6 +394,12 @@ private:
   /// Connectivity table for the current element
   boost::array<Uint, EtypeT::nb_nodes> m_connectivity;
 
+  /// Node coordinates for the current batch, one row per element
+  Eigen::Matrix<Real, batch_size, EtypeT::nb_nodes*EtypeT::dimension> m_batch_nodes;
+
+  /// Connectivity for the current batch
+  boost::array<boost::array<Uint, EtypeT::nb_nodes>, batch_size> m_batch_connectivity;
+
   /// Index for the current element
   Uint m_element_idx;
 
@@ -737,7 +783,7 @@ private:
   const SupportT& m_support;
   const Uint m_elements_begin;
   Uint m_field_idx;
-  RealMatrix m_dummy_result; // only there for compilation purposes during the checking of the variable types. Never really used.
+  mutable RealMatrix m_dummy_result; // only there for compilation purposes during the checking of the variable types. Never really used.
 
 public:
   /// Index in the field array for this variable
@@ -814,7 +860,7 @@ private:
   const SupportT& m_support;
   const Uint m_elements_begin;
   Uint m_field_idx;
-  RealMatrix m_dummy_result; // only there for compilation purposes during the checking of the variable types. Never really used.
+  mutable RealMatrix m_dummy_result; // only there for compilation purposes during the checking of the variable types. Never really used.
 
 public:
   /// Index in the field array for this variable
@@ -1016,9 +1062,32 @@ public:
   {
     m_element_idx = element_idx;
     m_support.set_element(element_idx);
-    boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(SetElement(m_variables_data, element_idx));
-    boost::fusion::for_each(m_equation_data, FillRhs(m_element_rhs));
-    update_blocks(typename boost::fusion::result_of::empty<EquationDataT>::type());
+    set_variables_element(element_idx);
+  }
+
+  /// Number of elements in a batch
+  static const Uint batch_size = GeometricSupport<SupportEtypeT>::batch_size;
+
+  /// Start a batch of at most batch_size elements: the geometric data for all elements is gathered up front and LSS insertions
+  /// are buffered until end_batch. The elements are then visited using set_batch_element.
+  void set_batch(const Uint* elems_begin, const Uint* elems_end)
+  {
+    m_support.set_batch(elems_begin, elems_end);
+    lss_insertions.begin_batch();
+  }
+
+  /// Update element index to the element at position lane in the current batch
+  void set_batch_element(const Uint lane, const Uint element_idx)
+  {
+    m_element_idx = element_idx;
+    m_support.set_batch_element(lane, element_idx);
+    set_variables_element(element_idx);
+  }
+
+  /// Insert the LSS values buffered during the current batch
+  void end_batch()
+  {
+    lss_insertions.end_batch();
   }
 
   /// Update block accumulator only if a system of equations is accessed in the expressions
@@ -1125,7 +1194,18 @@ public:
   mutable math::LSS::BlockAccumulator block_accumulator;
   mutable bool indices_converted; // Indicate if the indices in the block accumulator have been converted to LSS indices
 
+  /// Performs the insertion of the block accumulator values into the LSS
+  mutable LSSInsertionBuffer lss_insertions;
+
 private:
+  /// Update the data for each variable
+  void set_variables_element(const Uint element_idx)
+  {
+    boost::mpl::for_each< boost::mpl::range_c<int, 0, NbVarsT::value> >(SetElement(m_variables_data, element_idx));
+    boost::fusion::for_each(m_equation_data, FillRhs(m_element_rhs));
+    update_blocks(typename boost::fusion::result_of::empty<EquationDataT>::type());
+  }
+
   /// Variables used in the expression
   VariablesT& m_variables;
 
@@ -7,6 +7,8 @@
 #ifndef cf3_solver_actions_Proto_ElementLooper_hpp
 #define cf3_solver_actions_Proto_ElementLooper_hpp
 
+#include <exception>
+
 #include <boost/fusion/algorithm/iteration/for_each.hpp>
 #include <boost/fusion/adapted/mpl.hpp>
 #include <boost/fusion/mpl.hpp>
@@ -16,10 +18,14 @@
 #include <boost/mpl/for_each.hpp>
 #include <boost/mpl/filter_view.hpp>
 
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "ElementData.hpp"
 #include "ElementExpressionWrapper.hpp"
 #include "ElementGrammar.hpp"
 
+#include "mesh/ElementColoring.hpp"
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
 #include "mesh/Space.hpp"
@@ -61,7 +67,7 @@ struct CheckSameEtype
 template<typename ElementTypesT, typename ExprT, typename SupportETYPE, typename VariablesT, typename VariablesEtypesT, typename NbVarsT, typename VarIdxT>
 struct ExpressionRunner
 {
-  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems) : variables(vars), expression(expr), elements(elems), m_nb_tests(0), m_found(false) {}
+  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems, const Uint nb_threads, const bool batched) : variables(vars), expression(expr), elements(elems), m_nb_threads(nb_threads), m_batched(batched), m_nb_tests(0), m_found(false) {}
 
   typedef typename boost::remove_reference<typename boost::fusion::result_of::at<VariablesT, VarIdxT>::type>::type VarT;
 
@@ -90,7 +96,7 @@ struct ExpressionRunner
       NewVariablesEtypesT,
       NbVarsT,
       NextIdxT
-    >(variables, expression, elements).run();
+    >(variables, expression, elements, m_nb_threads, m_batched).run();
   }
 
   // Chosen otherwise
@@ -142,12 +148,14 @@ struct ExpressionRunner
       NewVariablesEtypesT,
       NbVarsT,
       NextIdxT
-    >(variables, expression, elements).run();
+    >(variables, expression, elements, m_nb_threads, m_batched).run();
   }
 
   VariablesT& variables;
   const ExprT& expression;
   mesh::Elements& elements;
+  const Uint m_nb_threads;
+  const bool m_batched;
   // Number of times we tried a shape function
   mutable Uint m_nb_tests;
   mutable bool m_found;
@@ -156,9 +164,14 @@ struct ExpressionRunner
 
 
 /// Helper struct to launch execution once all shape functions have been determined
+/// If batched is true, elements are processed in batches of DataT::batch_size, see ElementData::set_batch
 template<typename DataT>
 struct ElementLooperImpl
 {
+  ElementLooperImpl(const bool batched) : m_batched(batched)
+  {
+  }
+
   template<typename ExprT>
   void operator()(const ExprT& expr, DataT& data, const Uint nb_elems) const
   {
@@ -166,10 +179,31 @@ struct ElementLooperImpl
     run(WrapExpression()(expr, mapped_coords, data), data, nb_elems);
   }
 
+  /// Run only for the element indices in the range [elems_begin, elems_end)
+  template<typename ExprT>
+  void operator()(const ExprT& expr, DataT& data, const Uint* elems_begin, const Uint* elems_end) const
+  {
+    const typename DataT::SupportShapeFunction::MappedCoordsT mapped_coords; // needed to deduce proper return type when wrapping
+    run(WrapExpression()(expr, mapped_coords, data), data, elems_begin, elems_end);
+  }
+
 private:
   template<typename FilteredExprT>
   void run(const FilteredExprT& expr, DataT& data, const Uint nb_elems) const
   {
+    if(m_batched)
+    {
+      Uint batch_elems[DataT::batch_size];
+      for(Uint batch_begin = 0; batch_begin < nb_elems; batch_begin += DataT::batch_size)
+      {
+        const Uint nb_batch_elems = std::min(nb_elems - batch_begin, static_cast<Uint>(DataT::batch_size));
+        for(Uint lane = 0; lane != nb_batch_elems; ++lane)
+          batch_elems[lane] = batch_begin + lane;
+        run_batch(expr, data, batch_elems, batch_elems + nb_batch_elems);
+      }
+      return;
+    }
+
     ElementGrammar grammar;
     for(Uint elem = 0; elem != nb_elems; ++elem)
     {
@@ -179,13 +213,140 @@ private:
       grammar(expr, elem, data);
     }
   }
+
+  template<typename FilteredExprT>
+  void run(const FilteredExprT& expr, DataT& data, const Uint* elems_begin, const Uint* elems_end) const
+  {
+    if(m_batched)
+    {
+      for(const Uint* batch_begin = elems_begin; batch_begin < elems_end; batch_begin += DataT::batch_size)
+      {
+        const Uint* batch_end = batch_begin + std::min(static_cast<Uint>(elems_end - batch_begin), static_cast<Uint>(DataT::batch_size));
+        run_batch(expr, data, batch_begin, batch_end);
+      }
+      return;
+    }
+
+    ElementGrammar grammar;
+    for(const Uint* elem_it = elems_begin; elem_it != elems_end; ++elem_it)
+    {
+      const Uint elem = *elem_it;
+      data.set_element(elem);
+      grammar(expr, elem, data);
+    }
+  }
+
+  /// Gather the data for a batch of elements, evaluate the expression for each and then scatter the LSS values for the whole batch
+  template<typename FilteredExprT>
+  void run_batch(const FilteredExprT& expr, DataT& data, const Uint* batch_begin, const Uint* batch_end) const
+  {
+    ElementGrammar grammar;
+    data.set_batch(batch_begin, batch_end);
+    const Uint nb_batch_elems = batch_end - batch_begin;
+    for(Uint lane = 0; lane != nb_batch_elems; ++lane)
+    {
+      const Uint elem = batch_begin[lane];
+      data.set_batch_element(lane, elem);
+      grammar(expr, elem, data);
+    }
+    data.end_batch();
+  }
+
+  const bool m_batched;
+};
+
+/// Runs the expression for a range of elements in a separate thread, storing any exception so it can be rethrown in the caller
+template<typename DataT, typename ExprT>
+struct ElementLooperThread
+{
+  ElementLooperThread(const ExprT& expr, DataT& data, const Uint* elems_begin, const Uint* elems_end, const bool batched, std::exception_ptr& error) :
+    m_expr(expr),
+    m_data(data),
+    m_elems_begin(elems_begin),
+    m_elems_end(elems_end),
+    m_batched(batched),
+    m_error(error)
+  {
+  }
+
+  void operator()() const
+  {
+    try
+    {
+      const ElementLooperImpl<DataT> looper(m_batched);
+      looper(m_expr, m_data, m_elems_begin, m_elems_end);
+    }
+    catch(...)
+    {
+      m_error = std::current_exception();
+    }
+  }
+
+  const ExprT& m_expr;
+  DataT& m_data;
+  const Uint* m_elems_begin;
+  const Uint* m_elems_end;
+  const bool m_batched;
+  std::exception_ptr& m_error;
 };
 
+/// Loop over all elements, using nb_threads threads. Each thread has its own copy of the element data, and elements are processed
+/// one color at a time (see mesh::ElementColoring), so no two threads write to the same node at the same time.
+/// Expressions that modify shared state other than fields and linear systems (i.e. through user-defined functors) are not thread safe.
+/// nb_threads must be the same on all ranks, since the data destructor may communicate.
+/// If batched is true, each thread processes its elements in batches, see ElementLooperImpl
+template<typename DataT, typename ExprT, typename VariablesT>
+void run_element_loop(const ExprT& expr, VariablesT& variables, mesh::Elements& elements, const Uint nb_threads, const bool batched)
+{
+  if(nb_threads < 2)
+  {
+    DataT data(variables, elements);
+    const ElementLooperImpl<DataT> looper(batched);
+    looper(expr, data, elements.size());
+    return;
+  }
+
+  const mesh::ElementColoring& coloring = mesh::element_coloring(elements);
+
+  boost::ptr_vector<DataT> thread_data;
+  for(Uint i = 0; i != nb_threads; ++i)
+    thread_data.push_back(new DataT(variables, elements));
+
+  std::vector<std::exception_ptr> errors(nb_threads);
+  const Uint nb_colors = coloring.nb_colors();
+  for(Uint color = 0; color != nb_colors; ++color)
+  {
+    const Uint* color_begin = coloring.elements_begin(color);
+    const Uint nb_color_elems = coloring.nb_elements(color);
+    const Uint chunk_size = nb_color_elems / nb_threads;
+    const Uint remainder = nb_color_elems % nb_threads;
+
+    // Thread 0 is the calling thread, the other chunks get a new thread
+    boost::thread_group threads;
+    const Uint* chunk_begin = color_begin + chunk_size + (remainder > 0 ? 1 : 0);
+    for(Uint i = 1; i != nb_threads; ++i)
+    {
+      const Uint* chunk_end = chunk_begin + chunk_size + (i < remainder ? 1 : 0);
+      if(chunk_end != chunk_begin)
+        threads.create_thread(ElementLooperThread<DataT, ExprT>(expr, thread_data[i], chunk_begin, chunk_end, batched, errors[i]));
+      chunk_begin = chunk_end;
+    }
+    ElementLooperThread<DataT, ExprT>(expr, thread_data[0], color_begin, color_begin + chunk_size + (remainder > 0 ? 1 : 0), batched, errors[0])();
+    threads.join_all();
+
+    for(Uint i = 0; i != nb_threads; ++i)
+    {
+      if(errors[i])
+        std::rethrow_exception(errors[i]);
+    }
+  }
+}
+
 /// When we recursed to the last variable, actually run the expression
 template<typename ElementTypesT, typename ExprT, typename SupportETYPE, typename VariablesT, typename VariablesEtypesT, typename NbVarsT>
 struct ExpressionRunner<ElementTypesT, ExprT, SupportETYPE, VariablesT, VariablesEtypesT, NbVarsT, NbVarsT>
 {
-  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems) : variables(vars), expression(expr), elements(elems) {}
+  ExpressionRunner(VariablesT& vars, const ExprT& expr, mesh::Elements& elems, const Uint nb_threads, const bool batched) : variables(vars), expression(expr), elements(elems), m_nb_threads(nb_threads), m_batched(batched) {}
 
   typedef ElementData<VariablesT, VariablesEtypesT, SupportETYPE, typename EquationVariables<ExprT, NbVarsT>::type> DataT;
 
@@ -197,15 +358,15 @@ struct ExpressionRunner<ElementTypesT, ExprT, SupportETYPE, VariablesT, Variable
       INVALID_ELEMENT_EXPRESSION,
       (ElementGrammar));
 
-    DataT data(variables, elements);
-
-    ElementLooperImpl<DataT>()(expression, data, elements.size());
+    run_element_loop<DataT>(expression, variables, elements, m_nb_threads, m_batched);
   }
 
 private:
   VariablesT& variables;
   const ExprT& expression;
   mesh::Elements& elements;
+  const Uint m_nb_threads;
+  const bool m_batched;
 };
 
 /// mpl::for_each compatible functor to loop over elements, using the correct shape function for the geometry
@@ -216,10 +377,14 @@ struct ElementLooper
   // Type of a fusion vector that can contain a copy of each variable that is used in the expression
   typedef typename ExpressionProperties<ExprT>::VariablesT VariablesT;
 
-  ElementLooper(mesh::Elements& elements, const ExprT& expr, VariablesT& variables) :
+  /// @param nb_threads Number of threads to use for each Elements block, see run_element_loop
+  /// @param batched Process the elements in batches, see ElementLooperImpl
+  ElementLooper(mesh::Elements& elements, const ExprT& expr, VariablesT& variables, const Uint nb_threads = 1, const bool batched = true) :
     m_elements(elements),
     m_expr(expr),
-    m_variables(variables)
+    m_variables(variables),
+    m_nb_threads(nb_threads),
+    m_batched(batched)
   {
   }
 
@@ -253,9 +418,7 @@ struct ElementLooper
     // Verify the types match, and throw an error if non-matching fields are found
     boost::fusion::for_each(m_variables, CheckSameEtype<ETYPE>(m_elements));
 
-    DataT data(m_variables, m_elements);
-
-    ElementLooperImpl<DataT>()(m_expr, data, m_elements.size());
+    run_element_loop<DataT>(m_expr, m_variables, m_elements, m_nb_threads, m_batched);
   }
 
   /// Static dispatch in case different ETYPE are possible
@@ -276,13 +439,15 @@ struct ElementLooper
       boost::mpl::vector0<>, // Start with an empty vector for the per-variable element types
       NbVarsT, // number of variables
       boost::mpl::int_<0> // Start index, as MPL integral constant
-    >(m_variables, m_expr, m_elements).run();
+    >(m_variables, m_expr, m_elements, m_nb_threads, m_batched).run();
   }
 
 private:
   mesh::Elements& m_elements;
   const ExprT& m_expr;
   VariablesT& m_variables;
+  const Uint m_nb_threads;
+  const bool m_batched;
 };
 
 template<typename ElementTypesT, typename ExprT>
@@ -20,12 +20,14 @@
 #include "common/OptionT.hpp"
 #include "common/OptionArray.hpp"
 #include "common/OptionList.hpp"
+#include "common/Timer.hpp"
 
 #include "math/VariableManager.hpp"
 #include "math/VariablesDescriptor.hpp"
 
 #include "mesh/Region.hpp"
 #include "mesh/Elements.hpp"
+#include "mesh/Functions.hpp"
 #include "mesh/LagrangeP1/ElementTypes.hpp"
 #include "physics/PhysModel.hpp"
 
@@ -65,6 +67,15 @@ public:
   /// value: space library name, to indicate what kind of field is expected
   virtual void insert_field_info(std::map<std::string, std::string>& tags) const = 0;
 
+  /// Set the number of threads to use in loop. Ignored by expressions that don't support threading.
+  virtual void set_nb_threads(const Uint nb_threads) {}
+
+  /// Enable or disable processing the elements in batches. Ignored by expressions that don't loop over elements.
+  virtual void set_element_batching(const bool batched) {}
+
+  /// Enable or disable recording the time spent on each Elements block, see mesh::add_element_cost. Ignored by expressions that don't loop over elements.
+  virtual void set_cost_recording(const bool record) {}
+
   virtual ~Expression() {}
 };
 
@@ -246,7 +257,7 @@ class ElementsExpression : public ExpressionBase<ExprT>
   typedef ExpressionBase<ExprT> BaseT;
 public:
 
-  ElementsExpression(const ExprT& expr) : BaseT(expr)
+  ElementsExpression(const ExprT& expr) : BaseT(expr), m_nb_threads(1), m_batched(true), m_record_cost(false)
   {
   }
 
@@ -255,9 +266,32 @@ public:
     // Traverse all Elements under the region and evaluate the expression
     BOOST_FOREACH(mesh::Elements& elements, common::find_components_recursively<mesh::Elements>(region) )
     {
-      boost::mpl::for_each<boost::mpl::filter_view< ElementTypes, mesh::IsMinimalOrder<1> > >( ElementLooper<ElementTypes, typename BaseT::CopiedExprT>(elements, BaseT::m_expr, BaseT::m_variables) );
+      common::Timer timer;
+      boost::mpl::for_each<boost::mpl::filter_view< ElementTypes, mesh::IsMinimalOrder<1> > >( ElementLooper<ElementTypes, typename BaseT::CopiedExprT>(elements, BaseT::m_expr, BaseT::m_variables, m_nb_threads, m_batched) );
+      if(m_record_cost)
+        mesh::add_element_cost(elements, timer.elapsed());
     }
   }
+
+  void set_nb_threads(const Uint nb_threads)
+  {
+    m_nb_threads = nb_threads;
+  }
+
+  void set_element_batching(const bool batched)
+  {
+    m_batched = batched;
+  }
+
+  void set_cost_recording(const bool record)
+  {
+    m_record_cost = record;
+  }
+
+private:
+  Uint m_nb_threads;
+  bool m_batched;
+  bool m_record_cost;
 };
 
 /// Expression for looping over nodes
@@ -5,6 +5,7 @@
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
 #include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
 #include "common/List.hpp"
 
 #include "FieldSync.hpp"
@@ -86,9 +87,27 @@ void FieldSynchronizer::synchronize()
   
   if(common::PE::Comm::instance().is_active())
   {
+    // Group the fields per communication pattern, so each pattern sends a single message per neighbour. Patterns are
+    // keyed on their URI to start them in the same order on each cpu.
+    typedef std::map< std::string, std::pair< Handle<common::PE::CommPattern>, std::vector<std::string> > > PatternsT;
+    PatternsT patterns;
     for(FieldsT::iterator field_it = m_fields.begin(); field_it != m_fields.end(); ++field_it)
     {
-      field_it->second.first->synchronize();
+      mesh::Field& field = *field_it->second.first;
+      common::PE::CommPattern& pattern = field.comm_pattern();
+      std::pair< Handle<common::PE::CommPattern>, std::vector<std::string> >& entry = patterns[pattern.uri().path()];
+      entry.first = pattern.handle<common::PE::CommPattern>();
+      entry.second.push_back(field.name());
+    }
+
+    // Start all exchanges before waiting on any of them
+    for(PatternsT::iterator pattern_it = patterns.begin(); pattern_it != patterns.end(); ++pattern_it)
+    {
+      pattern_it->second.first->begin_synchronize(pattern_it->second.second);
+    }
+    for(PatternsT::iterator pattern_it = patterns.begin(); pattern_it != patterns.end(); ++pattern_it)
+    {
+      pattern_it->second.first->end_synchronize();
     }
   }
 
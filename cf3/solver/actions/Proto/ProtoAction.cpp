@@ -11,6 +11,7 @@
 #include "common/Builder.hpp"
 #include "common/Log.hpp"
 #include "common/OptionComponent.hpp"
+#include "common/Trace.hpp"
 #include "common/URI.hpp"
 
 #include "mesh/Region.hpp"
@@ -107,6 +108,17 @@ ProtoAction::ProtoAction(const std::string& name) :
   Action(name),
   m_implementation(new Implementation(*this, m_physical_model))
 {
+  options().add("nb_threads", 1u)
+    .pretty_name("Number of Threads")
+    .description("Number of threads used to loop over the elements of each region. Must be the same on all processes.");
+
+  options().add("element_batching", true)
+    .pretty_name("Element Batching")
+    .description("Gather the element data in batches the size of the SIMD width, and insert the LSS contributions per batch");
+
+  options().add("record_cost", false)
+    .pretty_name("Record Cost")
+    .description("Add the time spent on each Elements block to the measured cost of its elements, for use by cf3.mesh.actions.MeasuredCostBalance");
 }
 
 ProtoAction::~ProtoAction()
@@ -122,7 +134,11 @@ void ProtoAction::execute()
   {
     if(is_null(m_implementation->m_expression))
       throw SetupError(FromHere(), "Expression for ProtoAction " + uri().path() + " is not set.");
+    m_implementation->m_expression->set_nb_threads(options().value<Uint>("nb_threads"));
+    m_implementation->m_expression->set_element_batching(options().value<bool>("element_batching"));
+    m_implementation->m_expression->set_cost_recording(options().value<bool>("record_cost"));
     CFdebug << "  Action " << name() << ": running over region " << region->uri().path() << CFendl;
+    TraceScope trace_scope(region->name());
     m_implementation->m_expression->loop(*region);
   }
 }
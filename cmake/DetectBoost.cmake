@@ -56,6 +56,29 @@ foreach( blib IN LISTS CF3_Boost_CORE_COMPONENTS )
   string(TOUPPER ${blib} blib_upper)
   list( APPEND CF3_BOOST_LIBRARIES ${Boost_${blib_upper}_LIBRARY} )
 endforeach()
+#######################################################################################
+# zstd compression is only available if boost iostreams was built with it
+
+coolfluid_log_file( "+++++  Checking for boost iostreams zstd support" )
+set( CMAKE_REQUIRED_INCLUDES ${Boost_INCLUDE_DIR} )
+set( CMAKE_REQUIRED_LIBRARIES ${Boost_IOSTREAMS_LIBRARY} )
+check_cxx_source_compiles (
+"#include <vector>
+#include <boost/iostreams/filtering_stream.hpp>
+#include <boost/iostreams/filter/zstd.hpp>
+#include <boost/iostreams/device/back_inserter.hpp>
+int main(int argc, char* argv[])
+{
+  std::vector<char> out;
+  boost::iostreams::filtering_ostream stream;
+  stream.push(boost::iostreams::zstd_compressor());
+  stream.push(boost::iostreams::back_inserter(out));
+  stream.write(\"a\", 1);
+}"
+CF3_HAVE_BOOST_ZSTD )
+unset( CMAKE_REQUIRED_INCLUDES )
+unset( CMAKE_REQUIRED_LIBRARIES )
+
 #######################################################################################
 # assume boost minimum version has it
 #  coolfluid_log( "+++++  Checking for boost erfc function" )
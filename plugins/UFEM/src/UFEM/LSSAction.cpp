@@ -113,6 +113,10 @@ LSSAction::LSSAction(const std::string& name) :
     .description("Builder to use when creating the initial LSS solution strategy")
     .attach_trigger(boost::bind(&LSSAction::create_lss, this))
     .mark_basic();
+
+  options().add("sparsity_threads", 1u)
+    .pretty_name("Sparsity Threads")
+    .description("Number of threads to use when building the sparsity structure of the LSS");
 }
 
 LSSAction::~LSSAction()
@@ -221,7 +225,7 @@ void LSSAction::on_regions_set()
     Handle< List<int> > used_node_map = m_implementation->m_lss->create_component< List<int> >("used_node_map");
 
     std::vector<Uint> node_connectivity, starting_indices;
-    boost::shared_ptr< List<Uint> > used_nodes = build_sparsity(m_loop_regions, *m_dictionary, node_connectivity, starting_indices, *gids, *ranks, *used_node_map);
+    boost::shared_ptr< List<Uint> > used_nodes = build_sparsity(m_loop_regions, *m_dictionary, node_connectivity, starting_indices, *gids, *ranks, *used_node_map, options().value<Uint>("sparsity_threads"));
     if(is_not_null(get_child(used_nodes->name())))
       remove_component(used_nodes->name());
     add_component(used_nodes);
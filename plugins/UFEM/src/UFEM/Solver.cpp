@@ -380,7 +380,8 @@ void Solver::create_fields()
     action.insert_field_info(tags);
   }
 
-  // Create fields as needed
+  // Create fields as needed, notifying the creation of the dictionaries, fields and comm patterns once
+  TreeUpdateBatch tree_update_batch(mesh());
   for(std::map<std::string, std::string>::const_iterator it = tags.begin(); it != tags.end(); ++it)
   {
     const std::string& tag = it->first;
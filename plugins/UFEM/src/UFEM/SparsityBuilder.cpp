@@ -4,10 +4,17 @@
 // GNU Lesser General Public License version 3 (LGPLv3).
 // See doc/lgpl.txt and doc/gpl.txt for the license text.
 
-#include <set>
+#include <algorithm>
 
+#include <boost/function.hpp>
+#include <boost/ptr_container/ptr_vector.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "common/BasicExceptions.hpp"
 #include "common/FindComponents.hpp"
 #include "common/List.hpp"
+#include "common/Log.hpp"
+#include "common/StringConversion.hpp"
 #include "common/PE/Comm.hpp"
 
 #include "mesh/Region.hpp"
@@ -28,7 +35,105 @@ using namespace mesh;
 
 ////////////////////////////////////////////////////////////////////////////////
 
-boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region> >& regions, const Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, List<Uint>& gids, List<Uint>& ranks, List<int>& used_node_map)
+namespace detail
+{
+
+/// Builds the rows of the sparsity structure for a range of used nodes. Each row is the sorted list of nodes
+/// that share an element with the row node, obtained by sorting the nodes of all elements around it.
+class SparsityRowBuilder
+{
+public:
+  SparsityRowBuilder(const std::vector<const Connectivity*>& connectivities,
+                     const std::vector<Uint>& elements_offsets,
+                     const std::vector<Uint>& node_elements_start,
+                     const std::vector<Uint>& node_elements,
+                     const List<int>& used_node_map,
+                     const Uint rows_begin,
+                     const Uint rows_end) :
+    m_connectivities(connectivities),
+    m_elements_offsets(elements_offsets),
+    m_node_elements_start(node_elements_start),
+    m_node_elements(node_elements),
+    m_used_node_map(used_node_map),
+    m_rows_begin(rows_begin),
+    m_rows_end(rows_end)
+  {
+  }
+
+  /// First pass: store the number of connected nodes for each row
+  void count(std::vector<Uint>& row_sizes)
+  {
+    for(Uint row = m_rows_begin; row != m_rows_end; ++row)
+    {
+      build_row(row);
+      row_sizes[row] = m_row.size();
+    }
+  }
+
+  /// Second pass: copy each row to its final location, given by start_indices
+  void fill(const std::vector<Uint>& start_indices, std::vector<Uint>& node_connectivity)
+  {
+    for(Uint row = m_rows_begin; row != m_rows_end; ++row)
+    {
+      build_row(row);
+      cf3_assert(m_row.size() == start_indices[row+1] - start_indices[row]);
+      std::copy(m_row.begin(), m_row.end(), node_connectivity.begin() + start_indices[row]);
+    }
+  }
+
+  /// Size of the row buffer
+  Uint capacity() const
+  {
+    return m_row.capacity();
+  }
+
+private:
+  void build_row(const Uint row)
+  {
+    m_row.clear();
+    const Uint elements_end = m_node_elements_start[row+1];
+    for(Uint i = m_node_elements_start[row]; i != elements_end; ++i)
+    {
+      const Uint element = m_node_elements[i];
+      const Uint entities_idx = std::upper_bound(m_elements_offsets.begin(), m_elements_offsets.end(), element) - m_elements_offsets.begin() - 1;
+      BOOST_FOREACH(const Uint node, (*m_connectivities[entities_idx])[element - m_elements_offsets[entities_idx]])
+      {
+        m_row.push_back(m_used_node_map[node]);
+      }
+    }
+    std::sort(m_row.begin(), m_row.end());
+    m_row.erase(std::unique(m_row.begin(), m_row.end()), m_row.end());
+  }
+
+  const std::vector<const Connectivity*>& m_connectivities;
+  const std::vector<Uint>& m_elements_offsets;
+  const std::vector<Uint>& m_node_elements_start;
+  const std::vector<Uint>& m_node_elements;
+  const List<int>& m_used_node_map;
+  const Uint m_rows_begin;
+  const Uint m_rows_end;
+  // Work buffer for the current row, reused between rows
+  std::vector<Uint> m_row;
+};
+
+/// Apply op to each row builder, running the first one in the calling thread and the others in a thread of their own
+void run_row_builders(boost::ptr_vector<SparsityRowBuilder>& row_builders, const boost::function<void(SparsityRowBuilder&)>& op)
+{
+  boost::thread_group threads;
+  const Uint nb_builders = row_builders.size();
+  for(Uint i = 1; i < nb_builders; ++i)
+  {
+    threads.create_thread(boost::bind(op, boost::ref(row_builders[i])));
+  }
+  op(row_builders[0]);
+  threads.join_all();
+}
+
+} // detail
+
+////////////////////////////////////////////////////////////////////////////////
+
+boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region> >& regions, const Dictionary& dictionary, std::vector<Uint>& node_connectivity, std::vector<Uint>& start_indices, List<Uint>& gids, List<Uint>& ranks, List<int>& used_node_map, const Uint nb_threads)
 {
   // Get some data from the dictionary
   const Uint nb_global_nodes = dictionary.size();
@@ -129,9 +234,14 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
     std::vector<int> recv_map; recv_map.reserve(recv_size);
     std::vector<int> send_map; send_map.reserve(send_size);
     
-    std::map<Uint, Uint> gids_reverse_map;
+    // Sorted (GID, local index) pairs for the GID to local index lookup. Only nodes owned by this rank are requested by the other ranks
+    std::vector< std::pair<Uint, Uint> > gids_reverse_map; gids_reverse_map.reserve(nb_global_nodes);
     for(Uint i = 0; i != nb_global_nodes; ++i)
-      gids_reverse_map[dict_gid[i]] = i;
+    {
+      if(dict_rank[i] == my_rank)
+        gids_reverse_map.push_back(std::make_pair(dict_gid[i], i));
+    }
+    std::sort(gids_reverse_map.begin(), gids_reverse_map.end());
 
     for(Uint i = 0; i != nb_procs; ++i)
     {
@@ -139,7 +249,12 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
       const std::vector<Uint> send_gids_i = gids_to_send[i];
       const Uint len_send_gids_i = send_gids_i.size();
       for(Uint j = 0; j != len_send_gids_i; ++j)
-        send_map.push_back(gids_reverse_map[send_gids_i[j]]);
+      {
+        const std::vector< std::pair<Uint, Uint> >::const_iterator found = std::lower_bound(gids_reverse_map.begin(), gids_reverse_map.end(), std::make_pair(send_gids_i[j], Uint(0)));
+        if(found == gids_reverse_map.end() || found->first != send_gids_i[j])
+          throw ValueNotFound(FromHere(), "GID " + to_str(send_gids_i[j]) + " requested by rank " + to_str(i) + " is not owned by rank " + to_str(my_rank));
+        send_map.push_back(found->second);
+      }
     }
     
     // Update the GIDs for the ghosts
@@ -154,39 +269,77 @@ boost::shared_ptr< List<Uint> > build_sparsity(const std::vector< Handle<Region>
     }
   }
 
-  std::vector< std::set<Uint> > connectivity_sets(nb_used_nodes);
-  start_indices.assign(nb_used_nodes+1, 0);
+  // Node to element connectivity in compressed row format, in terms of the used node indices.
+  // Elements are numbered consecutively over all used entities, starting at elements_offsets[i] for used_entities[i]
+  const Uint nb_used_entities = used_entities.size();
+  std::vector<const Connectivity*> connectivities(nb_used_entities);
+  std::vector<Uint> elements_offsets(nb_used_entities+1, 0);
+  for(Uint i = 0; i != nb_used_entities; ++i)
+  {
+    connectivities[i] = &used_entities[i]->space(dictionary).connectivity();
+    elements_offsets[i+1] = elements_offsets[i] + connectivities[i]->size();
+  }
 
-  // Determine the number of connected nodes for each element
-  BOOST_FOREACH(const Handle<Entities const>& elements, used_entities)
+  std::vector<Uint> node_elements_start(nb_used_nodes+1, 0);
+  BOOST_FOREACH(const Connectivity* connectivity, connectivities)
   {
-    const Connectivity& connectivity = elements->space(dictionary).connectivity();
-    const Uint nb_elems = connectivity.size();
-    const Uint nb_elem_nodes = connectivity.row_size();
+    const Uint nb_elems = connectivity->size();
     for(Uint elem = 0; elem != nb_elems; ++elem)
     {
-      BOOST_FOREACH(const Uint node_a, connectivity[elem])
+      BOOST_FOREACH(const Uint node, (*connectivity)[elem])
+      {
+        ++node_elements_start[used_node_map[node]+1];
+      }
+    }
+  }
+  for(Uint i = 0; i != nb_used_nodes; ++i)
+    node_elements_start[i+1] += node_elements_start[i];
+
+  std::vector<Uint> node_elements(node_elements_start.back());
+  {
+    std::vector<Uint> fill_pos(node_elements_start.begin(), node_elements_start.end()-1);
+    for(Uint i = 0; i != nb_used_entities; ++i)
+    {
+      const Connectivity& connectivity = *connectivities[i];
+      const Uint nb_elems = connectivity.size();
+      for(Uint elem = 0; elem != nb_elems; ++elem)
       {
-        BOOST_FOREACH(const Uint node_b, connectivity[elem])
+        BOOST_FOREACH(const Uint node, connectivity[elem])
         {
-          connectivity_sets[used_node_map[node_a]].insert(used_node_map[node_b]);
+          node_elements[fill_pos[used_node_map[node]]++] = elements_offsets[i] + elem;
         }
       }
     }
   }
 
-  // Sum the number of connected nodes to get the real start indices
-  const Uint start_indices_end = start_indices.size();
-  for(Uint i = 1; i != start_indices_end; ++i)
+  // Count the connected nodes for each row in a first pass, and fill the rows in a second pass, once the start indices are known
+  const Uint used_nb_threads = std::max(Uint(1), std::min(nb_threads, nb_used_nodes));
+  std::vector<Uint> row_sizes(nb_used_nodes);
+  boost::ptr_vector<detail::SparsityRowBuilder> row_builders;
+  for(Uint i = 0; i != used_nb_threads; ++i)
   {
-    start_indices[i] = connectivity_sets[i-1].size() + start_indices[i-1];
+    row_builders.push_back(new detail::SparsityRowBuilder(connectivities, elements_offsets, node_elements_start, node_elements, used_node_map, i*nb_used_nodes/used_nb_threads, (i+1)*nb_used_nodes/used_nb_threads));
   }
 
-  node_connectivity.reserve(start_indices.back());
-  for(Uint node = 0; node != nb_used_nodes; ++node)
+  detail::run_row_builders(row_builders, boost::bind(&detail::SparsityRowBuilder::count, _1, boost::ref(row_sizes)));
+
+  start_indices.assign(nb_used_nodes+1, 0);
+  for(Uint i = 0; i != nb_used_nodes; ++i)
+    start_indices[i+1] = start_indices[i] + row_sizes[i];
+
+  node_connectivity.clear();
+  node_connectivity.resize(start_indices.back());
+  detail::run_row_builders(row_builders, boost::bind(&detail::SparsityRowBuilder::fill, _1, boost::cref(start_indices), boost::ref(node_connectivity)));
+
+  // Peak memory used by the temporary structures, on top of the result itself
+  Uint peak_memory = (node_elements_start.size() + node_elements.size() + row_sizes.size()) * sizeof(Uint);
+  BOOST_FOREACH(const detail::SparsityRowBuilder& row_builder, row_builders)
   {
-    node_connectivity.insert(node_connectivity.begin() + start_indices[node], connectivity_sets[node].begin(), connectivity_sets[node].end());
+    peak_memory += row_builder.capacity() * sizeof(Uint);
   }
+  const Uint result_memory = (node_connectivity.size() + start_indices.size()) * sizeof(Uint);
+  CFdebug << "Built sparsity for " << nb_used_nodes << " nodes with " << node_connectivity.size() << " nonzeros using " << used_nb_threads << " threads. Peak memory: "
+          << (peak_memory + result_memory) / 1048576. << " MB, of which " << result_memory / 1048576. << " MB for the result" << CFendl;
 
   return used_nodes_ptr;
 }
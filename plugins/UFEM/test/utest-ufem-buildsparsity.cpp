@@ -7,7 +7,10 @@
 #define BOOST_TEST_DYN_LINK
 #define BOOST_TEST_MODULE "Test module for heat-conduction related proto operations"
 
+#include <set>
+
 #include <boost/assign.hpp>
+#include <boost/foreach.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include "common/Core.hpp"
@@ -17,7 +20,13 @@
 
 #include "math/LSS/System.hpp"
 
+#include "mesh/Connectivity.hpp"
 #include "mesh/Domain.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Space.hpp"
 #include "mesh/LagrangeP1/Line1D.hpp"
 
 #include "solver/Model.hpp"
@@ -52,6 +61,49 @@ struct UFEMBuildSparsityFixture
   {
   }
 
+  // Check build_sparsity against a straightforward construction using a set for each node
+  void check_sparsity(Mesh& mesh, const Uint nb_threads)
+  {
+    std::vector<Uint> node_connectivity, starting_indices;
+    Handle< List<Uint> > gids = mesh.create_component< List<Uint> >("GIDs");
+    Handle< List<Uint> > ranks = mesh.create_component< List<Uint> >("Ranks");
+    Handle< List<int> > used_node_map = mesh.create_component< List<int> >("used_node_map");
+    UFEM::build_sparsity(std::vector< Handle<Region> >(1, mesh.topology().handle<Region>()), mesh.geometry_fields(), node_connectivity, starting_indices, *gids, *ranks, *used_node_map, nb_threads);
+
+    const Uint nb_nodes = mesh.geometry_fields().size();
+    std::vector< std::set<Uint> > connectivity_sets(nb_nodes);
+    BOOST_FOREACH(const Elements& elements, find_components_recursively_with_filter<Elements>(mesh.topology(), IsElementsVolume()))
+    {
+      const Connectivity& connectivity = elements.geometry_space().connectivity();
+      const Uint nb_elems = connectivity.size();
+      for(Uint elem = 0; elem != nb_elems; ++elem)
+      {
+        BOOST_FOREACH(const Uint node_a, connectivity[elem])
+        {
+          BOOST_FOREACH(const Uint node_b, connectivity[elem])
+          {
+            connectivity_sets[(*used_node_map)[node_a]].insert((*used_node_map)[node_b]);
+          }
+        }
+      }
+    }
+
+    std::vector<Uint> reference_connectivity;
+    std::vector<Uint> reference_indices(1, 0);
+    BOOST_FOREACH(const std::set<Uint>& nodes, connectivity_sets)
+    {
+      reference_indices.push_back(reference_indices.back() + nodes.size());
+      reference_connectivity.insert(reference_connectivity.end(), nodes.begin(), nodes.end());
+    }
+
+    BOOST_CHECK_EQUAL_COLLECTIONS(starting_indices.begin(), starting_indices.end(), reference_indices.begin(), reference_indices.end());
+    BOOST_CHECK_EQUAL_COLLECTIONS(node_connectivity.begin(), node_connectivity.end(), reference_connectivity.begin(), reference_connectivity.end());
+
+    mesh.remove_component(*gids);
+    mesh.remove_component(*ranks);
+    mesh.remove_component(*used_node_map);
+  }
+
   Component& root;
 };
 
@@ -63,6 +115,23 @@ BOOST_AUTO_TEST_CASE( InitMPI )
   BOOST_CHECK_EQUAL(common::PE::Comm::instance().size(), 1);
 }
 
+BOOST_AUTO_TEST_CASE( SparsityReference )
+{
+  Mesh& quads = *root.create_component<Mesh>("QuadMesh");
+  Tools::MeshGeneration::create_rectangle(quads, 5., 4., 10, 8);
+  Mesh& tetras = *root.create_component<Mesh>("TetraMesh");
+  Tools::MeshGeneration::create_box_tetras(tetras, 5., 4., 3., 6, 5, 4);
+
+  for(Uint nb_threads = 1; nb_threads != 4; ++nb_threads)
+  {
+    check_sparsity(quads, nb_threads);
+    check_sparsity(tetras, nb_threads);
+  }
+
+  root.remove_component(quads);
+  root.remove_component(tetras);
+}
+
 BOOST_AUTO_TEST_CASE( Sparsity1D )
 {
   Core::instance().environment().options().set("log_level", 4u);
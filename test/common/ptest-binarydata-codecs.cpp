@@ -0,0 +1,152 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Benchmark of the BinaryDataWriter codecs"
+
+#include <cmath>
+#include <iostream>
+
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <boost/test/unit_test.hpp>
+#include <boost/random/mersenne_twister.hpp>
+#include <boost/random/normal_distribution.hpp>
+
+#include "common/BinaryDataCodecs.hpp"
+#include "common/BinaryDataReader.hpp"
+#include "common/BinaryDataWriter.hpp"
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Group.hpp"
+#include "common/OptionList.hpp"
+#include "common/Table.hpp"
+#include "common/Timer.hpp"
+
+#include "common/PE/Comm.hpp"
+
+using namespace cf3;
+
+////////////////////////////////////////////////////////////////////////////////
+
+/// Writes the Real blocks of a restart file, or synthetic field data, using each codec and reports the write bandwidth and the file size.
+/// Usage: ptest-binarydata-codecs [restart.cfbinxml]
+struct CodecBenchmarkFixture
+{
+  /// Load the data to write. Without arguments, a smooth 3-component field with some noise is generated
+  static void load_data(common::Component& parent)
+  {
+    const int argc = boost::unit_test::framework::master_test_suite().argc;
+    char** argv = boost::unit_test::framework::master_test_suite().argv;
+
+    if(argc > 1)
+    {
+      common::BinaryDataReader& reader = *parent.create_component<common::BinaryDataReader>("Reader");
+      reader.options().set("file", common::URI(argv[1]));
+      const Uint nb_blocks = reader.nb_blocks();
+      for(Uint i = 0; i != nb_blocks; ++i)
+      {
+        if(reader.block_type_name(i) != common::class_name<Real>())
+          continue;
+        common::Table<Real>& table = *parent.create_component< common::Table<Real> >("Block" + common::to_str(i));
+        reader.read_table(table, i);
+      }
+      reader.close();
+      return;
+    }
+
+    const Uint nb_rows = 2000000;
+    boost::random::mt19937 gen(42);
+    boost::random::normal_distribution<Real> noise(0., 1e-8);
+    common::Table<Real>& table = *parent.create_component< common::Table<Real> >("Velocity");
+    table.set_row_size(3);
+    table.resize(nb_rows);
+    for(Uint i = 0; i != nb_rows; ++i)
+    {
+      const Real x = static_cast<Real>(i) / static_cast<Real>(nb_rows);
+      table[i][0] = 1. + 0.1*std::sin(20.*x) + noise(gen);
+      table[i][1] = 0.05*std::cos(13.*x) + noise(gen);
+      table[i][2] = 0.01*std::sin(7.*x)*std::cos(3.*x) + noise(gen);
+    }
+  }
+
+  /// Write all tables under the data component with the given settings and print the results
+  static void benchmark(common::Component& data, const std::string& codec, const Uint level, const bool shuffle)
+  {
+    const std::string name = codec + "-" + common::to_str(level) + (shuffle ? "-shuffle" : "");
+    common::BinaryDataWriter& writer = *data.create_component<common::BinaryDataWriter>("Writer-" + name);
+    writer.options().set("file", common::URI("codec-benchmark-" + name + ".cfbinxml"));
+    writer.options().set("codec", codec);
+    writer.options().set("compression_level", level);
+    writer.options().set("shuffle", shuffle);
+    writer.options().set("asynchronous", false);
+
+    Uint raw_size = 0;
+    common::Timer timer;
+    BOOST_FOREACH(const common::Table<Real>& table, common::find_components< common::Table<Real> >(data))
+    {
+      writer.append_data(table);
+      raw_size += table.size() * table.row_size() * sizeof(Real);
+    }
+    writer.close();
+    const Real elapsed = timer.elapsed();
+
+    const std::string binary_file = "codec-benchmark-" + name + "_P" + common::to_str(common::PE::Comm::instance().rank()) + ".cfbin";
+    const Real file_size = boost::filesystem::file_size(binary_file);
+    data.remove_component(writer);
+    boost::filesystem::remove(binary_file);
+    if(common::PE::Comm::instance().rank() == 0)
+      boost::filesystem::remove("codec-benchmark-" + name + ".cfbinxml");
+
+    const Real bandwidth = static_cast<Real>(raw_size) / elapsed / 1e6;
+    const Real ratio = file_size / static_cast<Real>(raw_size);
+    std::cout << name << ": " << bandwidth << " MB/s, size ratio " << ratio << std::endl;
+    std::cout << "<DartMeasurement name=\"" << name << " bandwidth\" type=\"numeric/double\">" << bandwidth << "</DartMeasurement>" << std::endl;
+    std::cout << "<DartMeasurement name=\"" << name << " ratio\" type=\"numeric/double\">" << ratio << "</DartMeasurement>" << std::endl;
+  }
+};
+
+BOOST_FIXTURE_TEST_SUITE( CodecBenchmarkSuite, CodecBenchmarkFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Init )
+{
+  common::PE::Comm::instance().init(boost::unit_test::framework::master_test_suite().argc, boost::unit_test::framework::master_test_suite().argv);
+  load_data(*common::Core::instance().root().create_component<common::Group>("Data"));
+}
+
+BOOST_AUTO_TEST_CASE( Codecs )
+{
+  common::Component& data = *common::Core::instance().root().get_child("Data");
+
+  benchmark(data, "none", 0, false);
+  for(Uint shuffle = 0; shuffle != 2; ++shuffle)
+  {
+    benchmark(data, "zlib", 1, shuffle);
+    benchmark(data, "zlib", 6, shuffle);
+    benchmark(data, "zlib", 9, shuffle);
+    const std::vector<std::string> codecs = common::binary_data_codecs();
+    if(std::find(codecs.begin(), codecs.end(), "zstd") != codecs.end())
+    {
+      benchmark(data, "zstd", 1, shuffle);
+      benchmark(data, "zstd", 3, shuffle);
+      benchmark(data, "zstd", 9, shuffle);
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE( Finalize )
+{
+  common::PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -9,12 +9,14 @@
 
 #include <iostream>
 
+#include <boost/foreach.hpp>
 #include <boost/mpl/if.hpp>
 #include <boost/test/unit_test.hpp>
 #include <boost/random/mersenne_twister.hpp>
 #include <boost/random/uniform_int_distribution.hpp>
 #include <boost/random/uniform_real_distribution.hpp>
 
+#include "common/BinaryDataCodecs.hpp"
 #include "common/BinaryDataReader.hpp"
 #include "common/BinaryDataWriter.hpp"
 #include "common/Core.hpp"
@@ -173,6 +175,98 @@ BOOST_AUTO_TEST_CASE( ReadBinaryData )
   BOOST_CHECK_EQUAL(empty_real_table.row_size(), 8);
 }
 
+BOOST_AUTO_TEST_CASE( ModifyAfterAppend )
+{
+  common::Component& group = *common::Core::instance().root().create_component("ModifyGroup", "cf3.common.Group");
+
+  common::Table<Real>& real_table = *group.create_component< common::Table<Real> >("RealTable");
+  real_table.set_row_size(real_table_cols);
+  real_table.resize(real_table_size);
+  fill_table(real_table);
+  common::Table<Real>& original_table = *group.create_component< common::Table<Real> >("OriginalTable");
+  original_table.set_row_size(real_table_cols);
+  original_table.resize(real_table_size);
+  original_table.array() = real_table.array();
+
+  // Modifying the table right after appending it must not affect the written data, in both modes
+  for(Uint asynchronous = 0; asynchronous != 2; ++asynchronous)
+  {
+    common::BinaryDataWriter& writer = *group.create_component<common::BinaryDataWriter>("Writer" + common::to_str(asynchronous));
+    writer.options().set("file", common::URI("binary_data_modified.cfbinxml"));
+    writer.options().set("asynchronous", asynchronous == 1);
+    writer.append_data(real_table);
+    fill_table(real_table);
+    writer.append_data(real_table);
+    writer.close();
+
+    common::BinaryDataReader& reader = *group.create_component<common::BinaryDataReader>("Reader" + common::to_str(asynchronous));
+    reader.options().set("file", common::URI("binary_data_modified.cfbinxml"));
+    common::Table<Real>& read_table = *group.create_component< common::Table<Real> >("ReadTable" + common::to_str(asynchronous));
+    reader.read_table(read_table, 0);
+    BOOST_CHECK(read_table.array() == original_table.array());
+    reader.read_table(read_table, 1);
+    BOOST_CHECK(read_table.array() == real_table.array());
+
+    original_table.array() = real_table.array();
+  }
+}
+
+BOOST_AUTO_TEST_CASE( CodecsAndMemoryMap )
+{
+  common::Component& group = *common::Core::instance().root().create_component("CodecGroup", "cf3.common.Group");
+
+  common::Table<Real>& real_table = *group.create_component< common::Table<Real> >("RealTable");
+  real_table.set_row_size(real_table_cols);
+  real_table.resize(real_table_size);
+  fill_table(real_table);
+  common::List<Uint>& int_list = *group.create_component< common::List<Uint> >("IntList");
+  int_list.resize(int_list_size);
+  fill_list(int_list);
+
+  // All codecs, with and without byte shuffling
+  BOOST_FOREACH(const std::string& codec, common::binary_data_codecs())
+  for(Uint shuffle = 0; shuffle != 2; ++shuffle)
+  {
+    const std::string suffix = codec + common::to_str(shuffle);
+    common::BinaryDataWriter& writer = *group.create_component<common::BinaryDataWriter>("Writer_" + suffix);
+    writer.options().set("file", common::URI("binary_data_" + suffix + ".cfbinxml"));
+    writer.options().set("codec", codec);
+    writer.options().set("shuffle", shuffle == 1);
+    if(codec == "zlib")
+      writer.options().set("compression_level", 1u);
+    writer.append_data(int_list);
+    writer.append_data(real_table);
+    writer.close();
+
+    for(Uint memory_map = 0; memory_map != 2; ++memory_map)
+    {
+      common::BinaryDataReader& reader = *group.create_component<common::BinaryDataReader>("Reader_" + suffix + common::to_str(memory_map));
+      reader.options().set("file", common::URI("binary_data_" + suffix + ".cfbinxml"));
+      reader.options().set("memory_map", memory_map == 1);
+      BOOST_CHECK_EQUAL(reader.block_codec(1), codec);
+
+      // Read in reverse order, to check that blocks are accessed independently
+      common::Table<Real>& read_table = *group.create_component< common::Table<Real> >("ReadTable_" + suffix + common::to_str(memory_map));
+      reader.read_table(read_table, 1);
+      BOOST_CHECK(read_table.array() == real_table.array());
+      common::List<Uint>& read_list = *group.create_component< common::List<Uint> >("ReadList_" + suffix + common::to_str(memory_map));
+      reader.read_list(read_list, 0);
+      BOOST_CHECK(read_list.array() == int_list.array());
+
+      if(memory_map == 1 && codec == "none")
+      {
+        boost::const_multi_array_ref<Real, 2> mapped = reader.mapped_array<Real>(1);
+        BOOST_CHECK(mapped == real_table.array());
+        BOOST_CHECK_EQUAL(reinterpret_cast<std::size_t>(mapped.data()) % sizeof(Real), 0);
+      }
+      else
+      {
+        BOOST_CHECK_THROW(reader.mapped_array<Real>(1), common::SetupError);
+      }
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE_END()
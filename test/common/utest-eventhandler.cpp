@@ -13,6 +13,8 @@
 #include <iostream>
 
 #include "common/Core.hpp"
+#include "common/Component.hpp"
+#include "common/StringConversion.hpp"
 #include "common/OptionT.hpp"
 #include "common/OptionURI.hpp"
 #include "common/ConnectionManager.hpp"
@@ -162,6 +164,31 @@ struct DisplayIter : public ConnectionManager {
 
 };
 
+/// Records the senders of the tree_updated events
+
+struct TreeListener : public ConnectionManager {
+
+  void start_listening()
+  {
+    Core::instance().event_handler().connect_to_event( "tree_updated",
+                                                       this,
+                                                       &TreeListener::on_tree_updated );
+  }
+
+  void stop_listening()
+  {
+    connection("tree_updated")->disconnect();
+  }
+
+  void on_tree_updated( SignalArgs& args )
+  {
+    senders.push_back( args.node.attribute_value("sender") );
+  }
+
+  std::vector<std::string> senders;
+
+};
+
 //------------------------------------------------------------------------------------------
 // test fixtures
 
@@ -276,6 +303,56 @@ BOOST_FIXTURE_TEST_CASE( disconnect_from_event, local_fixture )
 
 #endif
 
+BOOST_AUTO_TEST_CASE( tree_update_batch )
+{
+  Component& root = *Core::instance().root().create_component<Component>("batch_root");
+  Component& outside = *Core::instance().root().create_component<Component>("outside");
+
+  // without listeners, nothing needs to be built
+  BOOST_CHECK( !Core::instance().event_handler().has_listeners("tree_updated") );
+
+  TreeListener listener;
+  listener.start_listening();
+  BOOST_CHECK( Core::instance().event_handler().has_listeners("tree_updated") );
+
+  // every change is notified by default
+  root.create_component<Component>("a");
+  BOOST_CHECK_EQUAL( listener.senders.size(), 1u );
+
+  // changes in the subtree are coalesced into one event for the root, after the outermost guard
+  listener.senders.clear();
+  {
+    TreeUpdateBatch batch(root);
+    Component& b = *root.create_component<Component>("b");
+    {
+      TreeUpdateBatch inner_batch(b);
+      for(Uint i = 0; i != 10; ++i)
+        b.create_component<Component>("c" + to_str(i));
+    }
+    root.remove_component("a");
+    BOOST_CHECK( listener.senders.empty() );
+
+    // components outside the guarded subtree are not affected
+    outside.create_component<Component>("d");
+    BOOST_CHECK_EQUAL( listener.senders.size(), 1u );
+    BOOST_CHECK_EQUAL( listener.senders.back(), outside.uri().string() );
+  }
+  BOOST_CHECK_EQUAL( listener.senders.size(), 2u );
+  BOOST_CHECK_EQUAL( listener.senders.back(), root.uri().string() );
+
+  // no event if nothing changed
+  {
+    TreeUpdateBatch batch(root);
+  }
+  BOOST_CHECK_EQUAL( listener.senders.size(), 2u );
+
+  listener.stop_listening();
+  BOOST_CHECK( !Core::instance().event_handler().has_listeners("tree_updated") );
+
+  Core::instance().root().remove_component("batch_root");
+  Core::instance().root().remove_component("outside");
+}
+
 //------------------------------------------------------------------------------------------
 
 BOOST_AUTO_TEST_SUITE_END()
@@ -212,6 +212,66 @@ BOOST_AUTO_TEST_CASE( commpattern_mainstream )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( commpattern_neighbour_exchange )
+{
+  // general constants in this routine
+  const int nproc=PE::Comm::instance().size();
+  const int irank=PE::Comm::instance().rank();
+
+  // commpattern
+  boost::shared_ptr<CommPattern> pecp_ptr = allocate_component<CommPattern>("CommPattern");
+  CommPattern& pecp = *pecp_ptr;
+
+  // setup gid & rank
+  std::vector<Uint> gid;
+  std::vector<Uint> rank;
+  setupGidAndRank(gid,rank);
+  pecp.insert("gid",gid,1,false);
+
+  // additional arrays for testing, v3 is not synchronized
+  std::vector<int> v1;
+  for(int i=0;i<6*nproc;i++) v1.push_back(-((irank+1)*1000+i+1));
+  pecp.insert("v1",v1,1,true);
+  std::vector<double> v2;
+  for(int i=0;i<12*nproc;i++) v2.push_back((double)((irank+1)*1000+i+1));
+  pecp.insert("v2",v2,2,true);
+  std::vector<int> v3(v1);
+  pecp.insert("v3",v3,1,true);
+
+  pecp.setup(Handle<CommWrapper>(pecp.get_child("gid")),rank);
+
+  // synchronize v1 and v2 in one go, twice to reuse the persistent requests
+  std::vector<std::string> names;
+  names.push_back("v1");
+  names.push_back("v2");
+  for (int pass=0; pass<2; ++pass)
+  {
+    pecp.begin_synchronize(names);
+    BOOST_CHECK( pecp.is_synchronizing() );
+    pecp.end_synchronize();
+    BOOST_CHECK( !pecp.is_synchronizing() );
+  }
+  BOOST_CHECK_THROW( pecp.end_synchronize(), ShouldNotBeHere );
+
+  // check results
+  Uint idx=0;
+  Uint i;
+  for (i=0; i<  nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-0*nproc)/1)+1)*1000+idx+1)) );
+  for (   ; i<3*nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-1*nproc)/2)+1)*1000+idx+1)) );
+  for (   ; i<6*nproc; i++, idx++ ) BOOST_CHECK_EQUAL( v1[i], (int)(-((((i-3*nproc)/3)+1)*1000+idx+1)) );
+  idx=0;
+  for (i=0; i< 2*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-0*nproc)/2)+1)*1000+idx+1) );
+  for (   ; i< 6*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-2*nproc)/4)+1)*1000+idx+1) );
+  for (   ; i<12*nproc; i++, idx++) BOOST_CHECK_EQUAL( v2[i], (double)((((i-6*nproc)/6)+1)*1000+idx+1) );
+  for (i=0; i<6*nproc; i++) BOOST_CHECK_EQUAL( v3[i], (int)(-((irank+1)*1000+i+1)) );
+
+  // the whole pattern, with a different item size
+  pecp.synchronize_all();
+  for (i=0; i<6*nproc; i++) BOOST_CHECK_EQUAL( v3[i], v1[i] );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( commpattern_external_synchronization )
 {
 /*
@@ -0,0 +1,196 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::common::Trace"
+
+#include <fstream>
+#include <sstream>
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/BasicExceptions.hpp"
+#include "common/Core.hpp"
+#include "common/Timer.hpp"
+#include "common/Trace.hpp"
+
+#include "common/PE/Comm.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct TraceFixture
+{
+  /// common setup for each test case
+  TraceFixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// Spend some time, so the timed scopes are never empty
+  static void work()
+  {
+    Timer timer;
+    while(timer.elapsed() < 1e-3) {}
+  }
+
+  int    m_argc;
+  char** m_argv;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( TraceSuite, TraceFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  Core::instance().initiate(m_argc,m_argv);
+  PE::Comm::instance().init(m_argc,m_argv);
+  BOOST_CHECK_EQUAL(PE::Comm::instance().size(),2u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( hierarchical_statistics )
+{
+  Trace::instance().reset();
+  const Uint rank = PE::Comm::instance().rank();
+
+  for(Uint i = 0; i != 2; ++i)
+  {
+    TraceScope outer("outer");
+    for(Uint j = 0; j != 3; ++j)
+    {
+      TraceScope inner("inner");
+      work();
+    }
+    if(rank == 1)
+    {
+      TraceScope rank_1("only_on_rank_1");
+      work();
+    }
+  }
+
+  const std::vector<TraceStatistics> stats = Trace::instance().statistics();
+  std::ostringstream output;
+  Trace::instance().print_statistics(output);
+  if(rank != 0)
+  {
+    BOOST_CHECK(stats.empty());
+    BOOST_CHECK(output.str().empty());
+    return;
+  }
+
+  BOOST_REQUIRE_EQUAL(stats.size(), 3u);
+  BOOST_CHECK_EQUAL(stats[0].path, "outer");
+  BOOST_CHECK_EQUAL(stats[0].depth, 0u);
+  BOOST_CHECK_EQUAL(stats[0].nb_ranks, 2u);
+  BOOST_CHECK_EQUAL(stats[0].min_count, 2u);
+  BOOST_CHECK_EQUAL(stats[0].max_count, 2u);
+
+  BOOST_CHECK_EQUAL(stats[1].path, "outer/inner");
+  BOOST_CHECK_EQUAL(stats[1].depth, 1u);
+  BOOST_CHECK_EQUAL(stats[1].min_count, 6u);
+  BOOST_CHECK(stats[1].min_time > 0.);
+  BOOST_CHECK(stats[1].min_time <= stats[1].mean_time);
+  BOOST_CHECK(stats[1].mean_time <= stats[1].max_time);
+  BOOST_CHECK(stats[0].min_time >= stats[1].min_time);
+
+  // The scope entered on one process only is counted as 0 s on the other
+  BOOST_CHECK_EQUAL(stats[2].path, "outer/only_on_rank_1");
+  BOOST_CHECK_EQUAL(stats[2].nb_ranks, 1u);
+  BOOST_CHECK_EQUAL(stats[2].min_count, 0u);
+  BOOST_CHECK_EQUAL(stats[2].max_count, 2u);
+  BOOST_CHECK_EQUAL(stats[2].min_time, 0.);
+  BOOST_CHECK_CLOSE(stats[2].imbalance, 2., 1e-10);
+
+  BOOST_CHECK(output.str().find("\n  only_on_rank_1: [0, ") != std::string::npos);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( disabled )
+{
+  Trace::instance().reset();
+
+  {
+    TraceScope recorded("recorded");
+    Trace::instance().enabled(false);
+    TraceScope ignored("ignored");
+    Trace::instance().enabled(true);
+    TraceScope nested("nested");
+  }
+
+  const std::vector<TraceStatistics> stats = Trace::instance().statistics();
+  if(PE::Comm::instance().rank() == 0)
+  {
+    BOOST_REQUIRE_EQUAL(stats.size(), 2u);
+    BOOST_CHECK_EQUAL(stats[0].path, "recorded");
+    BOOST_CHECK_EQUAL(stats[0].min_count, 1u);
+    BOOST_CHECK_EQUAL(stats[1].path, "recorded/nested");
+    BOOST_CHECK_EQUAL(stats[1].min_count, 1u);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( chrome_trace )
+{
+  Trace::instance().reset();
+  Trace::instance().max_events(4);
+
+  for(Uint i = 0; i != 3; ++i)
+  {
+    TraceScope outer("outer \"quoted\"");
+    TraceScope inner("inner");
+  }
+  BOOST_CHECK_EQUAL(Trace::instance().nb_dropped_events(), 2u);
+
+  Trace::instance().write_chrome_trace("utest-trace.json");
+  Trace::instance().max_events(100000);
+
+  if(PE::Comm::instance().rank() == 0)
+  {
+    std::ifstream file("utest-trace.json");
+    const std::string json((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    BOOST_CHECK_EQUAL(json.find("{\"traceEvents\":["), 0u);
+
+    // The 4 events kept on each rank
+    Uint nb_events = 0;
+    for(std::string::size_type pos = json.find("\"ph\":\"X\""); pos != std::string::npos; pos = json.find("\"ph\":\"X\"", pos+1))
+      ++nb_events;
+    BOOST_CHECK_EQUAL(nb_events, 8u);
+    BOOST_CHECK(json.find("\"args\":{\"name\":\"rank 1\"}") != std::string::npos);
+    BOOST_CHECK(json.find("\"path\":\"outer \\\"quoted\\\"/inner\"") != std::string::npos);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( reset_with_open_scope )
+{
+  TraceScope open_scope("open");
+  BOOST_CHECK_THROW(Trace::instance().reset(), SetupError);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -474,6 +474,67 @@ BOOST_AUTO_TEST_CASE( test_matrix_only )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( test_cached_assembly )
+{
+  if(matrix_builder != "cf3.math.LSS.TrilinosCrsMatrix")
+    return;
+
+  boost::shared_ptr<common::PE::CommPattern> cp_ptr = common::allocate_component<common::PE::CommPattern>("commpattern");
+  common::PE::CommPattern& cp = *cp_ptr;
+  build_commpattern(cp);
+  boost::shared_ptr<LSS::System> sys(common::allocate_component<LSS::System>("sys"));
+  sys->options().option("matrix_builder").change_value(matrix_builder);
+  build_system(*sys,cp);
+  Handle<LSS::Matrix> mat=sys->matrix();
+
+  LSS::BlockAccumulator ba;
+  ba.resize(3,neq);
+  for(int i = 0; i != ba.mat.rows(); ++i)
+    for(int j = 0; j != ba.mat.cols(); ++j)
+      ba.mat(i,j) = 10*i + j + 1;
+
+  std::vector<Uint> rows, cols;
+  std::vector<Real> vals;
+
+  // Assemble two element matrices, the second one with the nodes in a different order
+  const Uint nodes[2][3] = { {5, 2, 8}, {8, 5, 2} };
+  std::vector< std::vector<Real> > assembled_vals;
+  const bool cached_assembly[4] = { false, true, true, true };
+  for(Uint pass = 0; pass != 4; ++pass)
+  {
+    mat->options().set("cached_assembly", cached_assembly[pass]);
+    mat->reset();
+    if(irank == 1)
+    {
+      // Change the insertion order in the last pass, to check that the cache is rebuilt
+      const Uint nb_elems = pass == 3 ? 1 : 2;
+      for(Uint e = 0; e != nb_elems; ++e)
+      {
+        const Uint elem = pass == 3 ? 1 : e;
+        for(Uint i = 0; i != 3; ++i)
+          ba.indices[i] = nodes[elem][i];
+        mat->add_values(ba);
+      }
+      if(pass == 3)
+      {
+        for(Uint i = 0; i != 3; ++i)
+          ba.indices[i] = nodes[0][i];
+        mat->add_values(ba);
+      }
+    }
+    mat->debug_data(rows,cols,vals);
+    assembled_vals.push_back(vals);
+  }
+
+  // Pass 1 records the offsets, pass 2 uses them and pass 3 records them again
+  for(Uint pass = 1; pass != 4; ++pass)
+    BOOST_CHECK_EQUAL_COLLECTIONS(assembled_vals[pass].begin(), assembled_vals[pass].end(), assembled_vals[0].begin(), assembled_vals[0].end());
+
+  mat->options().set("cached_assembly", false);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( test_vector_only )
 {
   // build a commpattern and the two vectors
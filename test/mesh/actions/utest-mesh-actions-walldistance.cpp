@@ -0,0 +1,125 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Tests mesh::actions::WallDistance"
+
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "common/OptionList.hpp"
+#include "common/Core.hpp"
+#include "common/FindComponents.hpp"
+#include "common/PE/Comm.hpp"
+
+#include "mesh/actions/WallDistance.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/SimpleMeshGenerator.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+using namespace cf3::mesh::actions;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct WallDistanceFixture
+{
+  WallDistanceFixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// Compute the distance to the bottom wall of a square or cube with side 1, and check that it equals the y-coordinate
+  void check_bottom_distance(const Uint dim, const bool exact, const Uint nb_threads)
+  {
+    const std::string name = "mesh" + boost::lexical_cast<std::string>(dim) + "d_" + (exact ? "exact" : "approximate") + "_" + boost::lexical_cast<std::string>(nb_threads);
+
+    Handle<MeshGenerator> mesh_generator = Core::instance().root().create_component<SimpleMeshGenerator>("generate_" + name);
+    mesh_generator->options().set("mesh",Core::instance().root().uri()/name);
+    mesh_generator->options().set("lengths",std::vector<Real>(dim,1.));
+    mesh_generator->options().set("nb_cells",std::vector<Uint>(dim,8));
+    Mesh& mesh = mesh_generator->generate();
+
+    Handle<WallDistance> wall_distance = Core::instance().root().create_component<WallDistance>("wall_distance_" + name);
+    wall_distance->options().set("mesh", mesh.handle<Mesh>());
+    wall_distance->options().set("regions", std::vector< Handle<Region> >(1, Handle<Region>(mesh.topology().get_child("bottom"))));
+    wall_distance->options().set("exact", exact);
+    wall_distance->options().set("nb_threads", nb_threads);
+    wall_distance->execute();
+
+    const Field& coords = mesh.geometry_fields().coordinates();
+    const Field& d = *Handle<Field>(mesh.geometry_fields().get_child("wall_distance"));
+    const Uint nb_nodes = coords.size();
+    BOOST_CHECK(nb_nodes > 0);
+    for(Uint i = 0; i != nb_nodes; ++i)
+    {
+      BOOST_CHECK_SMALL(d[i][0] - coords[i][1], 1e-12);
+    }
+  }
+
+  int m_argc;
+  char** m_argv;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( WallDistanceSuite, WallDistanceFixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Initiate )
+{
+  Core::instance().initiate(m_argc,m_argv);
+  PE::Comm::instance().init(m_argc,m_argv);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Approximate2D )
+{
+  check_bottom_distance(2, false, 1);
+}
+
+BOOST_AUTO_TEST_CASE( Exact2D )
+{
+  check_bottom_distance(2, true, 1);
+}
+
+BOOST_AUTO_TEST_CASE( Approximate3D )
+{
+  check_bottom_distance(3, false, 1);
+}
+
+BOOST_AUTO_TEST_CASE( Exact3D )
+{
+  check_bottom_distance(3, true, 1);
+}
+
+BOOST_AUTO_TEST_CASE( Threaded )
+{
+  check_bottom_distance(2, true, 3);
+  check_bottom_distance(3, false, 3);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Terminate )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -8,6 +8,9 @@
 #define BOOST_TEST_MODULE "Test module for cf3::mesh::gmsh::Reader parallel"
 
 #include <iostream>
+#include <fstream>
+#include <iomanip>
+#include <boost/cstdint.hpp>
 #include <boost/test/unit_test.hpp>
 
 #include "common/Log.hpp"
@@ -18,6 +21,8 @@
 #include "common/Environment.hpp"
 #include "common/BoostAnyConversion.hpp"
 #include "common/List.hpp"
+#include "common/FindComponents.hpp"
+#include "common/Table.hpp"
 
 #include "mesh/Mesh.hpp"
 #include "mesh/Region.hpp"
@@ -27,6 +32,7 @@
 #include "mesh/MeshTransformer.hpp"
 #include "mesh/Field.hpp"
 #include "mesh/Entities.hpp"
+#include "mesh/Connectivity.hpp"
 #include "mesh/Space.hpp"
 #include "mesh/Dictionary.hpp"
 #include "mesh/MeshAdaptor.hpp"
@@ -226,6 +232,117 @@ BOOST_AUTO_TEST_CASE( test )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( binary_format )
+{
+  // Structured grid of quads with lines on the bottom boundary, with odd node numbers only,
+  // written once in ASCII and once in binary msh 2.2 format
+  const Uint nx = 5;
+  const Uint ny = 4;
+  const Uint nb_quads = (nx-1)*(ny-1);
+  const Uint nb_lines = nx-1;
+  if (PE::Comm::instance().rank() == 0)
+  {
+    std::ofstream ascii("utest-mesh-gmsh-parallel-ascii.msh");
+    std::ofstream binary("utest-mesh-gmsh-parallel-binary.msh",std::ios::binary);
+    const std::string physical_names = "$PhysicalNames\n2\n1 1 \"bottom\"\n2 2 \"fluid\"\n$EndPhysicalNames\n";
+    ascii << "$MeshFormat\n2.2 0 8\n$EndMeshFormat\n" << physical_names;
+    binary << "$MeshFormat\n2.2 1 8\n";
+    const boost::int32_t one = 1;
+    binary.write(reinterpret_cast<const char*>(&one),sizeof(one));
+    binary << "\n$EndMeshFormat\n" << physical_names;
+
+    ascii << "$Nodes\n" << nx*ny << "\n" << std::setprecision(17);
+    binary << "$Nodes\n" << nx*ny << "\n";
+    for (Uint k=0; k<nx*ny; ++k)
+    {
+      const boost::int32_t number = 2*k+1;
+      const double coords[3] = { 0.25*(k%nx), -1.5e-3*(k/nx), 0. };
+      ascii << number << " " << coords[0] << " " << std::scientific << coords[1] << std::fixed << " 0\n";
+      binary.write(reinterpret_cast<const char*>(&number),sizeof(number));
+      binary.write(reinterpret_cast<const char*>(coords),sizeof(coords));
+    }
+    ascii << "$EndNodes\n$Elements\n" << nb_quads+nb_lines << "\n";
+    binary << "\n$EndNodes\n$Elements\n" << nb_quads+nb_lines << "\n";
+
+    boost::int32_t header[3] = { 3, boost::int32_t(nb_quads), 2 };
+    binary.write(reinterpret_cast<const char*>(header),sizeof(header));
+    boost::int32_t elem_number = 1;
+    for (Uint j=0; j<ny-1; ++j)
+    {
+      for (Uint i=0; i<nx-1; ++i, ++elem_number)
+      {
+        const boost::int32_t record[7] = { elem_number, 2, 1,
+                                           boost::int32_t(2*(j*nx+i)+1),     boost::int32_t(2*(j*nx+i+1)+1),
+                                           boost::int32_t(2*((j+1)*nx+i+1)+1), boost::int32_t(2*((j+1)*nx+i)+1) };
+        ascii << record[0] << " 3 2";
+        for (Uint r=1; r<7; ++r)
+          ascii << " " << record[r];
+        ascii << "\n";
+        binary.write(reinterpret_cast<const char*>(record),sizeof(record));
+      }
+    }
+    header[0] = 1;
+    header[1] = nb_lines;
+    binary.write(reinterpret_cast<const char*>(header),sizeof(header));
+    for (Uint i=0; i<nx-1; ++i, ++elem_number)
+    {
+      const boost::int32_t record[5] = { elem_number, 1, 2, boost::int32_t(2*i+1), boost::int32_t(2*(i+1)+1) };
+      ascii << record[0] << " 1 2";
+      for (Uint r=1; r<5; ++r)
+        ascii << " " << record[r];
+      ascii << "\n";
+      binary.write(reinterpret_cast<const char*>(record),sizeof(record));
+    }
+    ascii << "$EndElements\n";
+    binary << "\n$EndElements\n";
+  }
+  PE::Comm::instance().barrier();
+
+  boost::shared_ptr< MeshReader > read_mesh = build_component_abstract_type<MeshReader>("cf3.mesh.gmsh.Reader","meshreader");
+  Mesh& ascii_mesh = *Core::instance().root().create_component<Mesh>("ascii_mesh");
+  Mesh& binary_mesh = *Core::instance().root().create_component<Mesh>("binary_mesh");
+  read_mesh->read_mesh_into("utest-mesh-gmsh-parallel-ascii.msh",ascii_mesh);
+  read_mesh->read_mesh_into("utest-mesh-gmsh-parallel-binary.msh",binary_mesh);
+
+  // Both formats give the same distributed mesh
+  const Dictionary& ascii_nodes = ascii_mesh.geometry_fields();
+  const Dictionary& binary_nodes = binary_mesh.geometry_fields();
+  BOOST_CHECK_EQUAL(ascii_mesh.dimension(), 2u);
+  BOOST_REQUIRE_EQUAL(ascii_nodes.size(), binary_nodes.size());
+  for (Uint n=0; n<binary_nodes.size(); ++n)
+  {
+    const Uint k = binary_nodes.glb_idx()[n]/2;
+    BOOST_CHECK_EQUAL(binary_nodes.glb_idx()[n], ascii_nodes.glb_idx()[n]);
+    BOOST_CHECK_EQUAL(binary_nodes.rank()[n], ascii_nodes.rank()[n]);
+    BOOST_CHECK_EQUAL(binary_nodes.coordinates()[n][XX], 0.25*(k%nx));
+    BOOST_CHECK_EQUAL(binary_nodes.coordinates()[n][YY], -1.5e-3*(k/nx));
+    BOOST_CHECK_EQUAL(ascii_nodes.coordinates()[n][XX], binary_nodes.coordinates()[n][XX]);
+    BOOST_CHECK_EQUAL(ascii_nodes.coordinates()[n][YY], binary_nodes.coordinates()[n][YY]);
+  }
+
+  Uint nb_elems[2] = {0, 0};
+  boost_foreach(const Entities& binary_elements, find_components_recursively<Entities>(binary_mesh.topology()))
+  {
+    const Entities& ascii_elements = *ascii_mesh.access_component_checked(binary_elements.uri().path().substr(binary_mesh.uri().path().size()+1))->handle<Entities>();
+    const Connectivity& ascii_connectivity = ascii_elements.geometry_space().connectivity();
+    const Connectivity& binary_connectivity = binary_elements.geometry_space().connectivity();
+    BOOST_REQUIRE_EQUAL(ascii_connectivity.size(), binary_connectivity.size());
+    for (Uint e=0; e<binary_connectivity.size(); ++e)
+    {
+      BOOST_CHECK_EQUAL(ascii_elements.glb_idx()[e], binary_elements.glb_idx()[e]);
+      for (Uint n=0; n<binary_connectivity.row_size(); ++n)
+        BOOST_CHECK_EQUAL(ascii_connectivity[e][n], binary_connectivity[e][n]);
+    }
+    nb_elems[binary_elements.element_type().dimensionality()-1] += binary_elements.size();
+  }
+  Uint total_nb_elems[2];
+  PE::Comm::instance().all_reduce(PE::plus(),nb_elems,2,total_nb_elems);
+  BOOST_CHECK_EQUAL(total_nb_elems[0], nb_lines);
+  BOOST_CHECK_EQUAL(total_nb_elems[1], nb_quads);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( finalize_mpi )
 {
   PE::Comm::instance().finalize();
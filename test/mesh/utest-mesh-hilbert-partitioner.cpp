@@ -0,0 +1,184 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::HilbertPartitioner"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+#include "common/Table.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/MeshGenerator.hpp"
+#include "mesh/MeshTransformer.hpp"
+#include "mesh/HilbertPartitioner.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct HilbertPartitionerTests_Fixture
+{
+  /// common setup for each test case
+  HilbertPartitionerTests_Fixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// common tear-down for each test case
+  ~HilbertPartitionerTests_Fixture()
+  {
+  }
+
+  /// Generate a square of 24x24 quads, distributed by rows over the processors
+  Mesh& generate(const std::string& name)
+  {
+    boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+    meshgenerator->options().set("mesh",URI("//"+name));
+    meshgenerator->options().set("nb_cells",std::vector<Uint>(2,24));
+    meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+    meshgenerator->options().set("bdry",false);
+    return meshgenerator->generate();
+  }
+
+  /// Weight of an element: elements left of x = 0.5 are three times as expensive
+  static Real weight(const Entities& elements, const Uint e)
+  {
+    RealMatrix coordinates = elements.geometry_space().get_coordinates(e);
+    RealVector centroid(elements.element_type().dimension());
+    elements.element_type().compute_centroid(coordinates,centroid);
+    return centroid[0] < 0.5 ? 3. : 1.;
+  }
+
+  /// Sum of the weights of the owned elements, per processor
+  static std::vector<Real> owned_weight_per_proc(const Mesh& mesh, const bool weighted)
+  {
+    Real owned_weight = 0.;
+    for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+    {
+      const Entities& elements = *mesh.elements()[entities_idx];
+      for (Uint e=0; e<elements.size(); ++e)
+        if (!elements.is_ghost(e))
+          owned_weight += weighted ? weight(elements,e) : 1.;
+    }
+    std::vector<Real> weight_per_proc(PE::Comm::instance().size());
+    PE::Comm::instance().all_gather(owned_weight,weight_per_proc);
+    return weight_per_proc;
+  }
+
+  int    m_argc;
+  char** m_argv;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( HilbertPartitionerTests_TestSuite, HilbertPartitionerTests_Fixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  Core::instance().initiate(m_argc,m_argv);
+  PE::Comm::instance().init(m_argc,m_argv);
+  BOOST_CHECK_EQUAL(PE::Comm::instance().size(),2u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( balanced_and_repeatable )
+{
+  Mesh& mesh = generate("unit_weights");
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalNumbering","glb_numbering")->transform(mesh);
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalConnectivity","glb_connectivity")->transform(mesh);
+
+  boost::shared_ptr<HilbertPartitioner> partitioner = allocate_component<HilbertPartitioner>("partitioner");
+  partitioner->transform(mesh);
+
+  // Every processor owns half of the 576 cells
+  const std::vector<Real> weight_per_proc = owned_weight_per_proc(mesh,false);
+  BOOST_CHECK_EQUAL(weight_per_proc[0]+weight_per_proc[1],576.);
+  BOOST_CHECK_EQUAL(weight_per_proc[0],288.);
+
+  // Partitioning the migrated mesh again keeps every element where it is
+  boost::shared_ptr<HilbertPartitioner> repartitioner = allocate_component<HilbertPartitioner>("repartitioner");
+  repartitioner->initialize(mesh);
+  repartitioner->partition_graph();
+  Uint nb_moved = 0;
+  for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+  {
+    BOOST_CHECK_EQUAL(repartitioner->element_parts()[entities_idx].size(),mesh.elements()[entities_idx]->size());
+    for (Uint e=0; e<repartitioner->element_parts()[entities_idx].size(); ++e)
+      if (repartitioner->element_parts()[entities_idx][e] != mesh.elements()[entities_idx]->rank()[e])
+        ++nb_moved;
+  }
+  BOOST_CHECK_EQUAL(nb_moved,0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( weighted )
+{
+  Mesh& mesh = generate("weighted");
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalNumbering","glb_numbering")->transform(mesh);
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalConnectivity","glb_connectivity")->transform(mesh);
+
+  for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+  {
+    Entities& elements = *mesh.elements()[entities_idx];
+    common::List<Real>& weights = *elements.create_component< common::List<Real> >("partition_weights");
+    weights.resize(elements.size());
+    for (Uint e=0; e<elements.size(); ++e)
+      weights[e] = weight(elements,e);
+  }
+
+  boost::shared_ptr<HilbertPartitioner> partitioner = allocate_component<HilbertPartitioner>("partitioner");
+  partitioner->transform(mesh);
+
+  // The total weight is 288*3 + 288*1, and the cut is within one element of the middle
+  const std::vector<Real> weight_per_proc = owned_weight_per_proc(mesh,true);
+  BOOST_CHECK_EQUAL(weight_per_proc[0]+weight_per_proc[1],1152.);
+  BOOST_CHECK_LE(std::abs(weight_per_proc[0]-576.),3.);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( invalid_weights )
+{
+  Mesh& mesh = generate("invalid_weights");
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.GlobalNumbering","glb_numbering")->transform(mesh);
+
+  mesh.elements()[0]->create_component< common::List<Real> >("partition_weights")->resize(1);
+
+  boost::shared_ptr<HilbertPartitioner> partitioner = allocate_component<HilbertPartitioner>("partitioner");
+  BOOST_CHECK_THROW(partitioner->initialize(mesh),BadValue);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -305,6 +305,51 @@ BOOST_AUTO_TEST_CASE( test_new_interpolation )
 }
 
 
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( routing )
+{
+  // Source and target meshes are partitioned differently, so coordinates must be located on other processors
+  Handle<Mesh> source_mesh = Core::instance().root().create_component<Mesh>("routing_source");
+  boost::shared_ptr<MeshGenerator> mesh_gen = allocate_component<SimpleMeshGenerator>("meshgen");
+  mesh_gen->options().set("nb_cells",std::vector<Uint>(2,10));
+  mesh_gen->options().set("lengths",std::vector<Real>(2,1.));
+  mesh_gen->options().set("mesh",source_mesh->uri());
+  mesh_gen->execute();
+
+  Handle<Mesh> target_mesh = Core::instance().root().create_component<Mesh>("routing_target");
+  mesh_gen->options().set("nb_cells",std::vector<Uint>(2,7));
+  mesh_gen->options().set("mesh",target_mesh->uri());
+  mesh_gen->execute();
+
+  // Linear source field, which is interpolated exactly
+  const Field& source_coords = source_mesh->geometry_fields().coordinates();
+  Field& source_field = source_mesh->geometry_fields().create_field("linear","linear");
+  for (Uint i=0; i<source_field.size(); ++i)
+    source_field[i][0] = 1. + 2.*source_coords[i][XX] + 3.*source_coords[i][YY];
+
+  const Table<Real>& target_coords = target_mesh->geometry_fields().coordinates();
+  boost::shared_ptr< Table<Real> > target = allocate_component< Table<Real> >("target");
+  target->set_row_size(1);
+  target->resize(target_coords.size());
+
+  boost::shared_ptr< AInterpolator > interpolator = allocate_component<Interpolator>("interpolator");
+  std::vector<std::string> routings = list_of("bounding_box")("ring");
+  boost_foreach(const std::string& routing, routings)
+  {
+    interpolator->options().set("routing",routing);
+    for (Uint store=0; store<2; ++store)
+    {
+      interpolator->options().set("store",store == 1);
+      for (Uint i=0; i<target->size(); ++i)
+        (*target)[i][0] = 0.;
+      interpolator->interpolate(source_field,target_coords,*target);
+      for (Uint i=0; i<target_coords.size(); ++i)
+        BOOST_CHECK_CLOSE((*target)[i][0], 1. + 2.*target_coords[i][XX] + 3.*target_coords[i][YY], 1e-8);
+    }
+  }
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_CASE( finalize_mpi )
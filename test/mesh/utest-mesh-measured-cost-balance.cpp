@@ -0,0 +1,173 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for cf3::mesh::actions::MeasuredCostBalance"
+
+#include <boost/test/unit_test.hpp>
+
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/List.hpp"
+#include "common/OptionList.hpp"
+#include "common/PropertyList.hpp"
+#include "common/Table.hpp"
+
+#include "common/PE/Comm.hpp"
+
+#include "mesh/Mesh.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Entities.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Functions.hpp"
+#include "mesh/Space.hpp"
+#include "mesh/Tags.hpp"
+#include "mesh/MeshGenerator.hpp"
+#include "mesh/MeshTransformer.hpp"
+
+using namespace cf3;
+using namespace cf3::common;
+using namespace cf3::mesh;
+
+////////////////////////////////////////////////////////////////////////////////
+
+struct MeasuredCostBalanceTests_Fixture
+{
+  /// common setup for each test case
+  MeasuredCostBalanceTests_Fixture()
+  {
+    m_argc = boost::unit_test::framework::master_test_suite().argc;
+    m_argv = boost::unit_test::framework::master_test_suite().argv;
+  }
+
+  /// common tear-down for each test case
+  ~MeasuredCostBalanceTests_Fixture()
+  {
+  }
+
+  /// Cost of an element: the cells in the corner [0,0.25]x[0,0.25] are 5 times as expensive
+  static Real measured_cost(const Entities& elements, const Uint e)
+  {
+    RealMatrix coordinates = elements.geometry_space().get_coordinates(e);
+    RealVector centroid(elements.element_type().dimension());
+    elements.element_type().compute_centroid(coordinates,centroid);
+    return centroid[0] < 0.25 && centroid[1] < 0.25 ? 5. : 1.;
+  }
+
+  /// Sum of the cost of the owned cells, per processor
+  static std::vector<Real> owned_cost_per_proc(const Mesh& mesh)
+  {
+    Real owned_cost = 0.;
+    for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+    {
+      const Entities& elements = *mesh.elements()[entities_idx];
+      for (Uint e=0; e<elements.size(); ++e)
+        if (!elements.is_ghost(e))
+          owned_cost += measured_cost(elements,e);
+    }
+    std::vector<Real> cost_per_proc(PE::Comm::instance().size());
+    PE::Comm::instance().all_gather(owned_cost,cost_per_proc);
+    return cost_per_proc;
+  }
+
+  int    m_argc;
+  char** m_argv;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_FIXTURE_TEST_SUITE( MeasuredCostBalanceTests_TestSuite, MeasuredCostBalanceTests_Fixture )
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( init_mpi )
+{
+  Core::instance().initiate(m_argc,m_argv);
+  PE::Comm::instance().init(m_argc,m_argv);
+  BOOST_CHECK_EQUAL(PE::Comm::instance().size(),2u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( rebalance_measured_cost )
+{
+  // A load balanced square of 24x24 quads, with an overlap layer
+  boost::shared_ptr< MeshGenerator > meshgenerator = build_component_abstract_type<MeshGenerator>("cf3.mesh.SimpleMeshGenerator","generator");
+  meshgenerator->options().set("mesh",URI("//mesh"));
+  meshgenerator->options().set("nb_cells",std::vector<Uint>(2,24));
+  meshgenerator->options().set("lengths",std::vector<Real>(2,1.));
+  meshgenerator->options().set("bdry",false);
+  Mesh& mesh = meshgenerator->generate();
+  build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.LoadBalance","load_balancer")->transform(mesh);
+
+  // A field that must move along with the nodes
+  Field& x_field = mesh.geometry_fields().create_field("x");
+  for (Uint n=0; n<x_field.size(); ++n)
+    x_field[n][0] = mesh.geometry_fields().coordinates()[n][0];
+
+  // Measured cost, unbalanced because the expensive corner is in one part
+  for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+  {
+    Entities& elements = *mesh.elements()[entities_idx];
+    common::List<Real>& element_cost = add_element_cost(elements,0.);
+    for (Uint e=0; e<elements.size(); ++e)
+      element_cost[e] = measured_cost(elements,e);
+  }
+  const std::vector<Real> cost_before = owned_cost_per_proc(mesh);
+  const Real average_cost = 0.5*(cost_before[0]+cost_before[1]);
+
+  boost::shared_ptr<MeshTransformer> balancer = build_component_abstract_type<MeshTransformer>("cf3.mesh.actions.MeasuredCostBalance","balancer");
+  balancer->options().set("imbalance_threshold",1.05);
+  balancer->transform(mesh);
+
+  BOOST_CHECK_CLOSE(balancer->properties().value<Real>("imbalance"),std::max(cost_before[0],cost_before[1])/average_cost,1e-10);
+  BOOST_CHECK(balancer->properties().value<Real>("imbalance") > 1.05);
+
+  // The cost is balanced up to the cost of one element
+  const std::vector<Real> cost_after = owned_cost_per_proc(mesh);
+  BOOST_CHECK_EQUAL(cost_after[0]+cost_after[1],cost_before[0]+cost_before[1]);
+  BOOST_CHECK_LE(std::abs(cost_after[0]-average_cost),5.);
+
+  // The overlap is restored, the field moved along with the nodes, and the measurement restarts
+  Uint nb_ghosts = 0;
+  for (Uint entities_idx=0; entities_idx<mesh.elements().size(); ++entities_idx)
+  {
+    const Entities& elements = *mesh.elements()[entities_idx];
+    for (Uint e=0; e<elements.size(); ++e)
+      if (elements.is_ghost(e))
+        ++nb_ghosts;
+
+    Handle< common::List<Real> const > element_cost(elements.get_child(mesh::Tags::element_cost()));
+    BOOST_REQUIRE(is_not_null(element_cost));
+    BOOST_CHECK_EQUAL(element_cost->size(),elements.size());
+    for (Uint e=0; e<element_cost->size(); ++e)
+      BOOST_CHECK_EQUAL((*element_cost)[e],0.);
+  }
+  BOOST_CHECK(nb_ghosts > 0);
+
+  const Field& moved_x_field = *Handle<Field const>(mesh.geometry_fields().get_child("x"));
+  for (Uint n=0; n<moved_x_field.size(); ++n)
+    BOOST_CHECK_EQUAL(moved_x_field[n][0],mesh.geometry_fields().coordinates()[n][0]);
+
+  // Without new measurements, nothing is unbalanced
+  balancer->transform(mesh);
+  BOOST_CHECK_EQUAL(balancer->properties().value<Real>("imbalance"),1.);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( finalize_mpi )
+{
+  PE::Comm::instance().finalize();
+  Core::instance().terminate();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
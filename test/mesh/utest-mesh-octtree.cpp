@@ -27,6 +27,10 @@
 #include "mesh/Space.hpp"
 #include "common/Table.hpp"
 #include "mesh/Dictionary.hpp"
+#include "mesh/ElementFinderOcttree.hpp"
+#include "mesh/ElementTree.hpp"
+#include "mesh/ElementType.hpp"
+#include "mesh/Field.hpp"
 #include "mesh/MeshGenerator.hpp"
 #include "mesh/Octtree.hpp"
 #include "mesh/StencilComputerOcttree.hpp"
@@ -128,16 +132,18 @@ BOOST_AUTO_TEST_CASE( Octtree_creation )
   stencil_computer->options().set("stencil_size", 1u );
   stencil_computer->compute_stencil(space_elem, stencil);
   BOOST_CHECK_EQUAL(stencil.size(), 1u);
+  BOOST_CHECK(stencil[0] == space_elem);
 
   stencil_computer->options().set("stencil_size", 2u );
   stencil_computer->compute_stencil(space_elem, stencil);
-  BOOST_CHECK_EQUAL(stencil.size(), 9u);
+  BOOST_CHECK_EQUAL(stencil.size(), 2u);
+  BOOST_CHECK(stencil[0] == space_elem);
 
   stencil_computer->options().set("stencil_size", 10u );
   stencil_computer->compute_stencil(space_elem, stencil);
-  BOOST_CHECK_EQUAL(stencil.size(), 20u);
+  BOOST_CHECK_EQUAL(stencil.size(), 10u);
 
-  stencil_computer->options().set("stencil_size", 21u );
+  stencil_computer->options().set("stencil_size", 30u );
   stencil_computer->compute_stencil(space_elem, stencil);
   BOOST_CHECK_EQUAL(stencil.size(), 25u); // mesh size
 
@@ -147,6 +153,79 @@ BOOST_AUTO_TEST_CASE( Octtree_creation )
 
 ////////////////////////////////////////////////////////////////////////////////
 
+BOOST_AUTO_TEST_CASE( ElementTree_graded )
+{
+  Handle< MeshGenerator > mesh_generator(Core::instance().root().get_child("mesh_generator"));
+  mesh_generator->options().set("mesh",Core::instance().root().uri()/"graded_mesh");
+  mesh_generator->options().set("lengths",std::vector<Real>(2,1.));
+  mesh_generator->options().set("nb_cells",std::vector<Uint>(2,40));
+  mesh_generator->options().set("part",0u);
+  mesh_generator->options().set("nb_parts",1u);
+  Mesh& mesh = mesh_generator->generate();
+
+  // Strong grading towards y = 0, as in a boundary layer
+  Field& coords = mesh.geometry_fields().coordinates();
+  for (Uint i=0; i<coords.size(); ++i)
+    coords[i][YY] = std::pow(coords[i][YY], 6.);
+
+  Handle<ElementTree> tree = mesh.create_component<ElementTree>("element_tree");
+  tree->options().set("mesh", mesh.handle<Mesh>());
+  tree->options().set("nb_threads", 2u);
+  tree->build();
+  BOOST_CHECK_EQUAL(tree->nb_elements(), 1600u);
+
+  // Each element centroid must be found in its own element
+  const Entities& elements = *mesh.elements()[0];
+  boost::multi_array<Real,2> centroids(boost::extents[elements.size()][2]);
+  RealMatrix elem_coords;
+  RealVector centroid(2);
+  for (Uint e=0; e<elements.size(); ++e)
+  {
+    Entity(elements,e).allocate_coordinates(elem_coords);
+    Entity(elements,e).put_coordinates(elem_coords);
+    elements.element_type().compute_centroid(elem_coords,centroid);
+    centroids[e][XX] = centroid[XX];
+    centroids[e][YY] = centroid[YY];
+  }
+
+  std::vector<Entity> found;
+  tree->find_elements(centroids, found);
+  BOOST_CHECK_EQUAL(found.size(), elements.size());
+  for (Uint e=0; e<elements.size(); ++e)
+  {
+    BOOST_CHECK(found[e].comp == &elements);
+    BOOST_CHECK_EQUAL(found[e].idx, e);
+  }
+
+  // Points outside the mesh are not found
+  RealVector2 outside;
+  outside << 0.5, 1.5;
+  Entity element;
+  BOOST_CHECK(!tree->find_element(outside, element));
+
+  // The closest elements to a centroid start with its own element
+  std::vector<Entity> closest;
+  centroid[XX] = centroids[41][XX];
+  centroid[YY] = centroids[41][YY];
+  tree->find_closest_elements(centroid, 3, closest);
+  BOOST_CHECK_EQUAL(closest.size(), 3u);
+  BOOST_CHECK_EQUAL(closest[0].idx, 41u);
+
+  // Batched lookup through the element finder, using the same tree
+  Handle<ElementFinderOcttree> finder = mesh.create_component<ElementFinderOcttree>("element_finder");
+  finder->options().set("dict", mesh.geometry_fields().handle<Dictionary>());
+  std::vector<SpaceElem> space_elems;
+  std::vector<bool> is_found;
+  finder->find_elements(centroids, space_elems, is_found);
+  for (Uint e=0; e<elements.size(); ++e)
+  {
+    BOOST_CHECK(is_found[e]);
+    BOOST_CHECK_EQUAL(space_elems[e].idx, e);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
 BOOST_AUTO_TEST_CASE( Octtree_parallel )
 {
   Handle< MeshGenerator > mesh_generator(Core::instance().root().get_child("mesh_generator"));
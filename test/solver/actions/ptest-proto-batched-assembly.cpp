@@ -0,0 +1,243 @@
+// Copyright (C) 2010-2013 von Karman Institute for Fluid Dynamics, Belgium
+//
+// This software is distributed under the terms of the
+// GNU Lesser General Public License version 3 (LGPLv3).
+// See doc/lgpl.txt and doc/gpl.txt for the license text.
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE "Test module for benchmarking batched proto element assembly"
+
+#include <set>
+
+#include <boost/bind.hpp>
+#include <boost/foreach.hpp>
+#include <boost/function.hpp>
+#include <boost/lexical_cast.hpp>
+#include <boost/test/unit_test.hpp>
+
+#include "coolfluid-packages.hpp"
+
+#include "common/Core.hpp"
+#include "common/Environment.hpp"
+#include "common/Log.hpp"
+
+#include "common/PE/Comm.hpp"
+#include "common/PE/CommPattern.hpp"
+
+#include "math/LSS/System.hpp"
+
+#include "mesh/Domain.hpp"
+#include "mesh/Mesh.hpp"
+#include "mesh/Region.hpp"
+#include "mesh/Elements.hpp"
+#include "mesh/FieldManager.hpp"
+#include "mesh/Dictionary.hpp"
+#include "mesh/Connectivity.hpp"
+#include "mesh/Space.hpp"
+
+#include "mesh/BlockMesh/BlockData.hpp"
+#include "mesh/LagrangeP1/Hexa3D.hpp"
+#include "mesh/LagrangeP1/Tetra3D.hpp"
+
+#include "physics/PhysModel.hpp"
+
+#include "solver/Model.hpp"
+#include "solver/Tags.hpp"
+
+#include "solver/actions/Proto/ProtoAction.hpp"
+#include "solver/actions/Proto/ElementLooper.hpp"
+#include "solver/actions/Proto/Expression.hpp"
+#include "solver/actions/Proto/Functions.hpp"
+#include "solver/actions/Proto/Terminals.hpp"
+
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
+#include "Tools/Testing/ProfiledTestFixture.hpp"
+#include "Tools/Testing/TimedTestFixture.hpp"
+
+using namespace cf3;
+using namespace cf3::solver;
+using namespace cf3::solver::actions;
+using namespace cf3::solver::actions::Proto;
+using namespace cf3::mesh;
+using namespace cf3::common;
+
+using boost::proto::lit;
+
+////////////////////////////////////////////////////
+
+struct ProtoBatchedAssemblyFixture :
+  public Tools::Testing::ProfiledTestFixture,
+  public Tools::Testing::TimedTestFixture
+{
+  ProtoBatchedAssemblyFixture() :
+    root(Core::instance().root()),
+    length(12.),
+    half_height(0.5),
+    width(6.)
+  {
+  }
+
+  // Setup a model under root, using the given mesh, with a temperature field and an LSS
+  void setup(const std::string& model_name, const boost::function<void(Mesh&)>& create_mesh)
+  {
+    Model& model = *root.create_component<Model>(model_name);
+    physics::PhysModel& phys_model = model.create_physics("cf3.physics.DynamicModel");
+    Domain& dom = model.create_domain("Domain");
+
+    Mesh& mesh = *dom.create_component<Mesh>("mesh");
+    create_mesh(mesh);
+
+    Handle<FieldManager> field_manager = model.create_component<FieldManager>("FieldManager");
+    field_manager->options().set("variable_manager", phys_model.variable_manager().handle<math::VariableManager>());
+
+    // Node connectivity for the LSS
+    const Uint nb_nodes = mesh.geometry_fields().size();
+    std::vector< std::set<Uint> > connectivity_sets(nb_nodes);
+    BOOST_FOREACH(const Elements& elements, find_components_recursively_with_filter<Elements>(mesh, IsElementsVolume()))
+    {
+      const Connectivity& connectivity = elements.geometry_space().connectivity();
+      const Uint nb_elems = connectivity.size();
+      for(Uint elem = 0; elem != nb_elems; ++elem)
+      {
+        BOOST_FOREACH(const Uint node_a, connectivity[elem])
+        {
+          BOOST_FOREACH(const Uint node_b, connectivity[elem])
+          {
+            connectivity_sets[node_a].insert(node_b);
+          }
+        }
+      }
+    }
+
+    std::vector<Uint> node_connectivity;
+    std::vector<Uint> starting_indices(1, 0);
+    BOOST_FOREACH(const std::set<Uint>& nodes, connectivity_sets)
+    {
+      starting_indices.push_back(starting_indices.back() + nodes.size());
+      node_connectivity.insert(node_connectivity.end(), nodes.begin(), nodes.end());
+    }
+
+    Handle<math::LSS::System> lss = model.create_component<math::LSS::System>("LSS");
+#ifdef CF3_HAVE_TRILINOS
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.TrilinosCrsMatrix"));
+#else
+    lss->options().set("matrix_builder", std::string("cf3.math.LSS.EmptyLSSMatrix"));
+    lss->options().set("solution_strategy", std::string("cf3.math.LSS.EmptyStrategy"));
+#endif
+    lss->create(mesh.geometry_fields().comm_pattern(), 1, node_connectivity, starting_indices);
+
+  }
+
+  // Run the assembly for the given model. The LSS wrappers are held by reference in the expression, so the action only lives in this scope
+  void assemble(const std::string& model_name, const bool batched)
+  {
+    Model& model = *Handle<Model>(root.get_child(model_name));
+    physics::PhysModel& phys_model = model.physics();
+    Mesh& mesh = *Handle<Mesh>(model.domain().get_child("mesh"));
+    math::LSS::System& lss = *Handle<math::LSS::System>(model.get_child("LSS"));
+
+    FieldVariable<0, ScalarField> T("Temperature", "temperature");
+    SystemMatrix matrix(lss);
+    SystemRHS sys_rhs(lss);
+
+    Handle<ProtoAction> action = model.create_component<ProtoAction>("Assembly");
+    action->set_expression(elements_expression
+    (
+      boost::mpl::vector2<LagrangeP1::Hexa3D, LagrangeP1::Tetra3D>(),
+      group
+      (
+        _A = _0,
+        element_quadrature
+        (
+          _A(T) += transpose(nabla(T)) * nabla(T)
+        ),
+        lit(volume_sum) += volume,
+        matrix += _A,
+        sys_rhs += -_A * _x
+      )
+    ));
+    action->options().set("physical_model", phys_model.handle<physics::PhysModel>());
+    action->options().set(solver::Tags::regions(), std::vector<URI>(1, mesh.topology().uri()));
+    action->options().set("element_batching", batched);
+    Handle<FieldManager>(model.get_child("FieldManager"))->create_field("temperature", mesh.geometry_fields());
+
+    volume_sum = 0.;
+    action->execute();
+    BOOST_CHECK_CLOSE(volume_sum, length*half_height*2.*width, 1e-6);
+
+    model.remove_component(*action);
+  }
+
+  static void create_hexas(Mesh& mesh, const Real length, const Real half_height, const Real width, const Uint x_segs, const Uint y_segs, const Uint z_segs)
+  {
+    BlockMesh::BlockArrays& blocks = *mesh.parent()->create_component<BlockMesh::BlockArrays>("blocks");
+    Tools::MeshGeneration::create_channel_3d(blocks, length, half_height, width, x_segs, y_segs/2, z_segs, 0.1);
+    blocks.create_mesh(mesh);
+  }
+
+  Component& root;
+  const Real length;
+  const Real half_height;
+  const Real width;
+
+  static Real volume_sum;
+};
+
+Real ProtoBatchedAssemblyFixture::volume_sum = 0.;
+
+BOOST_FIXTURE_TEST_SUITE( ProtoBatchedAssemblySuite, ProtoBatchedAssemblyFixture )
+
+//////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Setup )
+{
+  int argc = boost::unit_test::framework::master_test_suite().argc;
+  char** argv = boost::unit_test::framework::master_test_suite().argv;
+
+  PE::Comm::instance().init(argc, argv);
+
+  cf3_assert(argc == 4);
+  const Uint x_segs = boost::lexical_cast<Uint>(argv[1]);
+  const Uint y_segs = boost::lexical_cast<Uint>(argv[2]);
+  const Uint z_segs = boost::lexical_cast<Uint>(argv[3]);
+
+  std::cout << "Element batch size: " << static_cast<Uint>(GeometricSupport<LagrangeP1::Hexa3D>::batch_size) << std::endl;
+
+  setup("Hexa", boost::bind(&ProtoBatchedAssemblyFixture::create_hexas, _1, length, half_height, width, x_segs, y_segs, z_segs));
+  setup("Tetra", boost::bind(&Tools::MeshGeneration::create_box_tetras, _1, length, 2.*half_height, width, x_segs, y_segs, z_segs));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( HexaUnbatched )
+{
+  assemble("Hexa", false);
+}
+
+BOOST_AUTO_TEST_CASE( HexaBatched )
+{
+  assemble("Hexa", true);
+}
+
+BOOST_AUTO_TEST_CASE( TetraUnbatched )
+{
+  assemble("Tetra", false);
+}
+
+BOOST_AUTO_TEST_CASE( TetraBatched )
+{
+  assemble("Tetra", true);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_CASE( Finalize )
+{
+  PE::Comm::instance().finalize();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+BOOST_AUTO_TEST_SUITE_END()
+
+////////////////////////////////////////////////////////////////////////////////
@@ -12,6 +12,7 @@
 #include <boost/test/unit_test.hpp>
 
 #include "common/Core.hpp"
+#include "common/List.hpp"
 #include "common/Log.hpp"
 
 #include "math/MatrixTypes.hpp"
@@ -32,6 +33,9 @@
 #include <mesh/LagrangeP0/Line.hpp>
 
 #include "mesh/BlockMesh/BlockData.hpp"
+#include "mesh/ElementColoring.hpp"
+#include "mesh/Field.hpp"
+#include "mesh/Tags.hpp"
 
 #include "physics/PhysModel.hpp"
 
@@ -46,6 +50,7 @@
 #include "solver/actions/Proto/NodeLooper.hpp"
 #include "solver/actions/Proto/Terminals.hpp"
 
+#include "Tools/MeshGeneration/MeshGeneration.hpp"
 #include "Tools/Testing/TimedTestFixture.hpp"
 
 using namespace cf3;
@@ -236,6 +241,97 @@ BOOST_AUTO_TEST_CASE( ProtoVectorElementField )
   writer.execute();
 }
 
+
+// Test the coloring and a threaded element loop that accumulates into nodal values
+BOOST_AUTO_TEST_CASE( ProtoThreadedElementLoop )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("threaded_mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 1., 1., 40, 30);
+
+  // No two elements with the same color may share a node
+  Elements& elements = find_component_recursively_with_filter<Elements>(mesh->topology(), IsElementsVolume());
+  const ElementColoring& coloring = element_coloring(elements);
+  BOOST_CHECK(coloring.nb_colors() >= 4);
+  std::vector<Uint> node_colors(mesh->geometry_fields().size());
+  for(Uint color = 0; color != coloring.nb_colors(); ++color)
+  {
+    std::fill(node_colors.begin(), node_colors.end(), 0u);
+    for(const Uint* elem_it = coloring.elements_begin(color); elem_it != coloring.elements_end(color); ++elem_it)
+    {
+      BOOST_FOREACH(const Uint node, elements.geometry_space().connectivity()[*elem_it])
+      {
+        BOOST_CHECK_EQUAL(node_colors[node], 0u);
+        ++node_colors[node];
+      }
+    }
+  }
+
+  Field& valence_field = mesh->geometry_fields().create_field("valence", "Valence");
+  valence_field.add_tag("valence");
+
+  FieldVariable<0, ScalarField> valence("Valence", "valence");
+
+  Eigen::Matrix<Real, 4, 4> vals; vals.setConstant(0.25);
+
+  boost::shared_ptr<ProtoAction> action = create_proto_action
+  (
+    "ThreadedValence",
+    elements_expression(boost::mpl::vector1<LagrangeP1::Quad2D>(), group(lump(vals), valence += diagonal(vals)))
+  );
+  Core::instance().root().add_component(action);
+  action->options().set("nb_threads", 4u);
+  action->options().set(solver::Tags::regions(), std::vector<URI>(1, mesh->topology().uri()));
+  action->execute();
+
+  // Each node value must equal the number of elements it belongs to
+  std::vector<Real> expected(valence_field.size(), 0.);
+  for(Uint elem = 0; elem != elements.size(); ++elem)
+  {
+    BOOST_FOREACH(const Uint node, elements.geometry_space().connectivity()[elem])
+      expected[node] += 1.;
+  }
+  for(Uint node = 0; node != valence_field.size(); ++node)
+    BOOST_CHECK_EQUAL(valence_field[node][0], expected[node]);
+}
+
+// Recording the cost of an element loop
+BOOST_AUTO_TEST_CASE( ProtoRecordCost )
+{
+  Handle<Mesh> mesh = Core::instance().root().create_component<Mesh>("cost_mesh");
+  Tools::MeshGeneration::create_rectangle(*mesh, 1., 1., 20, 10);
+  Elements& elements = find_component_recursively_with_filter<Elements>(mesh->topology(), IsElementsVolume());
+
+  mesh->geometry_fields().create_field("cost_valence", "CostValence").add_tag("cost_valence");
+  FieldVariable<0, ScalarField> valence("CostValence", "cost_valence");
+
+  Eigen::Matrix<Real, 4, 4> vals; vals.setConstant(0.25);
+
+  boost::shared_ptr<ProtoAction> action = create_proto_action
+  (
+    "CostValence",
+    elements_expression(boost::mpl::vector1<LagrangeP1::Quad2D>(), group(lump(vals), valence += diagonal(vals)))
+  );
+  Core::instance().root().add_component(action);
+  action->options().set(solver::Tags::regions(), std::vector<URI>(1, mesh->topology().uri()));
+
+  // Nothing is recorded by default
+  action->execute();
+  BOOST_CHECK(is_null(elements.get_child(mesh::Tags::element_cost())));
+
+  action->options().set("record_cost", true);
+  action->execute();
+  Handle< common::List<Real> > element_cost(elements.get_child(mesh::Tags::element_cost()));
+  BOOST_REQUIRE(is_not_null(element_cost));
+  BOOST_CHECK_EQUAL(element_cost->size(), elements.size());
+
+  // The cost of the block is spread evenly, and accumulates over executions
+  const Real first_cost = (*element_cost)[0];
+  BOOST_CHECK(first_cost > 0.);
+  BOOST_CHECK_EQUAL((*element_cost)[elements.size()-1], first_cost);
+  action->execute();
+  BOOST_CHECK((*element_cost)[0] > first_cost);
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 
 BOOST_AUTO_TEST_SUITE_END()